@@ -0,0 +1,73 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#pragma once
+
+#include <history/clipboard_history_types.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace pasty::benchmark {
+
+using Clock = std::chrono::steady_clock;
+
+struct LatencySummary {
+    double meanUs = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+};
+
+inline LatencySummary summarize(std::vector<double> samplesUs) {
+    LatencySummary summary;
+    if (samplesUs.empty()) {
+        return summary;
+    }
+
+    double total = 0.0;
+    for (double sample : samplesUs) {
+        total += sample;
+    }
+    std::sort(samplesUs.begin(), samplesUs.end());
+    summary.meanUs = total / static_cast<double>(samplesUs.size());
+    summary.p50Us = samplesUs[samplesUs.size() / 2];
+    summary.p99Us = samplesUs[std::min(samplesUs.size() - 1, (samplesUs.size() * 99) / 100)];
+    return summary;
+}
+
+inline void printSummary(const char* name, std::size_t calls, const LatencySummary& summary) {
+    std::printf("%-24s calls=%-7zu mean=%8.2fus p50=%8.2fus p99=%8.2fus\n",
+        name, calls, summary.meanUs, summary.p50Us, summary.p99Us);
+}
+
+inline double elapsedUs(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+inline std::string makeDirectory(const std::string& name) {
+    const auto path = std::filesystem::temp_directory_path() / "pasty-bench" /
+        (name + "-" + std::to_string(std::random_device{}()));
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    return path.string();
+}
+
+inline pasty::ClipboardHistoryItem makeTextItem(std::size_t index) {
+    pasty::ClipboardHistoryItem item;
+    item.type = pasty::ClipboardItemType::Text;
+    item.content = "benchmark clipboard entry #" + std::to_string(index) + " with some representative text payload";
+    item.contentHash = "bench-hash-" + std::to_string(index);
+    item.id = "bench-id-" + std::to_string(index);
+    item.sourceAppId = "com.pasty.bench";
+    item.createTimeMs = 1000 + static_cast<std::int64_t>(index);
+    item.updateTimeMs = item.createTimeMs;
+    item.lastCopyTimeMs = item.createTimeMs;
+    return item;
+}
+
+} // namespace pasty::benchmark
@@ -0,0 +1,104 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#include "benchmark_utils.h"
+
+#include <application/history/clipboard_service.h>
+#include <infrastructure/settings/in_memory_settings_store.h>
+#include <infrastructure/sync/cloud_drive_sync_exporter.h>
+#include <infrastructure/sync/cloud_drive_sync_importer.h>
+#include <store/sqlite_clipboard_history_store.h>
+#include <utils/content_hash.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+using namespace pasty::benchmark;
+
+namespace {
+
+const char* kKeyId = "bench-key";
+
+pasty::EncryptionManager::Key makeKey() {
+    pasty::EncryptionManager::Key key;
+    for (std::size_t i = 0; i < key.size(); ++i) {
+        key[i] = static_cast<unsigned char>(i * 7 + 3);
+    }
+    return key;
+}
+
+// Writes `devices` remote logs of `eventsPerDevice` encrypted text events
+// each, through the real exporter so the lines match what peers produce.
+void buildSyncRoot(const std::string& syncRoot, std::size_t devices, std::size_t eventsPerDevice, std::size_t textBytes) {
+    const pasty::EncryptionManager::Key key = makeKey();
+    for (std::size_t d = 0; d < devices; ++d) {
+        const std::string baseDir = syncRoot + "-device-" + std::to_string(d);
+        auto exporter = pasty::CloudDriveSyncExporter::Create(syncRoot, baseDir, key, kKeyId);
+        if (!exporter) {
+            std::fprintf(stderr, "failed to create exporter for device %zu\n", d);
+            return;
+        }
+        for (std::size_t i = 0; i < eventsPerDevice; ++i) {
+            pasty::ClipboardHistoryItem item;
+            item.type = pasty::ClipboardItemType::Text;
+            item.content = "device " + std::to_string(d) + " entry " + std::to_string(i) + " ";
+            item.content.resize(textBytes, 'x');
+            item.contentHash = pasty::content_hash::computeTextHash(item.content);
+            item.sourceAppId = "com.pasty.bench";
+            exporter->exportTextItem(item);
+        }
+    }
+}
+
+void runImport(const std::string& syncRoot, std::size_t threads, std::size_t totalEvents) {
+    const std::string baseDir = makeDirectory("sync-import-t" + std::to_string(threads));
+    pasty::InMemorySettingsStore settings(static_cast<int>(totalEvents) + 1);
+    pasty::ClipboardService service(pasty::createClipboardHistoryStore(), settings);
+    if (!service.initialize(baseDir + "/history")) {
+        std::fprintf(stderr, "failed to open history at %s\n", baseDir.c_str());
+        return;
+    }
+
+    auto importer = pasty::CloudDriveSyncImporter::Create(syncRoot, baseDir, makeKey(), kKeyId);
+    if (!importer) {
+        std::fprintf(stderr, "failed to create importer\n");
+        return;
+    }
+    importer->setParseThreads(threads);
+
+    const auto start = Clock::now();
+    const auto result = importer->importChanges(service);
+    const double elapsedMs = elapsedUs(start) / 1000.0;
+    std::printf("import.t%-3zu processed=%-7d applied=%-7d total=%9.1fms per_event=%7.2fus\n",
+        threads, result.eventsProcessed, result.eventsApplied, elapsedMs,
+        result.eventsProcessed > 0 ? elapsedMs * 1000.0 / result.eventsProcessed : 0.0);
+
+    service.shutdown();
+    std::filesystem::remove_all(baseDir);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    pasty::setClipboardHistoryMigrationDirectory(PASTY_BENCHMARK_MIGRATION_DIR);
+
+    const std::size_t devices = argc > 1 ? static_cast<std::size_t>(std::stoul(argv[1])) : 8;
+    const std::size_t eventsPerDevice = argc > 2 ? static_cast<std::size_t>(std::stoul(argv[2])) : 2000;
+    const std::size_t textBytes = argc > 3 ? static_cast<std::size_t>(std::stoul(argv[3])) : 4096;
+
+    const std::string syncRoot = makeDirectory("sync-root");
+    buildSyncRoot(syncRoot, devices, eventsPerDevice, textBytes);
+
+    std::printf("devices=%zu events_per_device=%zu text_bytes=%zu hardware threads=%u\n",
+        devices, eventsPerDevice, textBytes, std::thread::hardware_concurrency());
+    for (std::size_t threads : {1, 2, 4, 8}) {
+        runImport(syncRoot, threads, devices * eventsPerDevice);
+    }
+
+    std::filesystem::remove_all(syncRoot);
+    for (std::size_t d = 0; d < devices; ++d) {
+        std::filesystem::remove_all(syncRoot + "-device-" + std::to_string(d));
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#include "benchmark_utils.h"
+
+#include <utils/content_hash.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pasty::benchmark;
+
+namespace {
+
+// The version-1 scheme as it used to run on ingest: build a normalized copy,
+// then FNV-1a it byte by byte. Kept here only as the baseline.
+std::string legacyTextHash(const std::string& text) {
+    std::string normalized;
+    normalized.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\r') {
+            if (i + 1 < text.size() && text[i + 1] == '\n') {
+                continue;
+            }
+            normalized.push_back('\n');
+            continue;
+        }
+        normalized.push_back(text[i]);
+    }
+
+    std::uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : normalized) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+std::string makePaste(std::size_t size, const char* lineEnding) {
+    std::string text;
+    text.reserve(size + 128);
+    std::size_t line = 0;
+    while (text.size() < size) {
+        text += "line " + std::to_string(line++) + " of a large pasted log excerpt";
+        text += lineEnding;
+    }
+    text.resize(size);
+    return text;
+}
+
+template <typename Fn>
+void run(const char* name, std::size_t iterations, Fn&& hash) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    std::size_t sink = 0;
+    for (std::size_t i = 0; i < iterations; ++i) {
+        const auto start = Clock::now();
+        sink += hash().size();
+        samples.push_back(elapsedUs(start));
+    }
+    printSummary(name, iterations, summarize(samples));
+    if (sink == 0) {
+        std::printf("unexpected empty hash\n");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t size = argc > 1 ? static_cast<std::size_t>(std::stoul(argv[1])) : 10 * 1024 * 1024;
+    const std::size_t iterations = 50;
+
+    const std::string lfText = makePaste(size, "\n");
+    const std::string crlfText = makePaste(size, "\r\n");
+    const std::vector<std::uint8_t> image(lfText.begin(), lfText.end());
+
+    std::printf("payload=%zu bytes\n", size);
+    run("text.lf.fnv", iterations, [&]() { return legacyTextHash(lfText); });
+    run("text.lf.xxh3", iterations, [&]() { return pasty::content_hash::computeTextHash(lfText); });
+    run("text.crlf.fnv", iterations, [&]() { return legacyTextHash(crlfText); });
+    run("text.crlf.xxh3", iterations, [&]() { return pasty::content_hash::computeTextHash(crlfText); });
+    run("image.xxh3", iterations, [&]() { return pasty::content_hash::computeImageHash(pasty::ImageBytesView(image)); });
+
+    // Large images: the one-pass XXH3 they would get without the tree mode
+    // against the tree hash with a growing thread budget.
+    std::printf("hardware threads=%u\n", std::thread::hardware_concurrency());
+    for (std::size_t megabytes : {5, 10, 25, 50}) {
+        std::vector<std::uint8_t> payload(megabytes * 1024 * 1024);
+        for (std::size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = static_cast<std::uint8_t>((i * 2654435761u) >> 13);
+        }
+        std::printf("image payload=%zu MiB\n", megabytes);
+        run("image.serial", 20, [&]() { return pasty::content_hash::hashBytes(payload.data(), payload.size()); });
+        for (std::size_t threads : {1, 2, 4}) {
+            const std::string name = "image.tree.t" + std::to_string(threads);
+            run(name.c_str(), 20, [&]() { return pasty::content_hash::computeImageHash(pasty::ImageBytesView(payload), threads); });
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#include "benchmark_utils.h"
+
+#include <history/clipboard_history_store.h>
+#include <store/sqlite_clipboard_history_store.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pasty::benchmark;
+
+namespace {
+
+struct WorkloadShape {
+    std::size_t seedItems = 2000;
+    std::int32_t retention = 20000;
+    std::size_t imageBytes = 256 * 1024;
+    std::size_t imageEvery = 20;
+};
+
+struct ConcurrencyResult {
+    std::vector<double> readSamples;
+    std::size_t writes = 0;
+};
+
+// One writer ingests text items with an image every shape.imageEvery items
+// while reader threads page through history like the UI does.
+ConcurrencyResult runScenario(const char* name,
+                              const pasty::ClipboardHistoryStoreOptions& options,
+                              const WorkloadShape& shape,
+                              std::size_t readerThreads,
+                              std::size_t readsPerThread) {
+    ConcurrencyResult result;
+    const std::string directory = makeDirectory(name);
+    auto store = pasty::createClipboardHistoryStore(options);
+    if (!store->open(directory)) {
+        std::fprintf(stderr, "failed to open store at %s\n", directory.c_str());
+        return result;
+    }
+    store->enforceRetention(shape.retention);
+
+    std::vector<pasty::ClipboardHistoryUpsertRequest> seed;
+    for (std::size_t i = 0; i < shape.seedItems; ++i) {
+        pasty::ClipboardHistoryUpsertRequest request;
+        request.item = makeTextItem(i);
+        seed.push_back(request);
+    }
+    store->upsertItems(seed);
+
+    std::atomic<bool> readersDone(false);
+    std::atomic<std::size_t> writes(0);
+    std::thread writer([&]() {
+        std::vector<std::uint8_t> imageBytes(shape.imageBytes, 0x5A);
+        std::size_t index = shape.seedItems;
+        while (!readersDone) {
+            pasty::ClipboardHistoryItem item = makeTextItem(index);
+            if (index % shape.imageEvery == 0) {
+                item.type = pasty::ClipboardItemType::Image;
+                item.content.clear();
+                item.imageFormat = "png";
+                imageBytes[index % imageBytes.size()] ^= 0xFF;
+                store->upsertImageItem(item, pasty::ImageBytesView(imageBytes));
+            } else {
+                store->upsertTextItem(item);
+            }
+            ++index;
+            ++writes;
+        }
+    });
+
+    std::mutex samplesMutex;
+    std::vector<std::thread> readers;
+    for (std::size_t r = 0; r < readerThreads; ++r) {
+        readers.emplace_back([&]() {
+            std::vector<double> samples;
+            samples.reserve(readsPerThread);
+            for (std::size_t i = 0; i < readsPerThread; ++i) {
+                const auto start = Clock::now();
+                store->listItems(100, std::string());
+                samples.push_back(elapsedUs(start));
+            }
+            std::lock_guard<std::mutex> lock(samplesMutex);
+            result.readSamples.insert(result.readSamples.end(), samples.begin(), samples.end());
+        });
+    }
+
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    readersDone = true;
+    writer.join();
+    result.writes = writes;
+
+    store->close();
+    std::filesystem::remove_all(directory);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t readsPerThread = argc > 1 ? static_cast<std::size_t>(std::stoul(argv[1])) : 2000;
+    constexpr std::size_t kReaderThreads = 3;
+
+    pasty::setClipboardHistoryMigrationDirectory(PASTY_BENCHMARK_MIGRATION_DIR);
+
+    pasty::ClipboardHistoryStoreOptions serialized;
+    serialized.walEnabled = false;
+    serialized.readerConnections = 0;
+    const ConcurrencyResult baseline = runScenario("history-serialized", serialized, WorkloadShape{}, kReaderThreads, readsPerThread);
+
+    pasty::ClipboardHistoryStoreOptions pooled;
+    pooled.readerConnections = static_cast<std::int32_t>(kReaderThreads);
+    const ConcurrencyResult wal = runScenario("history-wal-pool", pooled, WorkloadShape{}, kReaderThreads, readsPerThread);
+
+    // Every write is a distinct 8 MiB screenshot; retention keeps the asset
+    // directory small. On a single connection every list waits for the writer.
+    WorkloadShape screenshots;
+    screenshots.seedItems = 50;
+    screenshots.retention = 40;
+    screenshots.imageBytes = 8 * 1024 * 1024;
+    screenshots.imageEvery = 1;
+    const ConcurrencyResult large = runScenario("history-large-images", serialized, screenshots, kReaderThreads, readsPerThread);
+
+    printSummary("list (single conn)", baseline.readSamples.size(), summarize(baseline.readSamples));
+    std::printf("%-24s writes=%zu\n", "", baseline.writes);
+    printSummary("list (wal + readers)", wal.readSamples.size(), summarize(wal.readSamples));
+    std::printf("%-24s writes=%zu\n", "", wal.writes);
+    printSummary("list (8 MiB images)", large.readSamples.size(), summarize(large.readSamples));
+    std::printf("%-24s writes=%zu\n", "", large.writes);
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#include "benchmark_utils.h"
+
+#include <history/clipboard_history_store.h>
+#include <store/cached_clipboard_history_store.h>
+#include <store/sqlite_clipboard_history_store.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace pasty::benchmark;
+
+int main(int argc, char** argv) {
+    const std::size_t itemCount = argc > 1 ? static_cast<std::size_t>(std::stoul(argv[1])) : 5000;
+    const std::size_t lookupCount = itemCount * 4;
+
+    pasty::setClipboardHistoryMigrationDirectory(PASTY_BENCHMARK_MIGRATION_DIR);
+    const std::string directory = makeDirectory("history-store");
+
+    auto store = pasty::createClipboardHistoryStore();
+    if (!store->open(directory)) {
+        std::fprintf(stderr, "failed to open store at %s\n", directory.c_str());
+        return 1;
+    }
+    store->enforceRetention(static_cast<std::int32_t>(itemCount * 2));
+
+    std::vector<double> ingestSamples;
+    ingestSamples.reserve(itemCount);
+    for (std::size_t i = 0; i < itemCount; ++i) {
+        const pasty::ClipboardHistoryItem item = makeTextItem(i);
+        const auto start = Clock::now();
+        store->upsertTextItem(item);
+        ingestSamples.push_back(elapsedUs(start));
+    }
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<std::size_t> pick(0, itemCount - 1);
+    std::vector<double> getSamples;
+    getSamples.reserve(lookupCount);
+    for (std::size_t i = 0; i < lookupCount; ++i) {
+        const std::string id = "bench-id-" + std::to_string(pick(random));
+        const auto start = Clock::now();
+        store->getItem(id);
+        getSamples.push_back(elapsedUs(start));
+    }
+
+    std::vector<double> searchSamples;
+    searchSamples.reserve(200);
+    for (std::size_t i = 0; i < 200; ++i) {
+        pasty::SearchOptions options;
+        options.query = "entry #" + std::to_string(pick(random));
+        options.limit = 50;
+        const auto start = Clock::now();
+        store->search(options);
+        searchSamples.push_back(elapsedUs(start));
+    }
+
+    std::vector<double> substringSamples;
+    substringSamples.reserve(200);
+    for (std::size_t i = 0; i < 200; ++i) {
+        pasty::SearchOptions options;
+        options.query = "ry #" + std::to_string(pick(random)) + " wi";
+        options.limit = 50;
+        options.mode = pasty::SearchMode::Substring;
+        const auto start = Clock::now();
+        store->search(options);
+        substringSamples.push_back(elapsedUs(start));
+    }
+
+    // Walk the whole history in UI-sized pages; per-page cost should stay flat
+    // from the first page to the last.
+    std::vector<double> pageSamples;
+    std::string cursor;
+    do {
+        const auto start = Clock::now();
+        const auto page = store->listItems(50, cursor);
+        pageSamples.push_back(elapsedUs(start));
+        cursor = page.nextCursor;
+    } while (!cursor.empty());
+
+    std::vector<double> summaryPageSamples;
+    do {
+        const auto start = Clock::now();
+        const auto page = store->listItemSummaries(50, cursor);
+        summaryPageSamples.push_back(elapsedUs(start));
+        cursor = page.nextCursor;
+    } while (!cursor.empty());
+
+    store->close();
+
+    // Repeated lookups of the 256 most recent items, the access pattern of
+    // tag edits and sync dedupe, with and without the item cache.
+    constexpr std::size_t kHotItems = 256;
+    std::uniform_int_distribution<std::size_t> pickHot(itemCount - std::min(itemCount, kHotItems), itemCount - 1);
+    auto measureHotLookups = [&](pasty::ClipboardHistoryStore& target) {
+        std::vector<double> samples;
+        samples.reserve(lookupCount);
+        for (std::size_t i = 0; i < lookupCount; ++i) {
+            const std::string id = "bench-id-" + std::to_string(pickHot(random));
+            const auto start = Clock::now();
+            target.getItem(id);
+            samples.push_back(elapsedUs(start));
+        }
+        return samples;
+    };
+
+    store->open(directory);
+    const std::vector<double> hotSamples = measureHotLookups(*store);
+    store->close();
+
+    pasty::CachedClipboardHistoryStore cachedStore(pasty::createClipboardHistoryStore(), 512);
+    cachedStore.open(directory);
+    const std::vector<double> cachedHotSamples = measureHotLookups(cachedStore);
+    const pasty::ClipboardHistoryCacheStats cacheStats = cachedStore.cacheStats();
+    cachedStore.close();
+    std::filesystem::remove_all(directory);
+
+    // Same items again through upsertItems; samples are per item so the two
+    // ingest rows compare directly.
+    constexpr std::size_t kBatchSize = 100;
+    const std::string batchDirectory = makeDirectory("history-store-batch");
+    auto batchStore = pasty::createClipboardHistoryStore();
+    if (!batchStore->open(batchDirectory)) {
+        std::fprintf(stderr, "failed to open store at %s\n", batchDirectory.c_str());
+        return 1;
+    }
+    batchStore->enforceRetention(static_cast<std::int32_t>(itemCount * 2));
+
+    std::vector<double> batchSamples;
+    batchSamples.reserve(itemCount);
+    for (std::size_t first = 0; first < itemCount; first += kBatchSize) {
+        std::vector<pasty::ClipboardHistoryUpsertRequest> requests;
+        for (std::size_t i = first; i < std::min(itemCount, first + kBatchSize); ++i) {
+            pasty::ClipboardHistoryUpsertRequest request;
+            request.item = makeTextItem(i);
+            requests.push_back(request);
+        }
+        const auto start = Clock::now();
+        batchStore->upsertItems(requests);
+        const double perItemUs = elapsedUs(start) / static_cast<double>(requests.size());
+        batchSamples.insert(batchSamples.end(), requests.size(), perItemUs);
+    }
+
+    batchStore->close();
+    std::filesystem::remove_all(batchDirectory);
+
+    printSummary("upsertTextItem", ingestSamples.size(), summarize(ingestSamples));
+    printSummary("upsertItems (x100)", batchSamples.size(), summarize(batchSamples));
+    printSummary("getItem", getSamples.size(), summarize(getSamples));
+    printSummary("getItem (hot 256)", hotSamples.size(), summarize(hotSamples));
+    printSummary("getItem (hot, cached)", cachedHotSamples.size(), summarize(cachedHotSamples));
+    std::printf("%-24s hitRate=%.3f\n", "", cacheStats.hitRate());
+    printSummary("listItems (page of 50)", pageSamples.size(), summarize(pageSamples));
+    printSummary("listItemSummaries (50)", summaryPageSamples.size(), summarize(summaryPageSamples));
+    printSummary("search", searchSamples.size(), summarize(searchSamples));
+    printSummary("search (substring)", substringSamples.size(), summarize(substringSamples));
+    return 0;
+}
@@ -3,6 +3,7 @@
 #ifndef PASTY_HISTORY_TYPES_H
 #define PASTY_HISTORY_TYPES_H
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <string>
@@ -30,11 +31,42 @@ enum class OriginType {
     CloudSync,
 };
 
+// Non-owning view of encoded image bytes. Whoever hands one out keeps the
+// underlying buffer alive for as long as the view is used.
+struct ImageBytesView {
+    const std::uint8_t* data = nullptr;
+    std::size_t size = 0;
+
+    ImageBytesView() = default;
+    ImageBytesView(const std::uint8_t* bytes, std::size_t length)
+        : data(bytes)
+        , size(length) {
+    }
+    // Views never own their bytes; a temporary vector would leave the view
+    // dangling, so only named buffers convert, and only when spelled out.
+    explicit ImageBytesView(const std::vector<std::uint8_t>& bytes)
+        : data(bytes.data())
+        , size(bytes.size()) {
+    }
+    ImageBytesView(std::vector<std::uint8_t>&&) = delete;
+
+    bool empty() const {
+        return size == 0;
+    }
+};
+
 struct ClipboardImagePayload {
     std::vector<std::uint8_t> bytes;
+    // Takes precedence over bytes when non-empty, so a caller can ingest its
+    // own buffer without copying it; the buffer must outlive the ingest call.
+    ImageBytesView borrowedBytes;
     std::int32_t width = 0;
     std::int32_t height = 0;
     std::string formatHint;
+
+    ImageBytesView view() const {
+        return borrowedBytes.empty() ? ImageBytesView(bytes) : borrowedBytes;
+    }
 };
 
 struct ClipboardEventFlags {
@@ -76,6 +108,30 @@ struct ClipboardHistoryItem {
     std::optional<std::string> originDeviceId;
 };
 
+// List/search projection. preview holds at most kHistoryPreviewCodePoints of
+// the text content (or of the OCR text for images); the full content is only
+// loaded through getItem.
+constexpr std::size_t kHistoryPreviewCodePoints = 200;
+
+struct ClipboardHistoryItemSummary {
+    HistoryItemId id;
+    ClipboardItemType type = ClipboardItemType::Text;
+    std::string preview;
+    std::string imagePath;
+    std::int32_t imageWidth = 0;
+    std::int32_t imageHeight = 0;
+    std::string imageFormat;
+    HistoryTimestampMs createTimeMs = 0;
+    HistoryTimestampMs updateTimeMs = 0;
+    HistoryTimestampMs lastCopyTimeMs = 0;
+    std::string sourceAppId;
+    std::string contentHash;
+    std::string metadata;
+    OcrStatus ocrStatus = OcrStatus::Pending;
+    OriginType originType = OriginType::LocalCopy;
+    std::optional<std::string> originDeviceId;
+};
+
 struct OcrTask {
     HistoryItemId id;
     std::string imagePath;
@@ -88,12 +144,19 @@ struct OcrTaskStatus {
     std::string text;
 };
 
+enum class SearchMode {
+    Token,
+    Substring,
+};
+
 struct SearchOptions {
     std::string query;
     std::size_t limit = 100;
     std::size_t previewLength = 200;
     std::string contentType;
     bool includeOcr = true;
+    bool rankByRelevance = false;
+    SearchMode mode = SearchMode::Token;
 };
 
 struct ClipboardHistoryListResult {
@@ -101,6 +164,11 @@ struct ClipboardHistoryListResult {
     std::string nextCursor;
 };
 
+struct ClipboardHistorySummaryListResult {
+    std::vector<ClipboardHistoryItemSummary> items;
+    std::string nextCursor;
+};
+
 inline bool isValidHistoryTimestamp(HistoryTimestampMs timestampMs) {
     return timestampMs > 0;
 }
@@ -17,6 +17,7 @@ bool pasty_runtime_start(
     const char* migration_directory,
     int default_max_history_count
 );
+// Writes everything queued by pasty_history_ingest_text_async before stopping.
 void pasty_runtime_stop(pasty_runtime_ref runtime);
 bool pasty_runtime_is_started(pasty_runtime_ref runtime);
 
@@ -35,6 +36,26 @@ void pasty_cloud_sync_e2ee_clear(pasty_runtime_ref runtime);
 bool pasty_history_ingest_text(pasty_runtime_ref runtime, const char* text, const char* source_app_id);
 bool pasty_history_ingest_text_with_result(pasty_runtime_ref runtime, const char* text, const char* source_app_id, bool* out_inserted);
 
+// Runs on the background writer once the item has been committed (or
+// rejected). id is empty when nothing was stored and is only valid during the
+// call.
+typedef void (*pasty_history_ingest_callback)(void* context, bool ok, bool inserted, const char* id);
+
+// Queues text for a background writer that commits queued items in batched
+// transactions, so the caller never waits on the database. Returns false
+// without queuing when the runtime is not started or the queue is full.
+// callback may be NULL. Items are committed and reported in call order.
+bool pasty_history_ingest_text_async(
+    pasty_runtime_ref runtime,
+    const char* text,
+    const char* source_app_id,
+    pasty_history_ingest_callback callback,
+    void* context
+);
+// Blocks until every item queued before the call has been committed and its
+// callback has run. Must not be called from a callback.
+bool pasty_history_ingest_flush(pasty_runtime_ref runtime);
+
 bool pasty_history_ingest_image(
     pasty_runtime_ref runtime,
     const unsigned char* bytes,
@@ -55,8 +76,47 @@ bool pasty_history_ingest_image_with_result(
     bool* out_inserted
 );
 
+// Streams one image in chunks instead of one contiguous buffer. Chunks are
+// hashed and written to a staging file as they arrive; commit stores the
+// image with the same dedupe rules as pasty_history_ingest_image_with_result.
+// commit and abort both release the stream handle, whatever their outcome.
+bool pasty_history_image_ingest_begin(
+    pasty_runtime_ref runtime,
+    int width,
+    int height,
+    const char* format_hint,
+    const char* source_app_id,
+    void** out_stream
+);
+bool pasty_history_image_ingest_append(void* stream, const unsigned char* bytes, unsigned long byte_count);
+bool pasty_history_image_ingest_commit(pasty_runtime_ref runtime, void* stream, bool* out_inserted);
+void pasty_history_image_ingest_abort(void* stream);
+
+// items_json is an array of {"text", "sourceAppId", "timestampMs"} objects. All
+// items are stored in one transaction; out_json receives one
+// {"ok", "inserted", "id"} object per input item, in input order.
+bool pasty_history_ingest_batch_json(pasty_runtime_ref runtime, const char* items_json, char** out_json);
+
+// List and search results are summaries: "content" (text) and "ocrText"
+// (images) hold a preview of at most 200 code points, also exposed as
+// "preview". pasty_history_get_json returns the full item.
 bool pasty_history_list_json(pasty_runtime_ref runtime, int limit, char** out_json);
 
+// Pages through history newest first. cursor is NULL or empty for the first
+// page, otherwise the opaque value returned in out_next_cursor by the previous
+// call. out_next_cursor is set to an empty string on the last page.
+bool pasty_history_list_page_json(
+    pasty_runtime_ref runtime,
+    int limit,
+    const char* cursor,
+    char** out_json,
+    char** out_next_cursor
+);
+
+// mode is "token" (word prefixes, the default for NULL or empty) or
+// "substring" (any run of characters). Token queries containing punctuation
+// or non-ASCII text are matched as substrings. rank_by_relevance orders
+// matches by bm25 instead of recency.
 bool pasty_history_search(
     pasty_runtime_ref runtime,
     const char* query,
@@ -64,6 +124,8 @@ bool pasty_history_search(
     int preview_length,
     const char* content_type,
     bool include_ocr,
+    const char* mode,
+    bool rank_by_relevance,
     char** out_json
 );
 
@@ -81,6 +143,29 @@ bool pasty_history_get_ocr_status(pasty_runtime_ref runtime, const char* id, cha
 
 bool pasty_history_get_json(pasty_runtime_ref runtime, const char* id, char** out_json);
 
+// Exposes the encoded bytes of an image item without copying them into a
+// string: file-backed images are memory-mapped read-only, inline images are
+// read out of the database once. *out_ptr and *out_len stay valid until
+// *out_handle is passed to pasty_history_release_image_bytes, even if the item
+// is deleted in between. Returns true with a NULL *out_handle when there is
+// no such image.
+bool pasty_history_get_image_bytes(
+    pasty_runtime_ref runtime,
+    const char* id,
+    const unsigned char** out_ptr,
+    size_t* out_len,
+    void** out_handle
+);
+void pasty_history_release_image_bytes(void* handle);
+
+// out_json receives {"enabled", "hits", "misses", "evictions", "size",
+// "capacity", "hitRate"} for the in-memory item cache.
+bool pasty_history_cache_stats_json(pasty_runtime_ref runtime, char** out_json);
+
+// out_json receives {"coalescedEvents", "coalesceWindowMs"}: repeat events
+// absorbed by the coalescing window since the runtime started.
+bool pasty_history_ingest_stats_json(pasty_runtime_ref runtime, char** out_json);
+
 bool pasty_history_get_tags(pasty_runtime_ref runtime, const char* id, char** out_json);
 
 bool pasty_history_set_tags(pasty_runtime_ref runtime, const char* id, const char* tags_json);
@@ -0,0 +1,66 @@
+-- Full-text search index over content, OCR text and tags.
+-- items_fts is an external-content FTS5 table backed by items_search_source,
+-- so the text is not stored twice. Triggers keep the index in sync; the
+-- 'delete' command must receive exactly the values that were indexed, which
+-- is why every trigger derives them from the same expressions as the view.
+-- items has no INTEGER PRIMARY KEY, so a VACUUM may renumber rowids; run
+-- INSERT INTO items_fts(items_fts) VALUES('rebuild') after any VACUUM.
+
+CREATE VIEW IF NOT EXISTS items_search_source(item_rowid, content, ocr_text, tags) AS
+SELECT
+    rowid,
+    COALESCE(content, ''),
+    COALESCE(ocr_text, ''),
+    CASE WHEN json_valid(metadata) THEN COALESCE(json_extract(metadata, '$.tags'), '') ELSE '' END
+FROM items;
+
+CREATE VIRTUAL TABLE IF NOT EXISTS items_fts USING fts5(
+    content,
+    ocr_text,
+    tags,
+    content = 'items_search_source',
+    content_rowid = 'item_rowid',
+    tokenize = 'unicode61 remove_diacritics 2'
+);
+
+CREATE TRIGGER IF NOT EXISTS items_fts_after_insert AFTER INSERT ON items BEGIN
+    INSERT INTO items_fts(rowid, content, ocr_text, tags) VALUES (
+        new.rowid,
+        COALESCE(new.content, ''),
+        COALESCE(new.ocr_text, ''),
+        CASE WHEN json_valid(new.metadata) THEN COALESCE(json_extract(new.metadata, '$.tags'), '') ELSE '' END
+    );
+END;
+
+CREATE TRIGGER IF NOT EXISTS items_fts_after_delete AFTER DELETE ON items BEGIN
+    INSERT INTO items_fts(items_fts, rowid, content, ocr_text, tags) VALUES (
+        'delete',
+        old.rowid,
+        COALESCE(old.content, ''),
+        COALESCE(old.ocr_text, ''),
+        CASE WHEN json_valid(old.metadata) THEN COALESCE(json_extract(old.metadata, '$.tags'), '') ELSE '' END
+    );
+END;
+
+CREATE TRIGGER IF NOT EXISTS items_fts_after_update AFTER UPDATE OF content, ocr_text, metadata ON items BEGIN
+    INSERT INTO items_fts(items_fts, rowid, content, ocr_text, tags) VALUES (
+        'delete',
+        old.rowid,
+        COALESCE(old.content, ''),
+        COALESCE(old.ocr_text, ''),
+        CASE WHEN json_valid(old.metadata) THEN COALESCE(json_extract(old.metadata, '$.tags'), '') ELSE '' END
+    );
+    INSERT INTO items_fts(rowid, content, ocr_text, tags) VALUES (
+        new.rowid,
+        COALESCE(new.content, ''),
+        COALESCE(new.ocr_text, ''),
+        CASE WHEN json_valid(new.metadata) THEN COALESCE(json_extract(new.metadata, '$.tags'), '') ELSE '' END
+    );
+END;
+
+INSERT INTO items_fts(items_fts) VALUES ('rebuild');
+
+-- The LIKE '%q%' search never used this index; it only cost writes.
+DROP INDEX IF EXISTS idx_items_content_search;
+
+PRAGMA user_version = 6;
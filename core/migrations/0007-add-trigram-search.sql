@@ -0,0 +1,51 @@
+-- Substring search index for identifiers, URLs and CJK text, where word
+-- tokenization does not split the text at the boundaries users search for.
+-- Shares items_search_source with items_fts; see 0006 for the trigger rules.
+
+CREATE VIRTUAL TABLE IF NOT EXISTS items_trigram USING fts5(
+    content,
+    ocr_text,
+    tags,
+    content = 'items_search_source',
+    content_rowid = 'item_rowid',
+    tokenize = 'trigram case_sensitive 0'
+);
+
+CREATE TRIGGER IF NOT EXISTS items_trigram_after_insert AFTER INSERT ON items BEGIN
+    INSERT INTO items_trigram(rowid, content, ocr_text, tags) VALUES (
+        new.rowid,
+        COALESCE(new.content, ''),
+        COALESCE(new.ocr_text, ''),
+        CASE WHEN json_valid(new.metadata) THEN COALESCE(json_extract(new.metadata, '$.tags'), '') ELSE '' END
+    );
+END;
+
+CREATE TRIGGER IF NOT EXISTS items_trigram_after_delete AFTER DELETE ON items BEGIN
+    INSERT INTO items_trigram(items_trigram, rowid, content, ocr_text, tags) VALUES (
+        'delete',
+        old.rowid,
+        COALESCE(old.content, ''),
+        COALESCE(old.ocr_text, ''),
+        CASE WHEN json_valid(old.metadata) THEN COALESCE(json_extract(old.metadata, '$.tags'), '') ELSE '' END
+    );
+END;
+
+CREATE TRIGGER IF NOT EXISTS items_trigram_after_update AFTER UPDATE OF content, ocr_text, metadata ON items BEGIN
+    INSERT INTO items_trigram(items_trigram, rowid, content, ocr_text, tags) VALUES (
+        'delete',
+        old.rowid,
+        COALESCE(old.content, ''),
+        COALESCE(old.ocr_text, ''),
+        CASE WHEN json_valid(old.metadata) THEN COALESCE(json_extract(old.metadata, '$.tags'), '') ELSE '' END
+    );
+    INSERT INTO items_trigram(rowid, content, ocr_text, tags) VALUES (
+        new.rowid,
+        COALESCE(new.content, ''),
+        COALESCE(new.ocr_text, ''),
+        CASE WHEN json_valid(new.metadata) THEN COALESCE(json_extract(new.metadata, '$.tags'), '') ELSE '' END
+    );
+END;
+
+INSERT INTO items_trigram(items_trigram) VALUES ('rebuild');
+
+PRAGMA user_version = 7;
@@ -0,0 +1,9 @@
+-- Keyset pagination orders history by (last_copy_time_ms, id) so rows copied in
+-- the same millisecond are neither skipped nor repeated across pages. The
+-- composite index serves both the seek and the sort; it supersedes the
+-- single-column index, which is dropped.
+
+CREATE INDEX IF NOT EXISTS idx_items_last_copy_time_id ON items(last_copy_time_ms DESC, id DESC);
+DROP INDEX IF EXISTS idx_items_last_copy_time;
+
+PRAGMA user_version = 8;
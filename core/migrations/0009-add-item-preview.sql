@@ -0,0 +1,23 @@
+-- List and search render a short preview instead of the full content. preview
+-- is filled at insert time (from content for text, from ocr_text for images)
+-- and is capped at 200 characters.
+--
+-- preview is appended after content, so reading it from the table would walk
+-- past large content payloads. The list index therefore carries every summary
+-- column, which lets list pages be served from the index alone. It extends
+-- idx_items_last_copy_time_id, which is dropped.
+
+ALTER TABLE items ADD COLUMN preview TEXT NOT NULL DEFAULT '';
+
+UPDATE items
+SET preview = substr(COALESCE(CASE WHEN type = 'image' THEN ocr_text ELSE content END, ''), 1, 200);
+
+CREATE INDEX IF NOT EXISTS idx_items_list_summary ON items(
+    last_copy_time_ms DESC, id DESC,
+    type, preview, image_path, image_width, image_height, image_format,
+    create_time_ms, update_time_ms, source_app_id, content_hash, metadata,
+    ocr_status, origin_type, origin_device_id
+);
+DROP INDEX IF EXISTS idx_items_last_copy_time_id;
+
+PRAGMA user_version = 9;
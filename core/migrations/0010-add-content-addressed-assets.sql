@@ -0,0 +1,68 @@
+-- Image assets are stored by content hash under two levels of fan-out
+-- directories (images/ab/cd/<hash>.<ext>) so identical bytes share one file
+-- and no directory grows past a few hundred entries. image_assets counts the
+-- rows referencing each file; the store only unlinks a file once its count
+-- reaches zero.
+--
+-- Existing rows are rewritten to the new layout here. The files themselves
+-- are moved by the store on the next open, driven by image_asset_moves; a row
+-- is removed from that table only after its file has been moved.
+
+CREATE TABLE IF NOT EXISTS image_assets (
+    path TEXT PRIMARY KEY,
+    ref_count INTEGER NOT NULL DEFAULT 0
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS image_asset_moves (
+    old_path TEXT PRIMARY KEY,
+    new_path TEXT NOT NULL
+) WITHOUT ROWID;
+
+CREATE TEMP TABLE legacy_asset_paths AS
+SELECT
+    id,
+    image_path AS old_path,
+    'images/'
+        || substr(COALESCE(NULLIF(content_hash, ''), id), 1, 2) || '/'
+        || substr(COALESCE(NULLIF(content_hash, ''), id), 3, 2) || '/'
+        || COALESCE(NULLIF(content_hash, ''), id)
+        || substr(image_path, instr(image_path, '.')) AS new_path
+FROM items
+WHERE image_path IS NOT NULL AND image_path NOT LIKE 'images/%/%';
+
+INSERT OR IGNORE INTO image_asset_moves(old_path, new_path)
+SELECT old_path, new_path FROM legacy_asset_paths;
+
+UPDATE items
+SET image_path = (SELECT new_path FROM legacy_asset_paths WHERE legacy_asset_paths.id = items.id)
+WHERE id IN (SELECT id FROM legacy_asset_paths);
+
+DROP TABLE legacy_asset_paths;
+
+INSERT INTO image_assets(path, ref_count)
+SELECT image_path, COUNT(*) FROM items WHERE image_path IS NOT NULL GROUP BY image_path;
+
+CREATE TRIGGER IF NOT EXISTS items_asset_ref_ai AFTER INSERT ON items
+WHEN NEW.image_path IS NOT NULL
+BEGIN
+    INSERT INTO image_assets(path, ref_count) VALUES (NEW.image_path, 1)
+    ON CONFLICT(path) DO UPDATE SET ref_count = ref_count + 1;
+END;
+
+CREATE TRIGGER IF NOT EXISTS items_asset_ref_ad AFTER DELETE ON items
+WHEN OLD.image_path IS NOT NULL
+BEGIN
+    UPDATE image_assets SET ref_count = ref_count - 1 WHERE path = OLD.image_path;
+    DELETE FROM image_assets WHERE path = OLD.image_path AND ref_count <= 0;
+END;
+
+CREATE TRIGGER IF NOT EXISTS items_asset_ref_au AFTER UPDATE OF image_path ON items
+WHEN OLD.image_path IS NOT NEW.image_path
+BEGIN
+    UPDATE image_assets SET ref_count = ref_count - 1 WHERE path = OLD.image_path;
+    DELETE FROM image_assets WHERE path = OLD.image_path AND ref_count <= 0;
+    INSERT INTO image_assets(path, ref_count) SELECT NEW.image_path, 1 WHERE NEW.image_path IS NOT NULL
+    ON CONFLICT(path) DO UPDATE SET ref_count = ref_count + 1;
+END;
+
+PRAGMA user_version = 10;
@@ -0,0 +1,9 @@
+-- Small images can be stored in the row itself instead of as a file under
+-- images/. Such rows keep image_path NULL (so they take no part in the
+-- image_assets counts) and carry the bytes in image_blob. The column is last
+-- in the row so reads of the other columns never walk its overflow pages;
+-- the store reads it incrementally through sqlite3_blob_open.
+
+ALTER TABLE items ADD COLUMN image_blob BLOB;
+
+PRAGMA user_version = 11;
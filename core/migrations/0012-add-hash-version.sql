@@ -0,0 +1,8 @@
+-- Records which content hashing scheme produced content_hash. Rows written
+-- before this column existed used FNV-1a 64 (version 1); the store rehashes
+-- them with the current scheme the next time it opens, so dedupe compares
+-- like with like.
+
+ALTER TABLE items ADD COLUMN hash_version INTEGER NOT NULL DEFAULT 1;
+
+PRAGMA user_version = 12;
@@ -0,0 +1,14 @@
+-- Maps a content hash produced under an older hashing scheme to the current
+-- content_hash of the same content. Rows are added when the store rehashes
+-- legacy items and when a peer still on an older scheme syncs an item, so
+-- that peer's deletes, tags and tombstones keep resolving to local rows.
+
+CREATE TABLE IF NOT EXISTS content_hash_aliases (
+    item_type TEXT NOT NULL,
+    legacy_hash TEXT NOT NULL,
+    hash_version INTEGER NOT NULL,
+    content_hash TEXT NOT NULL,
+    PRIMARY KEY (item_type, legacy_hash)
+) WITHOUT ROWID;
+
+PRAGMA user_version = 13;
@@ -2,14 +2,18 @@
 
 #include "runtime_json_api.h"
 
+#include "../application/history/clipboard_ingest_queue.h"
 #include "../common/logger.h"
 #include "../runtime/core_runtime.h"
 #include "../utils/runtime_json_utils.h"
 
+#include <algorithm>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <cstring>
+#include <vector>
 
 #include "../thirdparty/nlohmann/json.hpp"
 
@@ -21,6 +25,10 @@ struct PastyRuntime {
     mutable std::mutex mutex;
     pasty::CoreRuntimeConfig config;
     std::unique_ptr<pasty::CoreRuntime> runtime;
+    // Guards only the pointer below and is never held while writing, so an
+    // async ingest does not wait for a commit in progress.
+    std::mutex ingestQueueMutex;
+    std::shared_ptr<pasty::ClipboardIngestQueue> ingestQueue;
 
     PastyRuntime()
         : config()
@@ -39,6 +47,43 @@ pasty::ClipboardService* clipboardService(PastyRuntime* runtime) {
     return runtime->runtime->clipboardService();
 }
 
+// Runs on the ingest queue's writer thread: one transaction per batch, then
+// the same per-item export as the synchronous path.
+std::vector<pasty::ClipboardIngestResult> commitIngestBatch(
+    PastyRuntime* runtime,
+    const std::vector<pasty::ClipboardHistoryIngestEvent>& events
+) {
+    std::lock_guard<std::mutex> lock(runtime->mutex);
+    auto* service = clipboardService(runtime);
+    if (service == nullptr) {
+        return std::vector<pasty::ClipboardIngestResult>(events.size());
+    }
+
+    const std::vector<pasty::ClipboardIngestResult> results = service->ingestBatch(events);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        runtime->runtime->exportLocalTextIngest(events[i], results[i].inserted);
+    }
+    return results;
+}
+
+// Writes everything still queued for async ingest and retires the writer.
+// Must be called without runtime->mutex held; the writer takes it per batch.
+void drainIngestQueue(PastyRuntime* runtime) {
+    std::shared_ptr<pasty::ClipboardIngestQueue> queue;
+    {
+        std::lock_guard<std::mutex> lock(runtime->ingestQueueMutex);
+        queue = std::move(runtime->ingestQueue);
+    }
+    if (queue) {
+        queue->stop();
+    }
+}
+
+std::shared_ptr<pasty::ClipboardIngestQueue> ingestQueue(PastyRuntime* runtime) {
+    std::lock_guard<std::mutex> lock(runtime->ingestQueueMutex);
+    return runtime->ingestQueue;
+}
+
 bool parseBoolSetting(const std::string& value, bool* parsed) {
     if (parsed == nullptr) {
         return false;
@@ -92,6 +137,7 @@ void pasty_runtime_destroy(pasty_runtime_ref runtime_ref) {
         return;
     }
 
+    drainIngestQueue(runtime);
     {
         std::lock_guard<std::mutex> lock(runtime->mutex);
         if (runtime->runtime) {
@@ -114,6 +160,7 @@ bool pasty_runtime_start(
         return false;
     }
 
+    drainIngestQueue(runtime);
     std::lock_guard<std::mutex> lock(runtime->mutex);
 
     runtime->config.storageDirectory = storage_directory;
@@ -131,6 +178,19 @@ bool pasty_runtime_start(
         return false;
     }
 
+    if (runtime->config.historyIngestQueueCapacity > 0) {
+        pasty::ClipboardIngestQueueOptions queueOptions;
+        queueOptions.capacity = static_cast<std::size_t>(runtime->config.historyIngestQueueCapacity);
+        queueOptions.maxBatchSize = static_cast<std::size_t>(std::max(runtime->config.historyIngestBatchSize, 1));
+        auto queue = std::make_shared<pasty::ClipboardIngestQueue>(
+            [runtime](const std::vector<pasty::ClipboardHistoryIngestEvent>& events) {
+                return commitIngestBatch(runtime, events);
+            },
+            queueOptions);
+        std::lock_guard<std::mutex> queueLock(runtime->ingestQueueMutex);
+        runtime->ingestQueue = std::move(queue);
+    }
+
     return true;
 }
 
@@ -140,6 +200,7 @@ void pasty_runtime_stop(pasty_runtime_ref runtime_ref) {
         return;
     }
 
+    drainIngestQueue(runtime);
     std::lock_guard<std::mutex> lock(runtime->mutex);
     if (!runtime->runtime) {
         return;
@@ -381,6 +442,51 @@ bool pasty_history_ingest_text_with_result(
     return result.ok;
 }
 
+bool pasty_history_ingest_text_async(
+    pasty_runtime_ref runtime_ref,
+    const char* text,
+    const char* source_app_id,
+    pasty_history_ingest_callback callback,
+    void* context
+) {
+    PastyRuntime* runtime = castRuntime(runtime_ref);
+    if (runtime == nullptr) {
+        return false;
+    }
+
+    const std::shared_ptr<pasty::ClipboardIngestQueue> queue = ingestQueue(runtime);
+    if (!queue) {
+        return false;
+    }
+
+    pasty::ClipboardHistoryIngestEvent event;
+    event.timestampMs = pasty::runtime_json_utils::nowMs();
+    event.sourceAppId = pasty::runtime_json_utils::fromCString(source_app_id);
+    event.itemType = pasty::ClipboardItemType::Text;
+    event.text = pasty::runtime_json_utils::fromCString(text);
+    pasty::ClipboardIngestQueue::Completion completion;
+    if (callback != nullptr) {
+        completion = [callback, context](const pasty::ClipboardIngestResult& result) {
+            callback(context, result.ok, result.inserted, result.id.c_str());
+        };
+    }
+    return queue->enqueue(std::move(event), std::move(completion));
+}
+
+bool pasty_history_ingest_flush(pasty_runtime_ref runtime_ref) {
+    PastyRuntime* runtime = castRuntime(runtime_ref);
+    if (runtime == nullptr) {
+        return false;
+    }
+
+    const std::shared_ptr<pasty::ClipboardIngestQueue> queue = ingestQueue(runtime);
+    if (!queue) {
+        return false;
+    }
+    queue->flush();
+    return true;
+}
+
 bool pasty_history_ingest_image(
     pasty_runtime_ref runtime_ref,
     const unsigned char* bytes,
@@ -430,10 +536,81 @@ bool pasty_history_ingest_image_with_result(
     event.image.width = width;
     event.image.height = height;
     event.image.formatHint = pasty::runtime_json_utils::fromCString(format_hint);
-    event.image.bytes.assign(bytes, bytes + byte_count);
+    // Borrow the caller's buffer: the store and the exporter both read it in
+    // place, and the hash computed during ingest is reused for the export.
+    event.image.borrowedBytes = pasty::ImageBytesView(bytes, static_cast<std::size_t>(byte_count));
     const pasty::ClipboardIngestResult result = service->ingestWithResult(event);
     if (runtime->runtime) {
-        runtime->runtime->exportLocalImageIngest(event, result.inserted);
+        runtime->runtime->exportLocalImageIngest(event, result.inserted, result.contentHash);
+    }
+    if (out_inserted != nullptr) {
+        *out_inserted = result.inserted;
+    }
+    return result.ok;
+}
+
+bool pasty_history_image_ingest_begin(
+    pasty_runtime_ref runtime_ref,
+    int width,
+    int height,
+    const char* format_hint,
+    const char* source_app_id,
+    void** out_stream
+) {
+    PastyRuntime* runtime = castRuntime(runtime_ref);
+    if (runtime == nullptr || out_stream == nullptr) {
+        return false;
+    }
+    *out_stream = nullptr;
+
+    std::lock_guard<std::mutex> lock(runtime->mutex);
+    auto* service = clipboardService(runtime);
+    if (service == nullptr) {
+        return false;
+    }
+
+    pasty::ClipboardHistoryIngestEvent event;
+    event.timestampMs = pasty::runtime_json_utils::nowMs();
+    event.sourceAppId = pasty::runtime_json_utils::fromCString(source_app_id);
+    event.itemType = pasty::ClipboardItemType::Image;
+    event.image.width = width;
+    event.image.height = height;
+    event.image.formatHint = pasty::runtime_json_utils::fromCString(format_hint);
+    *out_stream = service->beginImageIngest(event).release();
+    return *out_stream != nullptr;
+}
+
+// Appends only touch the stream's own staging file, so they do not take the
+// runtime mutex.
+bool pasty_history_image_ingest_append(void* stream, const unsigned char* bytes, unsigned long byte_count) {
+    if (stream == nullptr || (bytes == nullptr && byte_count > 0)) {
+        return false;
+    }
+    return static_cast<pasty::ClipboardImageIngestStream*>(stream)->append(bytes, static_cast<std::size_t>(byte_count));
+}
+
+bool pasty_history_image_ingest_commit(pasty_runtime_ref runtime_ref, void* stream, bool* out_inserted) {
+    std::unique_ptr<pasty::ClipboardImageIngestStream> owned(static_cast<pasty::ClipboardImageIngestStream*>(stream));
+    PastyRuntime* runtime = castRuntime(runtime_ref);
+    if (runtime == nullptr || !owned) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(runtime->mutex);
+    auto* service = clipboardService(runtime);
+    if (service == nullptr) {
+        return false;
+    }
+
+    const pasty::ClipboardIngestResult result = service->commitImageIngest(*owned);
+    if (result.inserted && runtime->runtime) {
+        // The bytes now live in the store; export from a mapped view of them.
+        const std::unique_ptr<pasty::ClipboardImageBytes> bytes = service->openImageBytes(result.id);
+        if (bytes) {
+            pasty::ClipboardHistoryIngestEvent event = owned->event();
+            event.image.borrowedBytes = pasty::ImageBytesView(bytes->data(), bytes->size());
+            runtime->runtime->exportLocalImageIngest(event, result.inserted, result.contentHash);
+        }
     }
     if (out_inserted != nullptr) {
         *out_inserted = result.inserted;
@@ -441,6 +618,62 @@ bool pasty_history_ingest_image_with_result(
     return result.ok;
 }
 
+void pasty_history_image_ingest_abort(void* stream) {
+    delete static_cast<pasty::ClipboardImageIngestStream*>(stream);
+}
+
+bool pasty_history_ingest_batch_json(pasty_runtime_ref runtime_ref, const char* items_json, char** out_json) {
+    PastyRuntime* runtime = castRuntime(runtime_ref);
+    if (runtime == nullptr || items_json == nullptr || out_json == nullptr) {
+        return false;
+    }
+
+    using Json = nlohmann::json;
+    std::vector<pasty::ClipboardHistoryIngestEvent> events;
+    const std::int64_t nowMs = pasty::runtime_json_utils::nowMs();
+    try {
+        const Json json = Json::parse(items_json);
+        if (!json.is_array()) {
+            return false;
+        }
+        events.reserve(json.size());
+        for (const auto& entry : json) {
+            if (!entry.is_object() || !entry.contains("text") || !entry["text"].is_string()) {
+                return false;
+            }
+            pasty::ClipboardHistoryIngestEvent event;
+            event.timestampMs = entry.value("timestampMs", nowMs);
+            event.sourceAppId = entry.value("sourceAppId", std::string());
+            event.itemType = pasty::ClipboardItemType::Text;
+            event.text = entry["text"].get<std::string>();
+            events.push_back(std::move(event));
+        }
+    } catch (...) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(runtime->mutex);
+    auto* service = clipboardService(runtime);
+    if (service == nullptr) {
+        return false;
+    }
+
+    const std::vector<pasty::ClipboardIngestResult> results = service->ingestBatch(events);
+    Json payload = Json::array();
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        if (runtime->runtime) {
+            runtime->runtime->exportLocalTextIngest(events[i], results[i].inserted);
+        }
+        payload.push_back({
+            {"ok", results[i].ok},
+            {"inserted", results[i].inserted},
+            {"id", results[i].id},
+        });
+    }
+    *out_json = pasty::runtime_json_utils::copyString(payload.dump());
+    return true;
+}
+
 bool pasty_history_list_json(pasty_runtime_ref runtime_ref, int limit, char** out_json) {
     PastyRuntime* runtime = castRuntime(runtime_ref);
     if (runtime == nullptr || out_json == nullptr) {
@@ -453,13 +686,39 @@ bool pasty_history_list_json(pasty_runtime_ref runtime_ref, int limit, char** ou
         return false;
     }
 
-    const auto result = service->list(limit, std::string());
+    const auto result = service->listSummaries(limit, std::string());
     *out_json = pasty::runtime_json_utils::copyString(
-        pasty::runtime_json_utils::serializeItemsToJson(result.items)
+        pasty::runtime_json_utils::serializeSummariesToJson(result.items)
     );
     return true;
 }
 
+bool pasty_history_list_page_json(
+    pasty_runtime_ref runtime_ref,
+    int limit,
+    const char* cursor,
+    char** out_json,
+    char** out_next_cursor
+) {
+    PastyRuntime* runtime = castRuntime(runtime_ref);
+    if (runtime == nullptr || out_json == nullptr || out_next_cursor == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(runtime->mutex);
+    auto* service = clipboardService(runtime);
+    if (service == nullptr) {
+        return false;
+    }
+
+    const auto result = service->listSummaries(limit, pasty::runtime_json_utils::fromCString(cursor));
+    *out_json = pasty::runtime_json_utils::copyString(
+        pasty::runtime_json_utils::serializeSummariesToJson(result.items)
+    );
+    *out_next_cursor = pasty::runtime_json_utils::copyString(result.nextCursor);
+    return true;
+}
+
 bool pasty_history_search(
     pasty_runtime_ref runtime_ref,
     const char* query,
@@ -467,6 +726,8 @@ bool pasty_history_search(
     int preview_length,
     const char* content_type,
     bool include_ocr,
+    const char* mode,
+    bool rank_by_relevance,
     char** out_json
 ) {
     PastyRuntime* runtime = castRuntime(runtime_ref);
@@ -487,10 +748,14 @@ bool pasty_history_search(
     const std::string requestedContentType = pasty::runtime_json_utils::fromCString(content_type);
     options.contentType = (requestedContentType == "text" || requestedContentType == "image") ? requestedContentType : std::string();
     options.includeOcr = include_ocr;
+    options.mode = pasty::runtime_json_utils::fromCString(mode) == "substring"
+        ? pasty::SearchMode::Substring
+        : pasty::SearchMode::Token;
+    options.rankByRelevance = rank_by_relevance;
 
-    const std::vector<pasty::ClipboardHistoryItem> items = service->search(options);
+    const std::vector<pasty::ClipboardHistoryItemSummary> items = service->searchSummaries(options);
     *out_json = pasty::runtime_json_utils::copyString(
-        pasty::runtime_json_utils::serializeItemsToJson(items)
+        pasty::runtime_json_utils::serializeSummariesToJson(items)
     );
     return true;
 }
@@ -634,6 +899,90 @@ bool pasty_history_get_json(pasty_runtime_ref runtime_ref, const char* id, char*
     return true;
 }
 
+bool pasty_history_get_image_bytes(
+    pasty_runtime_ref runtime_ref,
+    const char* id,
+    const unsigned char** out_ptr,
+    size_t* out_len,
+    void** out_handle
+) {
+    PastyRuntime* runtime = castRuntime(runtime_ref);
+    if (runtime == nullptr || id == nullptr || out_ptr == nullptr || out_len == nullptr || out_handle == nullptr) {
+        return false;
+    }
+
+    *out_ptr = nullptr;
+    *out_len = 0;
+    *out_handle = nullptr;
+
+    std::lock_guard<std::mutex> lock(runtime->mutex);
+    auto* service = clipboardService(runtime);
+    if (service == nullptr) {
+        return false;
+    }
+
+    std::unique_ptr<pasty::ClipboardImageBytes> bytes = service->openImageBytes(pasty::runtime_json_utils::fromCString(id));
+    if (!bytes) {
+        return true;
+    }
+
+    *out_ptr = bytes->data();
+    *out_len = bytes->size();
+    *out_handle = bytes.release();
+    return true;
+}
+
+void pasty_history_release_image_bytes(void* handle) {
+    delete static_cast<pasty::ClipboardImageBytes*>(handle);
+}
+
+bool pasty_history_cache_stats_json(pasty_runtime_ref runtime_ref, char** out_json) {
+    PastyRuntime* runtime = castRuntime(runtime_ref);
+    if (runtime == nullptr || out_json == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(runtime->mutex);
+    if (!runtime->runtime || !runtime->runtime->isStarted()) {
+        return false;
+    }
+
+    using Json = nlohmann::json;
+
+    const auto stats = runtime->runtime->historyCacheStats();
+    Json json;
+    json["enabled"] = stats.has_value();
+    json["hits"] = stats ? stats->hits : 0;
+    json["misses"] = stats ? stats->misses : 0;
+    json["evictions"] = stats ? stats->evictions : 0;
+    json["size"] = stats ? stats->size : 0;
+    json["capacity"] = stats ? stats->capacity : 0;
+    json["hitRate"] = stats ? stats->hitRate() : 0.0;
+    *out_json = pasty::runtime_json_utils::copyString(json.dump());
+    return true;
+}
+
+bool pasty_history_ingest_stats_json(pasty_runtime_ref runtime_ref, char** out_json) {
+    PastyRuntime* runtime = castRuntime(runtime_ref);
+    if (runtime == nullptr || out_json == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(runtime->mutex);
+    auto* service = clipboardService(runtime);
+    if (service == nullptr) {
+        return false;
+    }
+
+    using Json = nlohmann::json;
+
+    Json json;
+    json["coalescedEvents"] = service->coalescedEventCount();
+    json["coalesceWindowMs"] = runtime->config.historyCoalesceWindowMs;
+    *out_json = pasty::runtime_json_utils::copyString(json.dump());
+    return true;
+}
+
 bool pasty_history_get_tags(pasty_runtime_ref runtime_ref, const char* id, char** out_json) {
     PastyRuntime* runtime = castRuntime(runtime_ref);
     if (runtime == nullptr || id == nullptr || out_json == nullptr) {
@@ -0,0 +1,98 @@
+#include "application/history/clipboard_ingest_queue.h"
+
+#include <utility>
+
+namespace pasty {
+
+ClipboardIngestQueue::ClipboardIngestQueue(BatchWriter writer, ClipboardIngestQueueOptions options)
+    : m_writer(std::move(writer))
+    , m_options(options)
+    , m_accepted(0)
+    , m_completed(0)
+    , m_stopping(false) {
+    if (m_options.capacity == 0) {
+        m_options.capacity = 1;
+    }
+    if (m_options.maxBatchSize == 0) {
+        m_options.maxBatchSize = 1;
+    }
+    m_thread = std::thread(&ClipboardIngestQueue::run, this);
+}
+
+ClipboardIngestQueue::~ClipboardIngestQueue() {
+    stop();
+}
+
+bool ClipboardIngestQueue::enqueue(ClipboardHistoryIngestEvent event, Completion completion) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping || m_queue.size() >= m_options.capacity) {
+            return false;
+        }
+        m_queue.push_back(Entry{std::move(event), std::move(completion)});
+        ++m_accepted;
+    }
+    m_pending.notify_one();
+    return true;
+}
+
+void ClipboardIngestQueue::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const std::uint64_t target = m_accepted;
+    m_written.wait(lock, [&]() { return m_completed >= target; });
+}
+
+void ClipboardIngestQueue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_pending.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+std::size_t ClipboardIngestQueue::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<std::size_t>(m_accepted - m_completed);
+}
+
+// Takes everything queued (up to the batch size) in one go; events that
+// arrive while a batch is being written form the next one. The queue lock is
+// never held while writing or running completions.
+void ClipboardIngestQueue::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_pending.wait(lock, [&]() { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            return;
+        }
+
+        std::vector<Entry> batch;
+        while (!m_queue.empty() && batch.size() < m_options.maxBatchSize) {
+            batch.push_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+        lock.unlock();
+
+        std::vector<ClipboardHistoryIngestEvent> events;
+        events.reserve(batch.size());
+        for (Entry& entry : batch) {
+            events.push_back(std::move(entry.event));
+        }
+        std::vector<ClipboardIngestResult> results = m_writer(events);
+        results.resize(events.size());
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (batch[i].completion) {
+                batch[i].completion(results[i]);
+            }
+        }
+
+        lock.lock();
+        m_completed += batch.size();
+        m_written.notify_all();
+    }
+}
+
+} // namespace pasty
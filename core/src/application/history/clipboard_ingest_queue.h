@@ -0,0 +1,84 @@
+#pragma once
+
+#include "application/history/clipboard_service.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pasty {
+
+struct ClipboardIngestQueueOptions {
+    // Events waiting for the writer; enqueue() fails instead of blocking once
+    // this many are queued.
+    std::size_t capacity = 1024;
+    // Upper bound on events handed to the batch writer at once.
+    std::size_t maxBatchSize = 64;
+};
+
+/**
+ * ClipboardIngestQueue - Write-behind ingest for callers that must not wait
+ * on disk, such as a clipboard watcher thread.
+ *
+ * enqueue() only appends to a bounded in-memory queue. A dedicated writer
+ * thread takes whatever has accumulated (up to maxBatchSize), hands it to the
+ * batch writer as one batch, which commits it in one transaction, and then
+ * runs each event's completion with its result. Events are written and
+ * completed in enqueue order.
+ *
+ * Thread-safety: enqueue(), flush() and stop() may be called from any thread
+ * except the writer thread, i.e. not from a completion.
+ */
+class ClipboardIngestQueue {
+public:
+    using Completion = std::function<void(const ClipboardIngestResult&)>;
+    // Writes one batch and returns one result per event, in order.
+    using BatchWriter = std::function<std::vector<ClipboardIngestResult>(const std::vector<ClipboardHistoryIngestEvent>&)>;
+
+    explicit ClipboardIngestQueue(BatchWriter writer, ClipboardIngestQueueOptions options = ClipboardIngestQueueOptions{});
+    // stop()s the queue, so everything accepted is still written.
+    ~ClipboardIngestQueue();
+
+    ClipboardIngestQueue(const ClipboardIngestQueue&) = delete;
+    ClipboardIngestQueue& operator=(const ClipboardIngestQueue&) = delete;
+
+    // Returns false, without running completion, when the queue is full or
+    // stopped. completion may be empty.
+    bool enqueue(ClipboardHistoryIngestEvent event, Completion completion);
+    // Blocks until every event accepted before the call has been written and
+    // its completion has run.
+    void flush();
+    // Rejects new events, writes everything already accepted and joins the
+    // writer thread. Safe to call more than once.
+    void stop();
+
+    std::size_t pending() const;
+
+private:
+    struct Entry {
+        ClipboardHistoryIngestEvent event;
+        Completion completion;
+    };
+
+    void run();
+
+    BatchWriter m_writer;
+    ClipboardIngestQueueOptions m_options;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_pending;
+    std::condition_variable m_written;
+    std::deque<Entry> m_queue;
+    // Events accepted and events completed since construction; flush() waits
+    // for the second to catch up with the first.
+    std::uint64_t m_accepted;
+    std::uint64_t m_completed;
+    bool m_stopping;
+    std::thread m_thread;
+};
+
+} // namespace pasty
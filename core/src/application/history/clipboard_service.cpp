@@ -2,81 +2,126 @@
 
 #include <common/logger.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
-#include <iomanip>
-#include <sstream>
+#include <cstdio>
+#include <utility>
 
 namespace pasty {
 
 namespace {
 
-constexpr std::uint64_t kFnvOffset = 1469598103934665603ULL;
-constexpr std::uint64_t kFnvPrime = 1099511628211ULL;
+// Skipped events succeed without storing anything.
+ClipboardIngestResult skippedIngestResult() {
+    ClipboardIngestResult result;
+    result.ok = true;
+    return result;
+}
 
-std::string normalizeTextForHash(const std::string& text) {
-    std::string normalized;
-    normalized.reserve(text.size());
+ClipboardIngestResult storedIngestResult(bool ok, bool inserted, const std::string& id, const std::string& contentHash) {
+    ClipboardIngestResult result;
+    result.ok = ok;
+    result.inserted = inserted;
+    result.id = id;
+    result.contentHash = contentHash;
+    return result;
+}
 
-    for (std::size_t i = 0; i < text.size(); ++i) {
-        if (text[i] == '\r') {
-            if (i + 1 < text.size() && text[i + 1] == '\n') {
-                continue;
-            }
-            normalized.push_back('\n');
-            continue;
-        }
-        normalized.push_back(text[i]);
-    }
+std::int64_t currentTimeMs() {
+    const auto now = std::chrono::system_clock::now();
+    const auto value = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
+    return static_cast<std::int64_t>(value.count());
+}
 
-    return normalized;
+std::string makeItemId(std::int64_t timestampMs, const std::string& sourceAppId, const std::string& contentHash) {
+    const std::string seed = sourceAppId + ":" + contentHash + ":" + std::to_string(timestampMs);
+    return content_hash::hashBytes(seed.data(), seed.size());
 }
 
-std::uint64_t hashBytes(const std::uint8_t* bytes, std::size_t length) {
-    std::uint64_t hash = kFnvOffset;
-    for (std::size_t i = 0; i < length; ++i) {
-        hash ^= static_cast<std::uint64_t>(bytes[i]);
-        hash *= kFnvPrime;
+bool shouldSkipEvent(const ClipboardHistoryIngestEvent& event) {
+    if (event.flags.isFileOrFolderReference || event.flags.isTransient || event.flags.isConcealed) {
+        PASTY_LOG_INFO("Core.History", "Skipped item. Flags: file=%d transient=%d concealed=%d",
+            event.flags.isFileOrFolderReference, event.flags.isTransient, event.flags.isConcealed);
+        return true;
     }
-    return hash;
+    return false;
 }
 
-std::string toHex(std::uint64_t value) {
-    std::ostringstream stream;
-    stream << std::hex << std::setfill('0') << std::setw(16) << value;
-    return stream.str();
+ClipboardHistoryItem makeHistoryItem(const ClipboardHistoryIngestEvent& event, const std::string& contentHash) {
+    ClipboardHistoryItem item;
+    const std::int64_t eventTimeMs = event.timestampMs > 0 ? event.timestampMs : currentTimeMs();
+
+    item.type = event.itemType;
+    item.content = event.text;
+    item.imageWidth = event.image.width;
+    item.imageHeight = event.image.height;
+    item.imageFormat = event.image.formatHint;
+    item.createTimeMs = eventTimeMs;
+    item.updateTimeMs = eventTimeMs;
+    item.lastCopyTimeMs = eventTimeMs;
+    item.sourceAppId = event.sourceAppId;
+    item.originType = event.originType;
+    item.originDeviceId = event.originDeviceId;
+    item.contentHash = contentHash;
+    item.id = makeItemId(item.lastCopyTimeMs, item.sourceAppId, item.contentHash);
+    return item;
+}
+
+ClipboardHistoryItem makeHistoryItem(const ClipboardHistoryIngestEvent& event) {
+    return makeHistoryItem(event, (event.itemType == ClipboardItemType::Image)
+        ? content_hash::computeImageHash(event.image.view())
+        : content_hash::computeTextHash(event.text));
 }
 
-std::string computeTextHash(const std::string& text) {
-    const std::string normalized = normalizeTextForHash(text);
-    return toHex(hashBytes(reinterpret_cast<const std::uint8_t*>(normalized.data()), normalized.size()));
+} // namespace
+
+ClipboardImageIngestStream::ClipboardImageIngestStream(ClipboardHistoryIngestEvent event, std::string stagingPath)
+    : m_event(std::move(event))
+    , m_stagingPath(std::move(stagingPath))
+    , m_file(m_stagingPath, std::ios::binary | std::ios::trunc)
+    , m_size(0)
+    , m_consumed(false) {
 }
 
-std::string computeImageHash(const std::vector<std::uint8_t>& bytes) {
-    if (bytes.empty()) {
-        return std::string();
+ClipboardImageIngestStream::~ClipboardImageIngestStream() {
+    if (!m_consumed) {
+        m_file.close();
+        std::remove(m_stagingPath.c_str());
     }
-    return toHex(hashBytes(bytes.data(), bytes.size()));
 }
 
-std::int64_t currentTimeMs() {
-    const auto now = std::chrono::system_clock::now();
-    const auto value = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
-    return static_cast<std::int64_t>(value.count());
+bool ClipboardImageIngestStream::append(const std::uint8_t* data, std::size_t size) {
+    if (m_consumed || !m_file) {
+        return false;
+    }
+    if (size == 0) {
+        return true;
+    }
+    if (!m_file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size))) {
+        PASTY_LOG_ERROR("Core.History", "Failed to append %zu bytes to streamed image", size);
+        return false;
+    }
+    m_hasher.update(data, size);
+    m_size += size;
+    return true;
 }
 
-std::string makeItemId(std::int64_t timestampMs, const std::string& sourceAppId, const std::string& contentHash) {
-    const std::string seed = sourceAppId + ":" + contentHash + ":" + std::to_string(timestampMs);
-    const std::uint64_t hashed = hashBytes(reinterpret_cast<const std::uint8_t*>(seed.data()), seed.size());
-    return toHex(hashed);
+std::size_t ClipboardImageIngestStream::size() const {
+    return m_size;
 }
 
-} // namespace
+const ClipboardHistoryIngestEvent& ClipboardImageIngestStream::event() const {
+    return m_event;
+}
 
-ClipboardService::ClipboardService(std::unique_ptr<ClipboardHistoryStore> store, SettingsStore& settingsStore)
+ClipboardService::ClipboardService(std::unique_ptr<ClipboardHistoryStore> store, SettingsStore& settingsStore,
+    ClipboardServiceOptions options)
     : m_store(std::move(store))
     , m_settingsStore(settingsStore)
-    , m_initialized(false) {
+    , m_options(options)
+    , m_initialized(false)
+    , m_coalescedEvents(0) {
 }
 
 bool ClipboardService::initialize(const std::string& baseDirectory) {
@@ -101,6 +146,7 @@ void ClipboardService::shutdown() {
         return;
     }
 
+    resetCoalescing();
     m_store->close();
     m_initialized = false;
 }
@@ -118,47 +164,133 @@ ClipboardIngestResult ClipboardService::ingestWithResult(const ClipboardHistoryI
         return {};
     }
 
-    if (event.flags.isFileOrFolderReference || event.flags.isTransient || event.flags.isConcealed) {
-        PASTY_LOG_INFO("Core.History", "Skipped item. Flags: file=%d transient=%d concealed=%d",
-            event.flags.isFileOrFolderReference, event.flags.isTransient, event.flags.isConcealed);
-        return ClipboardIngestResult{true, false};
+    if (shouldSkipEvent(event)) {
+        return skippedIngestResult();
     }
 
-    ClipboardHistoryItem item;
-    const std::int64_t eventTimeMs = event.timestampMs > 0 ? event.timestampMs : currentTimeMs();
+    const ClipboardHistoryItem item = makeHistoryItem(event);
+    if (auto absorbed = tryCoalesce(item)) {
+        return *absorbed;
+    }
 
-    item.type = event.itemType;
-    item.content = event.text;
-    item.imageWidth = event.image.width;
-    item.imageHeight = event.image.height;
-    item.imageFormat = event.image.formatHint;
-    item.createTimeMs = eventTimeMs;
-    item.updateTimeMs = eventTimeMs;
-    item.lastCopyTimeMs = eventTimeMs;
-    item.sourceAppId = event.sourceAppId;
-    item.originType = event.originType;
-    item.originDeviceId = event.originDeviceId;
+    resetCoalescing();
+    const ClipboardHistoryUpsertResult upsertResult = (event.itemType == ClipboardItemType::Image)
+        ? m_store->upsertImageItem(item, event.image.view())
+        : m_store->upsertTextItem(item);
+    if (upsertResult.id.empty()) {
+        return {};
+    }
+    rememberStored(item, upsertResult.id);
+
+    const bool retentionOk = applyRetentionFromSettings();
+    return storedIngestResult(retentionOk, retentionOk && upsertResult.inserted, upsertResult.id, item.contentHash);
+}
+
+std::vector<ClipboardIngestResult> ClipboardService::ingestBatch(const std::vector<ClipboardHistoryIngestEvent>& events) {
+    std::vector<ClipboardIngestResult> results(events.size());
+    if (!m_initialized || !m_store || events.empty()) {
+        return results;
+    }
+
+    std::vector<ClipboardHistoryUpsertRequest> requests;
+    std::vector<std::size_t> requestIndexes;
+    requests.reserve(events.size());
+    requestIndexes.reserve(events.size());
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        const ClipboardHistoryIngestEvent& event = events[i];
+        if (shouldSkipEvent(event)) {
+            results[i] = skippedIngestResult();
+            continue;
+        }
 
-    if (event.itemType == ClipboardItemType::Image) {
-        item.contentHash = computeImageHash(event.image.bytes);
-        item.id = makeItemId(item.lastCopyTimeMs, item.sourceAppId, item.contentHash);
-        const ClipboardHistoryUpsertResult upsertResult = m_store->upsertImageItem(item, event.image.bytes);
+        ClipboardHistoryUpsertRequest request;
+        request.item = makeHistoryItem(event);
+        if (auto absorbed = tryCoalesce(request.item)) {
+            results[i] = *absorbed;
+            continue;
+        }
+        // Once anything else is stored the slot's item is no longer the
+        // newest, so later repeats in this batch go to the store.
+        resetCoalescing();
+        if (event.itemType == ClipboardItemType::Image) {
+            request.imageBytes = event.image.view();
+        }
+        requests.push_back(std::move(request));
+        requestIndexes.push_back(i);
+    }
+
+    if (requests.empty()) {
+        return results;
+    }
+
+    // The store has already swept retention inside the batch transaction with
+    // its current limit; this only picks up a changed setting.
+    const std::vector<ClipboardHistoryUpsertResult> upsertResults = m_store->upsertItems(requests);
+    const bool retentionOk = applyRetentionFromSettings();
+    for (std::size_t i = 0; i < upsertResults.size() && i < requestIndexes.size(); ++i) {
+        const ClipboardHistoryUpsertResult& upsertResult = upsertResults[i];
         if (upsertResult.id.empty()) {
-            return {};
+            continue;
         }
-        const bool retentionOk = applyRetentionFromSettings();
-        return ClipboardIngestResult{retentionOk, retentionOk && upsertResult.inserted};
+        results[requestIndexes[i]] = storedIngestResult(
+            retentionOk, retentionOk && upsertResult.inserted, upsertResult.id, requests[i].item.contentHash);
+    }
+    if (!upsertResults.empty() && upsertResults.size() == requests.size() && !upsertResults.back().id.empty()) {
+        rememberStored(requests.back().item, upsertResults.back().id);
     }
 
-    item.contentHash = computeTextHash(event.text);
-    item.id = makeItemId(item.lastCopyTimeMs, item.sourceAppId, item.contentHash);
-    const ClipboardHistoryUpsertResult upsertResult = m_store->upsertTextItem(item);
+    PASTY_LOG_DEBUG("Core.History", "Batch ingest finished. events=%zu stored=%zu", events.size(), requests.size());
+    return results;
+}
+
+std::unique_ptr<ClipboardImageIngestStream> ClipboardService::beginImageIngest(const ClipboardHistoryIngestEvent& event) {
+    if (!m_initialized || !m_store) {
+        return nullptr;
+    }
+
+    ClipboardHistoryIngestEvent metadata = event;
+    metadata.itemType = ClipboardItemType::Image;
+    metadata.image.bytes.clear();
+    metadata.image.borrowedBytes = ImageBytesView();
+    std::unique_ptr<ClipboardImageIngestStream> stream(
+        new ClipboardImageIngestStream(std::move(metadata), m_store->reserveStagingPath()));
+    if (!stream->m_file) {
+        PASTY_LOG_ERROR("Core.History", "Failed to open staging file for streamed image");
+        return nullptr;
+    }
+    return stream;
+}
+
+ClipboardIngestResult ClipboardService::commitImageIngest(ClipboardImageIngestStream& stream) {
+    if (stream.m_consumed) {
+        return {};
+    }
+    stream.m_file.close();
+    if (!m_initialized || !m_store || stream.m_file.fail() || stream.m_size == 0) {
+        return {};
+    }
+
+    if (shouldSkipEvent(stream.m_event)) {
+        return skippedIngestResult();
+    }
+
+    const ClipboardHistoryItem item = makeHistoryItem(stream.m_event, stream.m_hasher.finish());
+    if (auto absorbed = tryCoalesce(item)) {
+        // The stream still owns its staging file and removes it.
+        return *absorbed;
+    }
+
+    resetCoalescing();
+    stream.m_consumed = true;
+    const ClipboardHistoryUpsertResult upsertResult = m_store->upsertStagedImageItem(item, stream.m_stagingPath);
     if (upsertResult.id.empty()) {
         return {};
     }
+    rememberStored(item, upsertResult.id);
 
     const bool retentionOk = applyRetentionFromSettings();
-    return ClipboardIngestResult{retentionOk, retentionOk && upsertResult.inserted};
+    PASTY_LOG_DEBUG("Core.History", "Streamed image committed. bytes=%zu inserted=%d", stream.m_size, upsertResult.inserted);
+    return storedIngestResult(retentionOk, retentionOk && upsertResult.inserted, upsertResult.id, item.contentHash);
 }
 
 ClipboardHistoryListResult ClipboardService::list(std::int32_t limit, const std::string& cursor) {
@@ -166,6 +298,7 @@ ClipboardHistoryListResult ClipboardService::list(std::int32_t limit, const std:
         return ClipboardHistoryListResult{};
     }
 
+    flushCoalescedCopyTime();
     return m_store->listItems(limit, cursor);
 }
 
@@ -174,9 +307,28 @@ std::vector<ClipboardHistoryItem> ClipboardService::search(const SearchOptions&
         return {};
     }
 
+    flushCoalescedCopyTime();
     return m_store->search(options);
 }
 
+ClipboardHistorySummaryListResult ClipboardService::listSummaries(std::int32_t limit, const std::string& cursor) {
+    if (!m_initialized || !m_store) {
+        return ClipboardHistorySummaryListResult{};
+    }
+
+    flushCoalescedCopyTime();
+    return m_store->listItemSummaries(limit, cursor);
+}
+
+std::vector<ClipboardHistoryItemSummary> ClipboardService::searchSummaries(const SearchOptions& options) {
+    if (!m_initialized || !m_store) {
+        return {};
+    }
+
+    flushCoalescedCopyTime();
+    return m_store->searchSummaries(options);
+}
+
 std::vector<OcrTask> ClipboardService::getPendingOcrImages(std::int32_t limit) {
     if (!m_initialized || !m_store) {
         return {};
@@ -230,14 +382,24 @@ std::optional<ClipboardHistoryItem> ClipboardService::getById(const std::string&
         return std::nullopt;
     }
 
+    flushCoalescedCopyTime();
     return m_store->getItem(id);
 }
 
+std::unique_ptr<ClipboardImageBytes> ClipboardService::openImageBytes(const std::string& id) {
+    if (!m_initialized || !m_store) {
+        return nullptr;
+    }
+
+    return m_store->openImageBytes(id);
+}
+
 std::optional<ClipboardHistoryItem> ClipboardService::getByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash) {
     if (!m_initialized || !m_store) {
         return std::nullopt;
     }
 
+    flushCoalescedCopyTime();
     return m_store->getItemByTypeAndContentHash(type, contentHash);
 }
 
@@ -246,6 +408,7 @@ bool ClipboardService::deleteById(const std::string& id) {
         return false;
     }
 
+    resetCoalescing();
     return m_store->deleteItem(id);
 }
 
@@ -254,9 +417,29 @@ int ClipboardService::deleteByTypeAndContentHash(ClipboardItemType type, const s
         return 0;
     }
 
+    resetCoalescing();
     return m_store->deleteByTypeAndContentHash(type, contentHash);
 }
 
+bool ClipboardService::recordContentHashAlias(ClipboardItemType type,
+                                              const std::string& legacyHash,
+                                              std::int32_t hashVersion,
+                                              const std::string& contentHash) {
+    if (!m_initialized || !m_store) {
+        return false;
+    }
+
+    return m_store->recordContentHashAlias(type, legacyHash, hashVersion, contentHash);
+}
+
+std::string ClipboardService::resolveContentHash(ClipboardItemType type, const std::string& contentHash) {
+    if (!m_initialized || !m_store) {
+        return contentHash;
+    }
+
+    return m_store->resolveContentHash(type, contentHash);
+}
+
 std::vector<std::string> ClipboardService::getTags(const std::string& id) {
     if (!m_initialized || !m_store || id.empty()) {
         return {};
@@ -303,4 +486,61 @@ bool ClipboardService::enforceRetention(std::int32_t maxCount) {
     return m_store->enforceRetention(maxCount);
 }
 
+std::uint64_t ClipboardService::coalescedEventCount() const {
+    return m_coalescedEvents;
+}
+
+// A repeat is absorbed only if it matches the slot in everything a dedupe
+// upsert would write besides the copy time, and no retention sweep ran since
+// the slot's item was stored (the sweep might have removed it).
+std::optional<ClipboardIngestResult> ClipboardService::tryCoalesce(const ClipboardHistoryItem& item) {
+    if (m_options.coalesceWindowMs <= 0 || !m_coalesce) {
+        return std::nullopt;
+    }
+
+    CoalesceSlot& slot = *m_coalesce;
+    const std::int64_t sinceStoredMs = item.lastCopyTimeMs - slot.windowStartMs;
+    if (slot.type != item.type || slot.contentHash != item.contentHash || slot.sourceAppId != item.sourceAppId
+        || slot.originType != item.originType || sinceStoredMs < 0 || sinceStoredMs >= m_options.coalesceWindowMs
+        || slot.retentionGeneration != m_store->retentionGeneration()) {
+        return std::nullopt;
+    }
+
+    slot.pendingCopyTimeMs = std::max(slot.pendingCopyTimeMs, item.lastCopyTimeMs);
+    ++m_coalescedEvents;
+    return storedIngestResult(true, false, slot.id, slot.contentHash);
+}
+
+void ClipboardService::rememberStored(const ClipboardHistoryItem& item, const std::string& id) {
+    if (m_options.coalesceWindowMs <= 0) {
+        return;
+    }
+
+    CoalesceSlot slot;
+    slot.type = item.type;
+    slot.contentHash = item.contentHash;
+    slot.sourceAppId = item.sourceAppId;
+    slot.originType = item.originType;
+    slot.id = id;
+    slot.windowStartMs = item.lastCopyTimeMs;
+    slot.writtenCopyTimeMs = item.lastCopyTimeMs;
+    slot.pendingCopyTimeMs = item.lastCopyTimeMs;
+    slot.retentionGeneration = m_store->retentionGeneration();
+    m_coalesce = std::move(slot);
+}
+
+void ClipboardService::flushCoalescedCopyTime() {
+    if (!m_coalesce || m_coalesce->pendingCopyTimeMs <= m_coalesce->writtenCopyTimeMs) {
+        return;
+    }
+
+    m_store->updateLastCopyTime(m_coalesce->id, m_coalesce->pendingCopyTimeMs);
+    m_coalesce->writtenCopyTimeMs = m_coalesce->pendingCopyTimeMs;
+}
+
+void ClipboardService::resetCoalescing() {
+    flushCoalescedCopyTime();
+    m_coalesce.reset();
+}
+
 } // namespace pasty
@@ -2,8 +2,12 @@
 
 #include "history/clipboard_history_store.h"
 #include "ports/settings_store.h"
+#include "utils/content_hash.h"
 #include "utils/metadata_utils.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
 #include <memory>
 #include <optional>
 #include <string>
@@ -14,11 +18,52 @@ namespace pasty {
 struct ClipboardIngestResult {
     bool ok = false;
     bool inserted = false;
+    std::string id;
+    // Hash of the ingested content, so callers such as the sync exporter do not
+    // have to read the bytes a second time.
+    std::string contentHash;
+};
+
+// One image being ingested in chunks. Bytes are appended to a staging file of
+// the store and hashed as they arrive, so the image is never held in memory
+// as a whole. A stream that is destroyed without being committed removes its
+// file. A stream must not be used from two threads at once.
+class ClipboardImageIngestStream {
+public:
+    ~ClipboardImageIngestStream();
+
+    ClipboardImageIngestStream(const ClipboardImageIngestStream&) = delete;
+    ClipboardImageIngestStream& operator=(const ClipboardImageIngestStream&) = delete;
+
+    bool append(const std::uint8_t* data, std::size_t size);
+    std::size_t size() const;
+    // The metadata given to beginImageIngest(); its image carries no bytes.
+    const ClipboardHistoryIngestEvent& event() const;
+
+private:
+    friend class ClipboardService;
+
+    ClipboardImageIngestStream(ClipboardHistoryIngestEvent event, std::string stagingPath);
+
+    ClipboardHistoryIngestEvent m_event;
+    std::string m_stagingPath;
+    std::ofstream m_file;
+    content_hash::ImageHasher m_hasher;
+    std::size_t m_size;
+    bool m_consumed;
+};
+
+struct ClipboardServiceOptions {
+    // Repeats of the most recently stored item within this many milliseconds
+    // of it being stored are absorbed without touching the store; 0 disables
+    // coalescing. See ClipboardService::coalescedEventCount().
+    std::int64_t coalesceWindowMs = 0;
 };
 
 class ClipboardService {
 public:
-    ClipboardService(std::unique_ptr<ClipboardHistoryStore> store, SettingsStore& settingsStore);
+    ClipboardService(std::unique_ptr<ClipboardHistoryStore> store, SettingsStore& settingsStore,
+        ClipboardServiceOptions options = ClipboardServiceOptions{});
 
     bool initialize(const std::string& baseDirectory);
     void shutdown();
@@ -26,8 +71,16 @@ public:
 
     bool ingest(const ClipboardHistoryIngestEvent& event);
     ClipboardIngestResult ingestWithResult(const ClipboardHistoryIngestEvent& event);
+    std::vector<ClipboardIngestResult> ingestBatch(const std::vector<ClipboardHistoryIngestEvent>& events);
+    // Streaming image ingest. event supplies everything but the bytes, which
+    // are appended to the returned stream. Committing consumes the stream's
+    // file; the result matches ingestWithResult() for the same bytes.
+    std::unique_ptr<ClipboardImageIngestStream> beginImageIngest(const ClipboardHistoryIngestEvent& event);
+    ClipboardIngestResult commitImageIngest(ClipboardImageIngestStream& stream);
     ClipboardHistoryListResult list(std::int32_t limit, const std::string& cursor);
     std::vector<ClipboardHistoryItem> search(const SearchOptions& options);
+    ClipboardHistorySummaryListResult listSummaries(std::int32_t limit, const std::string& cursor);
+    std::vector<ClipboardHistoryItemSummary> searchSummaries(const SearchOptions& options);
     std::vector<OcrTask> getPendingOcrImages(std::int32_t limit);
     std::optional<OcrTask> getNextOcrTask();
     bool markOcrProcessing(const std::string& id);
@@ -36,8 +89,16 @@ public:
     std::optional<OcrTaskStatus> getOcrStatus(const std::string& id);
     std::optional<ClipboardHistoryItem> getById(const std::string& id);
     std::optional<ClipboardHistoryItem> getByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash);
+    std::unique_ptr<ClipboardImageBytes> openImageBytes(const std::string& id);
     bool deleteById(const std::string& id);
     int deleteByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash);
+    // Aliases for hashes of an older content hash version; see
+    // ClipboardHistoryStore::recordContentHashAlias().
+    bool recordContentHashAlias(ClipboardItemType type,
+                                const std::string& legacyHash,
+                                std::int32_t hashVersion,
+                                const std::string& contentHash);
+    std::string resolveContentHash(ClipboardItemType type, const std::string& contentHash);
 
     std::vector<std::string> getTags(const std::string& id);
     bool setTags(const std::string& id, const std::vector<std::string>& tags);
@@ -45,10 +106,39 @@ public:
     bool applyRetentionFromSettings();
     bool enforceRetention(std::int32_t maxCount);
 
+    // Ingest events absorbed by the coalescing window since construction.
+    std::uint64_t coalescedEventCount() const;
+
 private:
+    // The item stored by the most recent ingest. Only that item can absorb
+    // repeats: absorbing an older one would leave it below newer items until
+    // its copy time is written. Absorbed copy times are written when another
+    // item is stored, before reads and on shutdown.
+    struct CoalesceSlot {
+        ClipboardItemType type = ClipboardItemType::Text;
+        std::string contentHash;
+        std::string sourceAppId;
+        OriginType originType = OriginType::LocalCopy;
+        std::string id;
+        // Copy time of the ingest that stored the item; the window runs from
+        // here, so a steady poller cannot keep it open forever.
+        std::int64_t windowStartMs = 0;
+        std::int64_t writtenCopyTimeMs = 0;
+        std::int64_t pendingCopyTimeMs = 0;
+        std::uint64_t retentionGeneration = 0;
+    };
+
+    std::optional<ClipboardIngestResult> tryCoalesce(const ClipboardHistoryItem& item);
+    void rememberStored(const ClipboardHistoryItem& item, const std::string& id);
+    void flushCoalescedCopyTime();
+    void resetCoalescing();
+
     std::unique_ptr<ClipboardHistoryStore> m_store;
     SettingsStore& m_settingsStore;
+    ClipboardServiceOptions m_options;
     bool m_initialized;
+    std::optional<CoalesceSlot> m_coalesce;
+    std::uint64_t m_coalescedEvents;
 };
 
 } // namespace pasty
@@ -5,6 +5,7 @@
 
 #include <history/clipboard_history_types.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -13,11 +14,30 @@
 
 namespace pasty {
 
+class DurableAssetWriter;
+
 struct ClipboardHistoryUpsertResult {
     std::string id;
     bool inserted = false;
 };
 
+// One entry of a batch upsert. imageBytes is only read for image items and
+// must outlive the upsertItems() call.
+struct ClipboardHistoryUpsertRequest {
+    ClipboardHistoryItem item;
+    ImageBytesView imageBytes;
+};
+
+// Read-only bytes of one image. A view stays valid after the item is deleted
+// and after the store is closed. File-backed images are memory-mapped; inline
+// images own the blob read out of their row.
+class ClipboardImageBytes {
+public:
+    virtual ~ClipboardImageBytes() = default;
+    virtual const std::uint8_t* data() const = 0;
+    virtual std::size_t size() const = 0;
+};
+
 class ClipboardHistoryStore {
 public:
     virtual ~ClipboardHistoryStore() = default;
@@ -26,11 +46,19 @@ public:
     virtual void close() = 0;
 
     virtual ClipboardHistoryUpsertResult upsertTextItem(const ClipboardHistoryItem& item) = 0;
-    virtual ClipboardHistoryUpsertResult upsertImageItem(const ClipboardHistoryItem& item, const std::vector<std::uint8_t>& imageBytes) = 0;
+    virtual ClipboardHistoryUpsertResult upsertImageItem(const ClipboardHistoryItem& item, ImageBytesView imageBytes) = 0;
+    // Streamed images: the caller writes the encoded bytes to a path obtained
+    // from reserveStagingPath() and hands it to upsertStagedImageItem(), which
+    // consumes the file whether or not the upsert succeeds.
+    virtual std::string reserveStagingPath() = 0;
+    virtual ClipboardHistoryUpsertResult upsertStagedImageItem(const ClipboardHistoryItem& item, const std::string& stagingPath) = 0;
+    virtual std::vector<ClipboardHistoryUpsertResult> upsertItems(const std::vector<ClipboardHistoryUpsertRequest>& requests) = 0;
     virtual std::optional<ClipboardHistoryItem> getItem(const std::string& id) = 0;
     virtual std::optional<ClipboardHistoryItem> getItemByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash) = 0;
     virtual ClipboardHistoryListResult listItems(std::int32_t limit, const std::string& cursor) = 0;
     virtual std::vector<ClipboardHistoryItem> search(const SearchOptions& options) = 0;
+    virtual ClipboardHistorySummaryListResult listItemSummaries(std::int32_t limit, const std::string& cursor) = 0;
+    virtual std::vector<ClipboardHistoryItemSummary> searchSummaries(const SearchOptions& options) = 0;
     virtual std::vector<OcrTask> getPendingOcrImages(std::int32_t limit, HistoryTimestampMs nowMs) = 0;
     virtual std::optional<OcrTask> getNextOcrTask(HistoryTimestampMs nowMs) = 0;
     virtual bool markOcrProcessing(const std::string& id) = 0;
@@ -39,12 +67,48 @@ public:
     virtual std::optional<OcrTaskStatus> getOcrStatus(const std::string& id) = 0;
     virtual bool deleteItem(const std::string& id) = 0;
     virtual int deleteByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash) = 0;
+    // Remembers that legacyHash, produced under content hash hashVersion,
+    // names the content now stored as contentHash. resolveContentHash() maps
+    // such a hash to the current one and returns any other hash unchanged.
+    virtual bool recordContentHashAlias(ClipboardItemType type,
+                                        const std::string& legacyHash,
+                                        std::int32_t hashVersion,
+                                        const std::string& contentHash) = 0;
+    virtual std::string resolveContentHash(ClipboardItemType type, const std::string& contentHash) = 0;
     virtual bool enforceRetention(std::int32_t maxItems) = 0;
+    // Advances whenever a retention sweep removes rows, whether triggered by
+    // enforceRetention() or by an upsert crossing the high-water mark.
+    virtual std::uint64_t retentionGeneration() const = 0;
+    // The encoded image of an image item, wherever its tier keeps it: the
+    // row's image_blob for inline images, the asset file otherwise. Returns
+    // nullptr when the item does not exist or is not an image.
+    virtual std::unique_ptr<ClipboardImageBytes> openImageBytes(const std::string& id) = 0;
 
     virtual bool updateItemMetadata(const std::string& id, const std::string& metadata, HistoryTimestampMs updateTimeMs) = 0;
+    // Moves an item's copy (and update) time forward to copyTimeMs, as a
+    // dedupe upsert would; never moves it back.
+    virtual bool updateLastCopyTime(const std::string& id, HistoryTimestampMs copyTimeMs) = 0;
+};
+
+// Connection tuning for the SQLite store. Reader connections are only opened in
+// WAL mode, where they can read concurrently with the single writer.
+struct ClipboardHistoryStoreOptions {
+    bool walEnabled = true;
+    std::string synchronous = "NORMAL";
+    std::int32_t cacheSizeKiB = 8192;
+    std::int64_t mmapSizeBytes = 64LL * 1024 * 1024;
+    std::int32_t readerConnections = 2;
+    // Writes image assets before their rows commit; may be shared with the sync
+    // exporter. The store creates a group-fsync writer when none is given.
+    std::shared_ptr<DurableAssetWriter> assetWriter;
+    // Images up to this many bytes are kept in the row (image_blob) instead of
+    // as a file; their items have an empty imagePath. 0 keeps every image on
+    // disk, which is what hosts that only read imagePath need.
+    std::size_t inlineImageMaxBytes = 0;
 };
 
 std::unique_ptr<ClipboardHistoryStore> createClipboardHistoryStore();
+std::unique_ptr<ClipboardHistoryStore> createClipboardHistoryStore(const ClipboardHistoryStoreOptions& options);
 
 }
 
@@ -55,6 +55,14 @@ bool EncryptionManager::encrypt(const Key& key,
                                 const Bytes& plaintext,
                                 const Bytes& aad,
                                 EncryptedPayload& outPayload) {
+    return encrypt(key, dataOrNull(plaintext), plaintext.size(), aad, outPayload);
+}
+
+bool EncryptionManager::encrypt(const Key& key,
+                                const unsigned char* plaintext,
+                                std::size_t plaintextSize,
+                                const Bytes& aad,
+                                EncryptedPayload& outPayload) {
     if (!ensureInitialized()) {
         return false;
     }
@@ -62,13 +70,13 @@ bool EncryptionManager::encrypt(const Key& key,
     outPayload.nonce.resize(kNonceBytes);
     randombytes_buf(outPayload.nonce.data(), outPayload.nonce.size());
 
-    outPayload.ciphertext.resize(plaintext.size() + crypto_aead_xchacha20poly1305_ietf_ABYTES);
+    outPayload.ciphertext.resize(plaintextSize + crypto_aead_xchacha20poly1305_ietf_ABYTES);
 
     unsigned long long ciphertextLength = 0;
     const int rc = crypto_aead_xchacha20poly1305_ietf_encrypt(outPayload.ciphertext.data(),
                                                                &ciphertextLength,
-                                                               dataOrNull(plaintext),
-                                                               static_cast<unsigned long long>(plaintext.size()),
+                                                               plaintextSize == 0 ? nullptr : plaintext,
+                                                               static_cast<unsigned long long>(plaintextSize),
                                                                dataOrNull(aad),
                                                                static_cast<unsigned long long>(aad.size()),
                                                                nullptr,
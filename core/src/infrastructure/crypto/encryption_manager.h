@@ -32,6 +32,12 @@ public:
                         const Bytes& plaintext,
                         const Bytes& aad,
                         EncryptedPayload& outPayload);
+    // Same as above for plaintext the caller does not hold in a Bytes buffer.
+    static bool encrypt(const Key& key,
+                        const unsigned char* plaintext,
+                        std::size_t plaintextSize,
+                        const Bytes& aad,
+                        EncryptedPayload& outPayload);
 
     static bool decrypt(const Key& key,
                         const Bytes& nonce,
@@ -0,0 +1,273 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#include "infrastructure/storage/durable_asset_writer.h"
+
+#include <common/logger.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pasty {
+
+namespace {
+
+int openForSync(const std::string& path) {
+    return ::open(path.c_str(), O_RDONLY);
+}
+
+// A full barrier for everything written to fd's device. macOS fsync() does not
+// flush the drive cache, so ask for F_FULLFSYNC and fall back if unsupported.
+bool fullSync(int fd) {
+#if defined(__APPLE__)
+    if (::fcntl(fd, F_FULLFSYNC) == 0) {
+        return true;
+    }
+#endif
+    return ::fsync(fd) == 0;
+}
+
+std::string parentDirectory(const std::string& path) {
+    const std::string parent = std::filesystem::path(path).parent_path().string();
+    return parent.empty() ? std::string(".") : parent;
+}
+
+} // namespace
+
+AssetDurability parseAssetDurability(const std::string& value) {
+    if (value == "none") {
+        return AssetDurability::None;
+    }
+    if (value == "file") {
+        return AssetDurability::PerFile;
+    }
+    return AssetDurability::Group;
+}
+
+DurableAssetWriter::DurableAssetWriter(DurableAssetWriterOptions options)
+    : m_options(options)
+    , m_barriers(0)
+    , m_stopping(false) {
+    if (m_options.groupBatchSize == 0) {
+        m_options.groupBatchSize = 1;
+    }
+    if (m_options.durability == AssetDurability::Group) {
+        m_syncThread = std::thread(&DurableAssetWriter::runGroupSync, this);
+    }
+}
+
+DurableAssetWriter::~DurableAssetWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_pending.notify_all();
+    if (m_syncThread.joinable()) {
+        m_syncThread.join();
+    }
+}
+
+bool DurableAssetWriter::writeFile(const std::string& path, const std::uint8_t* data, std::size_t size) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        PASTY_LOG_ERROR("Core.AssetWriter", "Failed to open %s (errno=%d)", path.c_str(), errno);
+        return false;
+    }
+
+    std::size_t written = 0;
+    while (written < size) {
+        const ssize_t result = ::write(fd, data + written, size - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            PASTY_LOG_ERROR("Core.AssetWriter", "Failed to write %s (errno=%d)", path.c_str(), errno);
+            ::close(fd);
+            std::remove(path.c_str());
+            return false;
+        }
+        written += static_cast<std::size_t>(result);
+    }
+
+    bool ok = true;
+    if (m_options.durability == AssetDurability::PerFile) {
+        ok = fullSync(fd);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_barriers;
+    }
+    ok = ::close(fd) == 0 && ok;
+    if (ok && m_options.durability == AssetDurability::Group) {
+        ok = syncInGroup(path);
+    }
+
+    if (!ok) {
+        PASTY_LOG_ERROR("Core.AssetWriter", "Failed to sync %s", path.c_str());
+        std::remove(path.c_str());
+    }
+    return ok;
+}
+
+bool DurableAssetWriter::syncFile(const std::string& path) {
+    switch (m_options.durability) {
+        case AssetDurability::None:
+            return true;
+        case AssetDurability::PerFile:
+            return syncPath(path);
+        case AssetDurability::Group:
+            return syncInGroup(path);
+    }
+    return true;
+}
+
+bool DurableAssetWriter::publish(const std::string& tempPath, const std::string& targetPath) {
+    if (std::rename(tempPath.c_str(), targetPath.c_str()) != 0) {
+        PASTY_LOG_ERROR("Core.AssetWriter", "Failed to rename %s (errno=%d)", targetPath.c_str(), errno);
+        return false;
+    }
+
+    switch (m_options.durability) {
+        case AssetDurability::None:
+            return true;
+        case AssetDurability::PerFile:
+            return syncPath(parentDirectory(targetPath));
+        case AssetDurability::Group:
+            return syncInGroup(parentDirectory(targetPath));
+    }
+    return true;
+}
+
+bool DurableAssetWriter::publishLink(const std::string& sourcePath, const std::string& targetPath) {
+    if (::link(sourcePath.c_str(), targetPath.c_str()) != 0) {
+        if (errno == EEXIST) {
+            return true;
+        }
+        PASTY_LOG_ERROR("Core.AssetWriter", "Failed to link %s (errno=%d)", targetPath.c_str(), errno);
+        return false;
+    }
+    return syncFile(parentDirectory(targetPath));
+}
+
+bool DurableAssetWriter::writeAtomically(const std::string& targetPath, const std::uint8_t* data, std::size_t size) {
+    const std::string tempPath = targetPath + ".tmp";
+    if (!writeFile(tempPath, data, size)) {
+        return false;
+    }
+    if (!publish(tempPath, targetPath)) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool DurableAssetWriter::writeAtomically(const std::string& targetPath, const std::vector<std::uint8_t>& bytes) {
+    return writeAtomically(targetPath, bytes.data(), bytes.size());
+}
+
+AssetDurability DurableAssetWriter::durability() const {
+    return m_options.durability;
+}
+
+std::uint64_t DurableAssetWriter::barrierCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_barriers;
+}
+
+bool DurableAssetWriter::syncPath(const std::string& path) {
+    const int fd = openForSync(path);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = fullSync(fd);
+    ::close(fd);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_barriers;
+    return ok;
+}
+
+bool DurableAssetWriter::syncInGroup(const std::string& path) {
+    auto ticket = std::make_shared<SyncTicket>();
+    ticket->path = path;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queue.push_back(ticket);
+    m_pending.notify_one();
+    m_completed.wait(lock, [&]() { return ticket->done; });
+    return ticket->ok;
+}
+
+// Takes whatever is queued (up to the batch size) and covers it with one
+// barrier per device: syncfs() on Linux, F_FULLFSYNC after plain fsyncs on
+// macOS. Files queued while a barrier runs form the next batch.
+void DurableAssetWriter::runGroupSync() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_pending.wait(lock, [&]() { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            return;
+        }
+
+        std::vector<std::shared_ptr<SyncTicket>> batch;
+        while (!m_queue.empty() && batch.size() < m_options.groupBatchSize) {
+            batch.push_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+        lock.unlock();
+
+        std::vector<dev_t> ticketDevices(batch.size());
+        std::map<dev_t, int> barrierFds;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            const int fd = openForSync(batch[i]->path);
+            struct stat info {};
+            if (fd < 0 || ::fstat(fd, &info) != 0) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                continue;
+            }
+            ticketDevices[i] = info.st_dev;
+#if defined(__linux__)
+            batch[i]->ok = true;
+#else
+            // Pushes the data to the drive; the barrier below flushes its cache.
+            batch[i]->ok = ::fsync(fd) == 0;
+#endif
+            if (!barrierFds.emplace(info.st_dev, fd).second) {
+                ::close(fd);
+            }
+        }
+
+        std::set<dev_t> failedDevices;
+        for (const auto& entry : barrierFds) {
+#if defined(__linux__)
+            const bool synced = ::syncfs(entry.second) == 0;
+#else
+            const bool synced = fullSync(entry.second);
+#endif
+            if (!synced) {
+                failedDevices.insert(entry.first);
+            }
+            ::close(entry.second);
+        }
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (failedDevices.count(ticketDevices[i]) > 0) {
+                batch[i]->ok = false;
+            }
+        }
+
+        lock.lock();
+        m_barriers += barrierFds.size();
+        for (const auto& ticket : batch) {
+            ticket->done = true;
+        }
+        m_completed.notify_all();
+    }
+}
+
+} // namespace pasty
@@ -0,0 +1,95 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pasty {
+
+enum class AssetDurability {
+    // Page cache only; a crash can leave truncated or missing files.
+    None,
+    // fsync every file and its directory before returning.
+    PerFile,
+    // Hand files to a background thread that issues one barrier per batch;
+    // callers still block until their file is covered.
+    Group,
+};
+
+struct DurableAssetWriterOptions {
+    AssetDurability durability = AssetDurability::Group;
+    // Upper bound on files covered by one group barrier.
+    std::size_t groupBatchSize = 16;
+};
+
+// Accepts "none", "file" or "group"; anything else falls back to group.
+AssetDurability parseAssetDurability(const std::string& value);
+
+/**
+ * DurableAssetWriter - Writes asset files so they survive a crash before any
+ * database row or log line starts referencing them.
+ *
+ * Writes go to a temp path, are synced according to the durability mode and
+ * are then renamed into place; the rename is synced as well. A caller that
+ * commits its reference only after publish() returns true never points at a
+ * partial file.
+ *
+ * Thread-safety: all methods may be called concurrently. In Group mode
+ * concurrent callers share barriers, which is where the savings come from.
+ */
+class DurableAssetWriter {
+public:
+    explicit DurableAssetWriter(DurableAssetWriterOptions options = DurableAssetWriterOptions{});
+    ~DurableAssetWriter();
+
+    DurableAssetWriter(const DurableAssetWriter&) = delete;
+    DurableAssetWriter& operator=(const DurableAssetWriter&) = delete;
+
+    // Writes bytes to path (truncating) and makes the contents durable.
+    bool writeFile(const std::string& path, const std::uint8_t* data, std::size_t size);
+    // Renames tempPath to targetPath and makes the directory entry durable.
+    bool publish(const std::string& tempPath, const std::string& targetPath);
+    // Hard-links sourcePath at targetPath and makes the new entry durable;
+    // sourcePath stays in place. A target that already exists counts as
+    // published, since assets are content addressed.
+    bool publishLink(const std::string& sourcePath, const std::string& targetPath);
+    // Makes a file written by other means (e.g. appended in chunks) durable,
+    // as writeFile() would have.
+    bool syncFile(const std::string& path);
+    // writeFile() to "<targetPath>.tmp" followed by publish().
+    bool writeAtomically(const std::string& targetPath, const std::uint8_t* data, std::size_t size);
+    bool writeAtomically(const std::string& targetPath, const std::vector<std::uint8_t>& bytes);
+
+    AssetDurability durability() const;
+    std::uint64_t barrierCount() const;
+
+private:
+    struct SyncTicket {
+        std::string path;
+        bool done = false;
+        bool ok = false;
+    };
+
+    bool syncPath(const std::string& path);
+    bool syncInGroup(const std::string& path);
+    void runGroupSync();
+
+    DurableAssetWriterOptions m_options;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_pending;
+    std::condition_variable m_completed;
+    std::deque<std::shared_ptr<SyncTicket>> m_queue;
+    std::uint64_t m_barriers;
+    bool m_stopping;
+    std::thread m_syncThread;
+};
+
+} // namespace pasty
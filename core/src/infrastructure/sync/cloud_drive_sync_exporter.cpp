@@ -1,6 +1,7 @@
 // Pasty - Copyright (c) 2026. MIT License.
 
 #include "infrastructure/sync/cloud_drive_sync_exporter.h"
+#include "utils/content_hash.h"
 #include <common/logger.h>
 
 #include <chrono>
@@ -114,8 +115,10 @@ CloudDriveSyncExporter::~CloudDriveSyncExporter() {
 std::optional<CloudDriveSyncExporter> CloudDriveSyncExporter::Create(const std::string& syncRootPath,
                                                                      const std::string& baseDirectory,
                                                                      const std::optional<EncryptionManager::Key>& e2eeMasterKey,
-                                                                     const std::string& e2eeKeyId) {
+                                                                     const std::string& e2eeKeyId,
+                                                                     std::shared_ptr<DurableAssetWriter> assetWriter) {
     CloudDriveSyncExporter exporter;
+    exporter.m_assetWriter = assetWriter ? std::move(assetWriter) : std::make_shared<DurableAssetWriter>();
     if (exporter.initialize(syncRootPath, baseDirectory)) {
         if (e2eeMasterKey.has_value() && !e2eeKeyId.empty()) {
             exporter.setE2eeKey(*e2eeMasterKey, e2eeKeyId);
@@ -334,27 +337,14 @@ bool CloudDriveSyncExporter::rotateLogFileIfNeeded(std::size_t lineLength) {
     return true;
 }
 
-bool CloudDriveSyncExporter::writeAssetAtomically(const std::string& assetKey, const std::vector<std::uint8_t>& bytes) {
+bool CloudDriveSyncExporter::writeAssetAtomically(const std::string& assetKey, const std::uint8_t* data, std::size_t size) {
     const std::string targetPath = m_assetsPath + "/" + assetKey;
-    const std::string tempPath = targetPath + ".tmp";
-
-    std::ofstream output(tempPath, std::ios::binary | std::ios::trunc);
-    if (!output.is_open()) {
-        PASTY_LOG_ERROR("Core.SyncExporter", "Failed to open temp asset file: %s", tempPath.c_str());
-        return false;
-    }
-
-    output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
-    output.flush();
-    output.close();
-
-    if (std::rename(tempPath.c_str(), targetPath.c_str()) != 0) {
-        PASTY_LOG_ERROR("Core.SyncExporter", "Failed to rename temp asset to: %s", targetPath.c_str());
-        std::remove(tempPath.c_str());
+    if (!m_assetWriter->writeAtomically(targetPath, data, size)) {
+        PASTY_LOG_ERROR("Core.SyncExporter", "Failed to write asset: %s", targetPath.c_str());
         return false;
     }
 
-    PASTY_LOG_DEBUG("Core.SyncExporter", "Asset written: %s (%zu bytes)", assetKey.c_str(), bytes.size());
+    PASTY_LOG_DEBUG("Core.SyncExporter", "Asset written: %s (%zu bytes)", assetKey.c_str(), size);
     return true;
 }
 
@@ -424,6 +414,7 @@ CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportTextItem(cons
     json["op"] = "upsert_text";
     json["item_type"] = "text";
     json["content_hash"] = item.contentHash;
+    json["hash_version"] = content_hash::kCurrentVersion;
     json["content_type"] = "text/plain";
     json["size_bytes"] = item.content.size();
     json["source_app_id"] = m_includeSourceAppId ? item.sourceAppId : std::string();
@@ -478,7 +469,7 @@ CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportTextItem(cons
     return writeJsonlEvent(jsonLine);
 }
 
-CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportImageItem(const ClipboardHistoryItem& item, const std::vector<std::uint8_t>& imageBytes) {
+CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportImageItem(const ClipboardHistoryItem& item, ImageBytesView imageBytes) {
     if (!m_initialized) {
         return ExportResult::SyncNotConfigured;
     }
@@ -489,9 +480,9 @@ CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportImageItem(con
         return ExportResult::SkippedNonLocalOrigin;
     }
 
-    if (imageBytes.size() > kMaxImageBytes) {
+    if (imageBytes.size > kMaxImageBytes) {
         PASTY_LOG_ERROR("Core.SyncExporter", "Image too large: %zu bytes (max: %lu), hash=%s", 
-                        imageBytes.size(), static_cast<unsigned long>(kMaxImageBytes), item.contentHash.c_str());
+                        imageBytes.size, static_cast<unsigned long>(kMaxImageBytes), item.contentHash.c_str());
         const std::string logPath = getCurrentLogFilePath();
         m_stateManager->incrementFileErrorCount(logPath);
         return ExportResult::SkippedImageTooLarge;
@@ -523,19 +514,18 @@ CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportImageItem(con
 
     const std::string assetKey = item.contentHash + "." + extension;
 
-    std::vector<std::uint8_t> assetBytesToWrite;
+    // Plain assets are written straight from the caller's buffer; encrypted
+    // ones from the ciphertext, which is wiped afterwards.
+    ImageBytesView assetBytesToWrite = imageBytes;
+    std::vector<std::uint8_t> ciphertext;
     std::string nonceB64;
     bool encryptedAsset = false;
 
     if (m_e2eeMasterKey.has_value() && !m_e2eeKeyId.empty()) {
-        EncryptionManager::Bytes plaintext(imageBytes.begin(), imageBytes.end());
         EncryptionManager::Bytes aad(eventId.begin(), eventId.end());
         EncryptionManager::EncryptedPayload encryptedPayload;
 
-        const bool encrypted = EncryptionManager::encrypt(*m_e2eeMasterKey, plaintext, aad, encryptedPayload);
-        if (!plaintext.empty()) {
-            sodium_memzero(plaintext.data(), plaintext.size());
-        }
+        const bool encrypted = EncryptionManager::encrypt(*m_e2eeMasterKey, imageBytes.data, imageBytes.size, aad, encryptedPayload);
         if (!aad.empty()) {
             sodium_memzero(aad.data(), aad.size());
         }
@@ -556,29 +546,22 @@ CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportImageItem(con
             return ExportResult::ExportFailed;
         }
 
-        assetBytesToWrite.assign(encryptedPayload.ciphertext.begin(), encryptedPayload.ciphertext.end());
+        ciphertext = std::move(encryptedPayload.ciphertext);
+        assetBytesToWrite = ImageBytesView(ciphertext);
 
         if (!encryptedPayload.nonce.empty()) {
             sodium_memzero(encryptedPayload.nonce.data(), encryptedPayload.nonce.size());
         }
-        if (!encryptedPayload.ciphertext.empty()) {
-            sodium_memzero(encryptedPayload.ciphertext.data(), encryptedPayload.ciphertext.size());
-        }
 
         encryptedAsset = true;
-    } else {
-        assetBytesToWrite = imageBytes;
     }
 
-    if (!writeAssetAtomically(assetKey, assetBytesToWrite)) {
-        if (!assetBytesToWrite.empty()) {
-            sodium_memzero(assetBytesToWrite.data(), assetBytesToWrite.size());
-        }
-        return ExportResult::ExportFailed;
+    const bool assetWritten = writeAssetAtomically(assetKey, assetBytesToWrite.data, assetBytesToWrite.size);
+    if (!ciphertext.empty()) {
+        sodium_memzero(ciphertext.data(), ciphertext.size());
     }
-
-    if (!assetBytesToWrite.empty()) {
-        sodium_memzero(assetBytesToWrite.data(), assetBytesToWrite.size());
+    if (!assetWritten) {
+        return ExportResult::ExportFailed;
     }
 
     using Json = nlohmann::json;
@@ -591,11 +574,12 @@ CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportImageItem(con
     json["op"] = "upsert_image";
     json["item_type"] = "image";
     json["content_hash"] = item.contentHash;
+    json["hash_version"] = content_hash::kCurrentVersion;
     json["asset_key"] = assetKey;
     json["width"] = item.imageWidth;
     json["height"] = item.imageHeight;
     json["content_type"] = "image/" + extension;
-    json["size_bytes"] = imageBytes.size();
+    json["size_bytes"] = imageBytes.size;
     json["source_app_id"] = m_includeSourceAppId ? item.sourceAppId : std::string();
     json["is_concealed"] = false;
     json["is_transient"] = false;
@@ -637,6 +621,7 @@ CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportDeleteTombsto
     json["seq"] = seq;
     json["ts_ms"] = nowMs;
     json["op"] = "delete";
+    json["hash_version"] = content_hash::kCurrentVersion;
 
     if (m_e2eeMasterKey.has_value() && !m_e2eeKeyId.empty()) {
         using Json = nlohmann::json;
@@ -726,6 +711,7 @@ CloudDriveSyncExporter::ExportResult CloudDriveSyncExporter::exportTags(
     json["op"] = "set_tags";
     json["item_type"] = itemTypeStr;
     json["content_hash"] = contentHash;
+    json["hash_version"] = content_hash::kCurrentVersion;
     json["tags"] = tags;
     json["encryption"] = "none";
 
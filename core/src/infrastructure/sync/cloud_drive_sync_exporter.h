@@ -2,6 +2,7 @@
 
 #include "history/clipboard_history_types.h"
 #include "infrastructure/crypto/encryption_manager.h"
+#include "infrastructure/storage/durable_asset_writer.h"
 #include "infrastructure/sync/cloud_drive_sync_state.h"
 
 #include <cstdint>
@@ -21,7 +22,7 @@ namespace pasty {
  * - Image upsert events with separate asset files
  * - Delete tombstone events
  * - Log file rotation at 10 MiB
- * - Atomic asset writes (temp + rename)
+ * - Atomic, durable asset writes (temp + sync + rename via DurableAssetWriter)
  * - Loop prevention (only exports items with originType == LocalCopy)
  * - Size caps (25 MiB images, 1 MiB event lines)
  *
@@ -52,13 +53,16 @@ public:
      *
      * @param syncRootPath Path to cloud sync root directory (e.g., iCloud Drive/Pasty)
      * @param baseDirectory Local base directory for state file (sync_state.json)
+     * @param assetWriter Writer for image assets, usually shared with the history
+     *                    store; a group-fsync writer is created when null
      * @return Configured exporter instance, or nullopt on failure
      */
     static std::optional<CloudDriveSyncExporter> Create(
         const std::string& syncRootPath,
         const std::string& baseDirectory,
         const std::optional<EncryptionManager::Key>& e2eeMasterKey = std::nullopt,
-        const std::string& e2eeKeyId = std::string());
+        const std::string& e2eeKeyId = std::string(),
+        std::shared_ptr<DurableAssetWriter> assetWriter = nullptr);
 
     void setE2eeKey(const EncryptionManager::Key& masterKey, const std::string& keyId);
     void clearE2eeKey();
@@ -86,10 +90,10 @@ public:
      * Asset written atomically as <content_hash>.<ext>
      *
      * @param item The clipboard history item to export
-     * @param imageBytes The image binary data
+     * @param imageBytes The image binary data; read in place, never copied
      * @return Export result status
      */
-    ExportResult exportImageItem(const ClipboardHistoryItem& item, const std::vector<std::uint8_t>& imageBytes);
+    ExportResult exportImageItem(const ClipboardHistoryItem& item, ImageBytesView imageBytes);
 
     /**
      * Export a delete tombstone
@@ -117,13 +121,15 @@ private:
     std::string getCurrentLogFilePath() const;
     std::string getNextLogFilePath() const;
     bool rotateLogFileIfNeeded(std::size_t lineLength);
-    bool writeAssetAtomically(const std::string& assetKey, const std::vector<std::uint8_t>& bytes);
+    bool writeAssetAtomically(const std::string& assetKey, const std::uint8_t* data, std::size_t size);
     
     // Constants
     static constexpr std::uint64_t kMaxImageBytes = 26214400;       // 25 MiB
     static constexpr std::uint64_t kMaxEventLineBytes = 1048576;    // 1 MiB
     static constexpr std::uint64_t kLogFileRotationBytes = 10485760; // 10 MiB
     static constexpr int kSchemaVersion = 1;
+    // Seqs leased from the sync state per journal write.
+    static constexpr std::uint64_t kSeqLeaseBlockSize = 64;
 
     std::string m_syncRootPath;
     std::string m_logsPath;
@@ -136,6 +142,8 @@ private:
     class StateManager {
     public:
         std::optional<CloudDriveSyncState> state;
+        std::uint64_t leasedNext = 0;
+        std::uint64_t leasedEnd = 0;
 
         explicit StateManager(std::optional<CloudDriveSyncState> s)
             : state(std::move(s)) {
@@ -148,15 +156,25 @@ private:
             return std::string();
         }
 
+        // Hands out seqs from a leased block and only goes back to the state
+        // when it runs out. A crash loses the rest of the block, which shows up
+        // as a gap in this device's seqs.
         std::uint64_t reserveNextSeq() {
-            if (state) {
-                return state->reserveNextSeq();
+            if (!state) {
+                return 0;
+            }
+            if (leasedNext == leasedEnd) {
+                leasedNext = state->reserveSeqBlock(kSeqLeaseBlockSize);
+                leasedEnd = leasedNext + kSeqLeaseBlockSize;
             }
-            return 0;
+            return leasedNext++;
         }
 
         bool regenerateDeviceId() {
             if (state) {
+                // The new device id restarts at seq 1; drop the old lease.
+                leasedNext = 0;
+                leasedEnd = 0;
                 return state->regenerateDeviceId();
             }
             return false;
@@ -171,6 +189,7 @@ private:
         }
     };
     std::unique_ptr<StateManager> m_stateManager;
+    std::shared_ptr<DurableAssetWriter> m_assetWriter;
 
     std::optional<EncryptionManager::Key> m_e2eeMasterKey;
     std::string m_e2eeKeyId;
@@ -4,17 +4,21 @@
 #include "application/history/clipboard_service.h"
 #include "infrastructure/sync/cloud_drive_sync_protocol_info.h"
 #include "infrastructure/sync/cloud_drive_sync_pruner.h"
+#include "utils/content_hash.h"
 #include "utils/runtime_json_utils.h"
 #include <common/logger.h>
 
 #include <algorithm>
 #include <cctype>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <filesystem>
+#include <limits>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <utility>
-#include <map>
-#include <set>
 
 #include <nlohmann/json.hpp>
 #include <sodium.h>
@@ -23,17 +27,6 @@ namespace pasty {
 
 namespace {
 
-// Tombstone key for anti-resurrection
-struct TombstoneKey {
-    ClipboardItemType type;
-    std::string contentHash;
-    
-    bool operator<(const TombstoneKey& other) const {
-        if (type != other.type) return type < other.type;
-        return contentHash < other.contentHash;
-    }
-};
-
 bool validateContentHash(const std::string& hash) {
     if (hash.size() != 16) {
         return false;
@@ -106,8 +99,133 @@ bool isConflictFile(const std::string& filename) {
 
 } // namespace
 
+struct CloudDriveSyncImporter::DeviceEventCursor {
+    std::string deviceId;
+    std::vector<std::string> files;
+    std::size_t nextFile = 0;
+    std::string currentPath;
+    std::ifstream stream;
+    std::uint64_t offset = 0;
+    // Captured once: max_applied_seq moves while this import applies events.
+    std::uint64_t maxAppliedSeq = 0;
+    bool exhausted = false;
+};
+
+// Parses device logs ahead of the merge on a few worker threads. Each device
+// is read by exactly one worker through readNextEvent, so the events the merge
+// takes for a device, and the cursor and error-count updates behind them, are
+// the same as on the serial path; only their timing changes.
+class CloudDriveSyncImporter::DeviceEventPrefetcher {
+public:
+    DeviceEventPrefetcher(CloudDriveSyncImporter& importer,
+                          std::vector<DeviceEventCursor>& cursors,
+                          std::size_t threadCount,
+                          std::size_t bytesPerDevice)
+        : m_importer(importer)
+        , m_cursors(cursors)
+        , m_queues(cursors.size())
+        , m_bytesPerDevice(bytesPerDevice)
+        , m_threadCount(threadCount)
+        , m_stopping(false) {
+        for (std::size_t worker = 0; worker < m_threadCount; ++worker) {
+            m_threads.emplace_back(&DeviceEventPrefetcher::run, this, worker);
+        }
+    }
+
+    ~DeviceEventPrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_consumed.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    DeviceEventPrefetcher(const DeviceEventPrefetcher&) = delete;
+    DeviceEventPrefetcher& operator=(const DeviceEventPrefetcher&) = delete;
+
+    // Blocks until the device's next event is parsed; false once it has none.
+    bool next(std::size_t device, ParsedEvent& event) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Queue& queue = m_queues[device];
+        m_produced.wait(lock, [&]() { return !queue.events.empty() || queue.done; });
+        if (queue.events.empty()) {
+            return false;
+        }
+        event = std::move(queue.events.front().first);
+        queue.bytes -= queue.events.front().second;
+        queue.events.pop_front();
+        m_consumed.notify_all();
+        return true;
+    }
+
+private:
+    struct Queue {
+        std::deque<std::pair<ParsedEvent, std::size_t>> events;
+        std::size_t bytes = 0;
+        bool done = false;
+    };
+
+    // Worker w owns devices w, w + threadCount, ...; it parses one event at a
+    // time for whichever of them has room, and sleeps when all are full.
+    void run(std::size_t worker) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopping) {
+            std::size_t device = m_queues.size();
+            bool pending = false;
+            for (std::size_t i = worker; i < m_queues.size(); i += m_threadCount) {
+                if (m_queues[i].done) {
+                    continue;
+                }
+                pending = true;
+                if (m_queues[i].events.empty() || m_queues[i].bytes < m_bytesPerDevice) {
+                    device = i;
+                    break;
+                }
+            }
+            if (!pending) {
+                return;
+            }
+            if (device == m_queues.size()) {
+                m_consumed.wait(lock);
+                continue;
+            }
+
+            lock.unlock();
+            ParsedEvent event;
+            const bool parsed = m_importer.readNextEvent(m_cursors[device], event);
+            const std::size_t bytes = parsed ? estimateEventBytes(event) : 0;
+            lock.lock();
+
+            Queue& queue = m_queues[device];
+            if (parsed) {
+                queue.bytes += bytes;
+                queue.events.emplace_back(std::move(event), bytes);
+            } else {
+                queue.done = true;
+            }
+            m_produced.notify_all();
+        }
+    }
+
+    CloudDriveSyncImporter& m_importer;
+    std::vector<DeviceEventCursor>& m_cursors;
+    std::vector<Queue> m_queues;
+    std::size_t m_bytesPerDevice;
+    std::size_t m_threadCount;
+    std::mutex m_mutex;
+    std::condition_variable m_produced;
+    std::condition_variable m_consumed;
+    bool m_stopping;
+    std::vector<std::thread> m_threads;
+};
+
 CloudDriveSyncImporter::CloudDriveSyncImporter()
     : m_protocolE2eeEnabled(false)
+    , m_memoryBudgetBytes(kDefaultMemoryBudgetBytes)
+    , m_parseThreads(std::min<std::size_t>(kMaxParseThreads, std::max(1u, std::thread::hardware_concurrency())))
     , m_initialized(false) {
 }
 
@@ -143,6 +261,14 @@ void CloudDriveSyncImporter::clearE2eeKey() {
     m_e2eeKeyId.clear();
 }
 
+void CloudDriveSyncImporter::setMemoryBudgetBytes(std::size_t bytes) {
+    m_memoryBudgetBytes = bytes;
+}
+
+void CloudDriveSyncImporter::setParseThreads(std::size_t threads) {
+    m_parseThreads = std::max<std::size_t>(threads, 1);
+}
+
 bool CloudDriveSyncImporter::initialize(const std::string& syncRootPath, const std::string& baseDirectory) {
     m_syncRootPath = syncRootPath;
     m_logsPath = syncRootPath + "/logs";
@@ -185,37 +311,124 @@ CloudDriveSyncImporter::ImportResult CloudDriveSyncImporter::importChanges(Clipb
         return result;
     }
 
+    // Tombstones written before the store moved to the current content hash
+    // follow their items' rehashed hashes.
+    m_stateManager->migrateTombstoneHashes(content_hash::kCurrentVersion,
+        [&clipboardService](const CloudDriveSyncState::Tombstone& tombstone) {
+            const ClipboardItemType type = tombstone.item_type == "image" ? ClipboardItemType::Image : ClipboardItemType::Text;
+            return clipboardService.resolveContentHash(type, tombstone.content_hash);
+        });
+
     std::vector<std::string> remoteDeviceDirs = enumerateRemoteDeviceLogDirectories();
     PASTY_LOG_INFO("Core.SyncImporter", "Found %zu remote device directories", remoteDeviceDirs.size());
 
-    std::vector<ParsedEvent> allEvents;
-    for (const auto& remoteDeviceDir : remoteDeviceDirs) {
-        const std::string remoteDeviceId = std::filesystem::path(remoteDeviceDir).filename().string();
-        
-        CloudDriveSyncState::RemoteDeviceState deviceState = m_stateManager->getRemoteDeviceState(remoteDeviceId);
+    std::vector<DeviceEventCursor> cursors(remoteDeviceDirs.size());
+    for (std::size_t i = 0; i < remoteDeviceDirs.size(); ++i) {
+        DeviceEventCursor& cursor = cursors[i];
+        cursor.deviceId = std::filesystem::path(remoteDeviceDirs[i]).filename().string();
+        cursor.maxAppliedSeq = m_stateManager->getRemoteDeviceState(cursor.deviceId).max_applied_seq;
+        cursor.files = enumerateJsonlFiles(remoteDeviceDirs[i]);
         PASTY_LOG_DEBUG("Core.SyncImporter", "Processing remote device: %s, max_applied_seq: %lu",
-                        remoteDeviceId.c_str(), static_cast<unsigned long>(deviceState.max_applied_seq));
+                        cursor.deviceId.c_str(), static_cast<unsigned long>(cursor.maxAppliedSeq));
+    }
+
+    recordPendingTombstones(cursors, clipboardService);
 
-        std::vector<std::string> jsonlFiles = enumerateJsonlFiles(remoteDeviceDir);
-        
-        for (const auto& filePath : jsonlFiles) {
-            if (!parseJsonlFile(filePath, remoteDeviceId, allEvents)) {
-                PASTY_LOG_WARN("Core.SyncImporter", "Failed to parse file: %s", filePath.c_str());
+    // Logs are parsed on the caller's thread unless there are several devices
+    // to spread across workers.
+    std::unique_ptr<DeviceEventPrefetcher> prefetcher;
+    const std::size_t parseThreads = std::min(m_parseThreads, cursors.size());
+    if (parseThreads > 1) {
+        prefetcher = std::make_unique<DeviceEventPrefetcher>(
+            *this, cursors, parseThreads, m_memoryBudgetBytes / cursors.size());
+    }
+    const auto readNext = [&](std::size_t device, ParsedEvent& event) {
+        return prefetcher ? prefetcher->next(device, event) : readNextEvent(cursors[device], event);
+    };
+
+    struct DeviceMergeState {
+        // Events from this device currently in the merge heap.
+        std::size_t buffered = 0;
+        std::int64_t lastTsMs = std::numeric_limits<std::int64_t>::min();
+        bool exhausted = false;
+    };
+    std::vector<DeviceMergeState> devices(cursors.size());
+
+    struct PendingEvent {
+        ParsedEvent event;
+        std::size_t device = 0;
+        std::size_t bytes = 0;
+    };
+    const auto later = [](const PendingEvent& a, const PendingEvent& b) {
+        return b.event < a.event;
+    };
+    std::vector<PendingEvent> heap;
+    std::size_t bufferedBytes = 0;
+
+    // Every device with events left must have one in the heap before the top
+    // can be applied; beyond that, read ahead from the lagging device while
+    // the budget allows.
+    const auto fill = [&]() {
+        while (true) {
+            std::size_t next = devices.size();
+            for (std::size_t i = 0; i < devices.size(); ++i) {
+                const DeviceMergeState& device = devices[i];
+                if (device.exhausted) {
+                    continue;
+                }
+                if (device.buffered == 0) {
+                    next = i;
+                    break;
+                }
+                if (bufferedBytes < m_memoryBudgetBytes &&
+                    (next == devices.size() || device.lastTsMs < devices[next].lastTsMs)) {
+                    next = i;
+                }
             }
+            if (next == devices.size()) {
+                return;
+            }
+
+            PendingEvent pending;
+            if (!readNext(next, pending.event)) {
+                devices[next].exhausted = true;
+                continue;
+            }
+            pending.device = next;
+            pending.bytes = estimateEventBytes(pending.event);
+            devices[next].buffered++;
+            devices[next].lastTsMs = std::max(devices[next].lastTsMs, pending.event.tsMs);
+            bufferedBytes += pending.bytes;
+            heap.push_back(std::move(pending));
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    };
+
+    std::string lastDeviceId;
+    std::uint64_t lastSeq = 0;
+    while (true) {
+        fill();
+        if (heap.empty()) {
+            break;
         }
+        std::pop_heap(heap.begin(), heap.end(), later);
+        PendingEvent pending = std::move(heap.back());
+        heap.pop_back();
+        devices[pending.device].buffered--;
+        bufferedBytes -= pending.bytes;
+
+        result.eventsProcessed++;
+        applyEvent(pending.event, clipboardService, result, lastDeviceId, lastSeq);
     }
+    prefetcher.reset();
 
-    result.eventsProcessed = static_cast<int>(allEvents.size());
     const std::int64_t nowMs = runtime_json_utils::nowMs();
-    
-    if (allEvents.empty()) {
+    result.success = true;
+    if (result.eventsProcessed == 0) {
         PASTY_LOG_INFO("Core.SyncImporter", "No new events to import");
-        result.success = true;
     } else {
-        std::sort(allEvents.begin(), allEvents.end());
-        
-        PASTY_LOG_INFO("Core.SyncImporter", "Applying %zu events in deterministic order", allEvents.size());
-        result = applyEvents(allEvents, clipboardService);
+        PASTY_LOG_INFO("Core.SyncImporter", "Import complete: applied=%d, skipped=%d, errors=%d",
+                       result.eventsApplied, result.eventsSkipped, result.errors);
     }
 
     // Perform state GC to prune tombstones and stale file cursors
@@ -224,6 +437,10 @@ CloudDriveSyncImporter::ImportResult CloudDriveSyncImporter::importChanges(Clipb
         CloudDriveSyncPruner::kDefaultRetentionMs,
         CloudDriveSyncPruner::kDefaultMaxEventsPerDevice
     );
+    // Cursor, seq and tombstone updates above were only journaled.
+    if (!m_stateManager->persist()) {
+        PASTY_LOG_WARN("Core.SyncImporter", "Failed to commit sync state; it stays in the journal");
+    }
 
     return result;
 }
@@ -285,85 +502,152 @@ std::vector<std::string> CloudDriveSyncImporter::enumerateJsonlFiles(const std::
     return files;
 }
 
-bool CloudDriveSyncImporter::parseJsonlFile(const std::string& filePath, const std::string& remoteDeviceId,
-                                           std::vector<ParsedEvent>& events) {
-    std::ifstream file(filePath, std::ios::binary);
-    if (!file.is_open()) {
-        PASTY_LOG_ERROR("Core.SyncImporter", "Cannot open file: %s", filePath.c_str());
-        return false;
-    }
+bool CloudDriveSyncImporter::openNextFile(DeviceEventCursor& cursor) {
+    while (cursor.nextFile < cursor.files.size()) {
+        const std::string& filePath = cursor.files[cursor.nextFile++];
+        std::ifstream file(filePath, std::ios::binary);
+        if (!file.is_open()) {
+            PASTY_LOG_ERROR("Core.SyncImporter", "Cannot open file: %s", filePath.c_str());
+            continue;
+        }
 
-    CloudDriveSyncState::FileCursor cursor = m_stateManager->getFileCursor(filePath);
-    
-    file.seekg(0, std::ios::end);
-    const std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
-    file.clear();
+        const CloudDriveSyncState::FileCursor fileCursor = m_stateManager->getFileCursor(filePath);
 
-    std::uint64_t seekOffset = cursor.last_offset;
-    if (seekOffset > fileSize) {
-        PASTY_LOG_WARN("Core.SyncImporter", "Last offset %lu past EOF %lu for %s. Resetting to 0.",
-                        static_cast<unsigned long>(seekOffset), static_cast<unsigned long>(fileSize), filePath.c_str());
-        seekOffset = 0;
-    }
+        file.seekg(0, std::ios::end);
+        const std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
+        file.clear();
 
-    file.seekg(seekOffset);
+        std::uint64_t seekOffset = fileCursor.last_offset;
+        if (seekOffset > fileSize) {
+            PASTY_LOG_WARN("Core.SyncImporter", "Last offset %lu past EOF %lu for %s. Resetting to 0.",
+                            static_cast<unsigned long>(seekOffset), static_cast<unsigned long>(fileSize), filePath.c_str());
+            seekOffset = 0;
+        }
+
+        file.seekg(seekOffset);
 
-    if (!file.good()) {
-        PASTY_LOG_WARN("Core.SyncImporter", "Cannot seek to offset %lu in file: %s. Falling back to 0.",
-                        static_cast<unsigned long>(seekOffset), filePath.c_str());
-        file.clear();
-        file.seekg(0);
-        seekOffset = 0;
-        
         if (!file.good()) {
-            PASTY_LOG_ERROR("Core.SyncImporter", "Critical failure seeking to start of file: %s", filePath.c_str());
-            return false;
+            PASTY_LOG_WARN("Core.SyncImporter", "Cannot seek to offset %lu in file: %s. Falling back to 0.",
+                            static_cast<unsigned long>(seekOffset), filePath.c_str());
+            file.clear();
+            file.seekg(0);
+            seekOffset = 0;
+
+            if (!file.good()) {
+                PASTY_LOG_ERROR("Core.SyncImporter", "Critical failure seeking to start of file: %s", filePath.c_str());
+                continue;
+            }
         }
+
+        cursor.stream = std::move(file);
+        cursor.currentPath = filePath;
+        cursor.offset = seekOffset;
+        return true;
     }
+    return false;
+}
 
-    CloudDriveSyncState::RemoteDeviceState deviceState = m_stateManager->getRemoteDeviceState(remoteDeviceId);
-    const std::uint64_t maxAppliedSeq = deviceState.max_applied_seq;
+// Upserts are applied in merge order, so an upsert older than a delete of the
+// same item that has not been merged yet would be inserted (and could push an
+// unrelated item out at the history cap) only to be deleted again. This scan
+// reads the unapplied part of every log once, parses only the delete lines
+// and records their tombstones up front; the merge then skips such upserts.
+// It keeps no events, so memory stays within the merge budget.
+void CloudDriveSyncImporter::recordPendingTombstones(const std::vector<DeviceEventCursor>& cursors,
+                                                     ClipboardService& clipboardService) {
+    std::size_t recorded = 0;
+    for (const DeviceEventCursor& cursor : cursors) {
+        for (const std::string& filePath : cursor.files) {
+            std::ifstream file(filePath, std::ios::binary);
+            if (!file.is_open()) {
+                continue;
+            }
+            file.seekg(0, std::ios::end);
+            const std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
+            std::uint64_t offset = m_stateManager->getFileCursor(filePath).last_offset;
+            if (offset > fileSize) {
+                offset = 0;
+            }
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(offset));
+
+            std::string line;
+            while (std::getline(file, line)) {
+                const std::uint64_t lineOffset = offset;
+                offset += line.size() + 1;
+                if (line.find("\"op\":\"delete\"") == std::string::npos) {
+                    continue;
+                }
+                ParsedEvent event;
+                if (!parseEvent(line, filePath, lineOffset, event) || event.skipDueToMissingKey ||
+                    event.op != "delete" || event.deviceId != cursor.deviceId || event.seq <= cursor.maxAppliedSeq) {
+                    continue;
+                }
+                upgradeLegacyContentHash(event, clipboardService);
+                m_stateManager->recordTombstone(event.itemType, event.contentHash, event.tsMs);
+                ++recorded;
+            }
+        }
+    }
+    if (recorded > 0) {
+        PASTY_LOG_DEBUG("Core.SyncImporter", "Recorded %zu tombstones ahead of the merge", recorded);
+    }
+}
 
-    std::string line;
-    std::uint64_t currentOffset = seekOffset;
+// Returns the device's next unapplied event, moving through its files in
+// order. A file's cursor is advanced once the file has been read to the end.
+bool CloudDriveSyncImporter::readNextEvent(DeviceEventCursor& cursor, ParsedEvent& event) {
+    while (!cursor.exhausted) {
+        if (!cursor.stream.is_open() && !openNextFile(cursor)) {
+            cursor.exhausted = true;
+            break;
+        }
 
-    while (std::getline(file, line)) {
-        const std::uint64_t lineStartOffset = currentOffset;
-        currentOffset = file.tellg();
+        std::string line;
+        while (std::getline(cursor.stream, line)) {
+            const std::uint64_t lineStartOffset = cursor.offset;
+            cursor.offset = cursor.stream.tellg();
 
-        if (line.empty()) {
-            continue;
-        }
+            if (line.empty()) {
+                continue;
+            }
 
-        ParsedEvent event;
-        if (!parseEvent(line, filePath, lineStartOffset, event)) {
-            m_stateManager->incrementFileErrorCount(filePath);
-            continue;
-        }
+            event = ParsedEvent();
+            if (!parseEvent(line, cursor.currentPath, lineStartOffset, event)) {
+                m_stateManager->incrementFileErrorCount(cursor.currentPath);
+                continue;
+            }
 
-        if (event.deviceId != remoteDeviceId) {
-            PASTY_LOG_WARN("Core.SyncImporter", "Event device_id mismatch in %s: event says %s, directory is %s",
-                            filePath.c_str(), event.deviceId.c_str(), remoteDeviceId.c_str());
-            continue;
-        }
+            if (event.deviceId != cursor.deviceId) {
+                PASTY_LOG_WARN("Core.SyncImporter", "Event device_id mismatch in %s: event says %s, directory is %s",
+                                cursor.currentPath.c_str(), event.deviceId.c_str(), cursor.deviceId.c_str());
+                continue;
+            }
 
-        if (event.seq <= maxAppliedSeq) {
-            continue;
+            if (event.seq <= cursor.maxAppliedSeq) {
+                continue;
+            }
+
+            return true;
         }
 
-        events.push_back(event);
+        finishFile(cursor);
     }
+    return false;
+}
 
-    std::uint64_t endOffset = currentOffset;
-    if (file.tellg() == static_cast<std::streampos>(-1)) {
-        file.clear();
-        file.seekg(0, std::ios::end);
-        endOffset = static_cast<std::uint64_t>(file.tellg());
+void CloudDriveSyncImporter::finishFile(DeviceEventCursor& cursor) {
+    std::uint64_t endOffset = cursor.offset;
+    if (cursor.stream.tellg() == static_cast<std::streampos>(-1)) {
+        cursor.stream.clear();
+        cursor.stream.seekg(0, std::ios::end);
+        endOffset = static_cast<std::uint64_t>(cursor.stream.tellg());
     }
 
-    m_stateManager->updateFileCursor(filePath, endOffset);
-
-    return true;
+    m_stateManager->updateFileCursor(cursor.currentPath, endOffset);
+    cursor.stream.close();
+    cursor.stream.clear();
+    cursor.currentPath.clear();
 }
 
 bool CloudDriveSyncImporter::parseEvent(const std::string& line, const std::string& filePath,
@@ -415,6 +699,7 @@ bool CloudDriveSyncImporter::parseEvent(const std::string& line, const std::stri
         return false;
     }
     event.op = json["op"].get<std::string>();
+    event.hashVersion = json.value("hash_version", content_hash::kLegacyFnvVersion);
 
     // For upsert events, item_type and content_hash MUST be in the outer JSON (for tombstone checks)
     if (event.op != "delete") {
@@ -665,6 +950,16 @@ bool CloudDriveSyncImporter::parseEvent(const std::string& line, const std::stri
     return true;
 }
 
+std::size_t CloudDriveSyncImporter::estimateEventBytes(const ParsedEvent& event) {
+    std::size_t bytes = sizeof(ParsedEvent) + event.deviceId.size() + event.eventId.size() + event.op.size() +
+                        event.itemType.size() + event.contentHash.size() + event.text.size() +
+                        event.contentType.size() + event.assetKey.size() + event.sourceAppId.size();
+    for (const auto& tag : event.tags) {
+        bytes += sizeof(std::string) + tag.size();
+    }
+    return bytes;
+}
+
 std::optional<std::vector<std::uint8_t>> CloudDriveSyncImporter::readAssetFile(const std::string& assetKey) const {
     const std::string assetPath = m_assetsPath + "/" + assetKey;
 
@@ -693,119 +988,119 @@ std::optional<std::vector<std::uint8_t>> CloudDriveSyncImporter::readAssetFile(c
     return bytes;
 }
 
-CloudDriveSyncImporter::ImportResult CloudDriveSyncImporter::applyEvents(std::vector<ParsedEvent>& events,
-                                                                      ClipboardService& clipboardService) {
-    ImportResult result;
-    result.eventsProcessed = static_cast<int>(events.size());
+// Tombstones of every pending delete are recorded before the merge starts
+// (recordPendingTombstones), so an upsert with an older or equal ts_ms is
+// caught by the state check below whichever of the two is merged first.
+void CloudDriveSyncImporter::applyEvent(ParsedEvent& event, ClipboardService& clipboardService, ImportResult& result,
+                                        std::string& lastDeviceId, std::uint64_t& lastSeq) {
+    if (event.skipDueToMissingKey) {
+        result.eventsSkipped++;
+        result.errors++;
+        PASTY_LOG_WARN("Core.SyncImporter", "Skipping encrypted event due to unavailable key: %s", event.eventId.c_str());
+        return;
+    }
 
-    std::map<TombstoneKey, std::int64_t> batchTombstoneMaxTs;
-    
-    for (const auto& event : events) {
-        if (event.op == "delete") {
-            ClipboardItemType type = (event.itemType == "image") ? ClipboardItemType::Image : ClipboardItemType::Text;
-            TombstoneKey key{type, event.contentHash};
-            auto it = batchTombstoneMaxTs.find(key);
-            if (it == batchTombstoneMaxTs.end() || event.tsMs > it->second) {
-                batchTombstoneMaxTs[key] = event.tsMs;
-            }
-        }
+    // Safety check: skip events from local device (should not happen)
+    if (event.deviceId == m_stateManager->deviceId()) {
+        PASTY_LOG_WARN("Core.SyncImporter", "Skipping event from local device (should not happen): event_id=%s", event.eventId.c_str());
+        result.eventsSkipped++;
+        return;
     }
 
-    std::string lastDeviceId;
-    std::uint64_t lastSeq = 0;
+    upgradeLegacyContentHash(event, clipboardService);
+    bool applied = false;
 
-    for (const auto& event : events) {
-        if (event.skipDueToMissingKey) {
+    if (event.op == "delete") {
+        m_stateManager->recordTombstone(event.itemType, event.contentHash, event.tsMs);
+        applied = applyDelete(event, clipboardService);
+    } else if (event.op == "upsert_text") {
+        if (isTombstoned(event)) {
+            PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert due to persisted tombstone: type=%s, hash=%s, event_ts=%lld",
+                             event.itemType.c_str(), event.contentHash.c_str(), static_cast<long long>(event.tsMs));
             result.eventsSkipped++;
-            result.errors++;
-            PASTY_LOG_WARN("Core.SyncImporter", "Skipping encrypted event due to unavailable key: %s", event.eventId.c_str());
-            continue;
+            return;
         }
-
-        // Safety check: skip events from local device (should not happen)
-        if (event.deviceId == m_stateManager->deviceId()) {
-            PASTY_LOG_WARN("Core.SyncImporter", "Skipping event from local device (should not happen): event_id=%s", event.eventId.c_str());
+        auto existingItem = clipboardService.getByTypeAndContentHash(ClipboardItemType::Text, event.contentHash);
+        if (existingItem && existingItem->originType == OriginType::LocalCopy) {
+            PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert_text: local_copy item exists with same hash=%s", event.contentHash.c_str());
             result.eventsSkipped++;
-            continue;
+            return;
         }
-
-        bool applied = false;
-
-        if (event.op == "delete") {
-            m_stateManager->recordTombstone(event.itemType, event.contentHash, event.tsMs);
-            applied = applyDelete(event, clipboardService);
-        } else if (event.op == "upsert_text") {
-            TombstoneKey key{ClipboardItemType::Text, event.contentHash};
-            auto it = batchTombstoneMaxTs.find(key);
-            if (it != batchTombstoneMaxTs.end() && event.tsMs <= it->second) {
-                PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert due to persisted or batch tombstone: type=%s, hash=%s, event_ts=%lld, tombstone_ts=%lld",
-                                 event.itemType.c_str(), event.contentHash.c_str(), static_cast<long long>(event.tsMs), static_cast<long long>(it->second));
-                result.eventsSkipped++;
-                continue;
-            }
-            if (m_stateManager->shouldSkipUpsertDueToTombstone(event.itemType, event.contentHash, event.tsMs)) {
-                PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert due to persisted tombstone: type=%s, hash=%s, event_ts=%lld",
-                                 event.itemType.c_str(), event.contentHash.c_str(), static_cast<long long>(event.tsMs));
-                result.eventsSkipped++;
-                continue;
-            }
-            auto existingItem = clipboardService.getByTypeAndContentHash(ClipboardItemType::Text, event.contentHash);
-            if (existingItem && existingItem->originType == OriginType::LocalCopy) {
-                PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert_text: local_copy item exists with same hash=%s", event.contentHash.c_str());
-                result.eventsSkipped++;
-                continue;
-            }
-            applied = applyUpsertText(event, clipboardService);
-        } else if (event.op == "upsert_image") {
-            TombstoneKey key{ClipboardItemType::Image, event.contentHash};
-            auto it = batchTombstoneMaxTs.find(key);
-            if (it != batchTombstoneMaxTs.end() && event.tsMs <= it->second) {
-                PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert for tombstoned item in batch: type=%s, hash=%s",
-                                event.itemType.c_str(), event.contentHash.c_str());
-                result.eventsSkipped++;
-                continue;
-            }
-            if (m_stateManager->shouldSkipUpsertDueToTombstone(event.itemType, event.contentHash, event.tsMs)) {
-                PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert due to persisted tombstone: type=%s, hash=%s, event_ts=%lld",
-                                event.itemType.c_str(), event.contentHash.c_str(), static_cast<long long>(event.tsMs));
-                result.eventsSkipped++;
-                continue;
-            }
-            auto existingItem = clipboardService.getByTypeAndContentHash(ClipboardItemType::Image, event.contentHash);
-            if (existingItem && existingItem->originType == OriginType::LocalCopy) {
-                PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert_image: local_copy item exists with same hash=%s", event.contentHash.c_str());
-                result.eventsSkipped++;
-                continue;
-            }
-            applied = applyUpsertImage(event, clipboardService);
-        } else if (event.op == "set_tags") {
-            applied = applySetTags(event, clipboardService);
-        } else {
-            PASTY_LOG_WARN("Core.SyncImporter", "Skipping unknown op '%s' in apply", event.op.c_str());
+        applied = applyUpsertText(event, clipboardService);
+    } else if (event.op == "upsert_image") {
+        if (isTombstoned(event)) {
+            PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert due to persisted tombstone: type=%s, hash=%s, event_ts=%lld",
+                            event.itemType.c_str(), event.contentHash.c_str(), static_cast<long long>(event.tsMs));
             result.eventsSkipped++;
-            continue;
+            return;
         }
+        auto existingItem = clipboardService.getByTypeAndContentHash(ClipboardItemType::Image, event.contentHash);
+        if (existingItem && existingItem->originType == OriginType::LocalCopy) {
+            PASTY_LOG_DEBUG("Core.SyncImporter", "Skipping upsert_image: local_copy item exists with same hash=%s", event.contentHash.c_str());
+            result.eventsSkipped++;
+            return;
+        }
+        applied = applyUpsertImage(event, clipboardService);
+    } else if (event.op == "set_tags") {
+        applied = applySetTags(event, clipboardService);
+    } else {
+        PASTY_LOG_WARN("Core.SyncImporter", "Skipping unknown op '%s' in apply", event.op.c_str());
+        result.eventsSkipped++;
+        return;
+    }
 
-        if (applied) {
-            result.eventsApplied++;
+    if (applied) {
+        result.eventsApplied++;
 
-            if (event.deviceId != lastDeviceId) {
-                lastDeviceId = event.deviceId;
-                lastSeq = 0;
-            }
-            if (event.seq > lastSeq) {
-                lastSeq = event.seq;
-                m_stateManager->updateRemoteDeviceMaxSeq(event.deviceId, event.seq);
-            }
-        } else {
-            result.eventsSkipped++;
+        if (event.deviceId != lastDeviceId) {
+            lastDeviceId = event.deviceId;
+            lastSeq = 0;
+        }
+        if (event.seq > lastSeq) {
+            lastSeq = event.seq;
+            m_stateManager->updateRemoteDeviceMaxSeq(event.deviceId, event.seq);
         }
+    } else {
+        result.eventsSkipped++;
     }
+}
 
-    result.success = true;
-    PASTY_LOG_INFO("Core.SyncImporter", "Import complete: applied=%d, skipped=%d, errors=%d",
-                    result.eventsApplied, result.eventsSkipped, result.errors);
-    return result;
+// Text from an older peer is simply rehashed. Other hashes go through the
+// store's aliases, which know every item rehashed locally and every item an
+// older peer has synced here; an unknown hash is left as it is.
+void CloudDriveSyncImporter::upgradeLegacyContentHash(ParsedEvent& event, ClipboardService& clipboardService) const {
+    if (event.hashVersion >= content_hash::kCurrentVersion) {
+        return;
+    }
+
+    event.legacyContentHash = event.contentHash;
+    if (event.op == "upsert_text") {
+        event.contentHash = content_hash::computeTextHash(event.text);
+    } else {
+        const ClipboardItemType type = event.itemType == "image" ? ClipboardItemType::Image : ClipboardItemType::Text;
+        event.contentHash = clipboardService.resolveContentHash(type, event.contentHash);
+    }
+}
+
+// A legacy event is also checked against tombstones still keyed by its old
+// hash, e.g. deletes that older peers sent for items never stored here.
+bool CloudDriveSyncImporter::isTombstoned(const ParsedEvent& event) const {
+    if (m_stateManager->shouldSkipUpsertDueToTombstone(event.itemType, event.contentHash, event.tsMs)) {
+        return true;
+    }
+    return !event.legacyContentHash.empty() && event.legacyContentHash != event.contentHash &&
+           m_stateManager->shouldSkipUpsertDueToTombstone(event.itemType, event.legacyContentHash, event.tsMs);
+}
+
+// Lets later deletes and tags from the same older peer, which name the item
+// by its old hash, find what the upsert stored.
+void CloudDriveSyncImporter::rememberLegacyContentHash(const ParsedEvent& event, const std::string& contentHash,
+                                                       ClipboardService& clipboardService) const {
+    if (event.legacyContentHash.empty() || contentHash.empty()) {
+        return;
+    }
+    const ClipboardItemType type = event.itemType == "image" ? ClipboardItemType::Image : ClipboardItemType::Text;
+    clipboardService.recordContentHashAlias(type, event.legacyContentHash, event.hashVersion, contentHash);
 }
 
 bool CloudDriveSyncImporter::applyUpsertText(const ParsedEvent& event, ClipboardService& clipboardService) {
@@ -823,6 +1118,7 @@ bool CloudDriveSyncImporter::applyUpsertText(const ParsedEvent& event, Clipboard
         return false;
     }
 
+    rememberLegacyContentHash(event, result.contentHash, clipboardService);
     return true;
 }
 
@@ -909,6 +1205,7 @@ bool CloudDriveSyncImporter::applyUpsertImage(const ParsedEvent& event, Clipboar
         return false;
     }
 
+    rememberLegacyContentHash(event, result.contentHash, clipboardService);
     return true;
 }
 
@@ -6,7 +6,9 @@
 #include "infrastructure/crypto/encryption_manager.h"
 #include "infrastructure/sync/cloud_drive_sync_state.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -24,7 +26,8 @@ class ClipboardService;
  * following the cloud drive sync protocol. It handles:
  * - Scanning logs/<device_id>/events-*.jsonl for remote devices
  * - Incremental parsing using CloudDriveSyncState (max_applied_seq, file cursors)
- * - Deterministic merge ordering by (ts_ms, device_id, seq)
+ * - Deterministic merge ordering by (ts_ms, device_id, seq), streamed as a
+ *   k-way merge of per-device cursors under a memory budget
  * - Upsert text (inline content) to local history
  * - Upsert image (read asset file) to local history
  * - Delete tombstones (delete by type + content_hash)
@@ -68,16 +71,35 @@ public:
     void setE2eeKey(const EncryptionManager::Key& masterKey, const std::string& keyId);
     void clearE2eeKey();
 
+    // Upper bound on parsed-but-unapplied event payloads held during an
+    // import. Each device with pending events always has one event buffered,
+    // whatever the budget.
+    void setMemoryBudgetBytes(std::size_t bytes);
+
+    // Worker threads that parse and decrypt device logs ahead of the merge,
+    // at most one per device; 1 parses on the calling thread. Applied order
+    // and state updates do not depend on this. Defaults to
+    // min(4, hardware threads). Parse-ahead queues hold up to the memory
+    // budget in total on top of the merge heap.
+    void setParseThreads(std::size_t threads);
+
     /**
      * Import changes from remote devices
      *
-     * Scans sync_root/logs/<device_dir>/events-*.jsonl for remote devices (excluding local device),
-     * parses new events using state cursors, sorts deterministically, and applies
-     * to local history via ClipboardService.
+     * Scans sync_root/logs/<device_dir>/events-*.jsonl for remote devices (excluding local device)
+     * and applies new events to local history via ClipboardService.
+     *
+     * Each device log is read lazily in seq order by its own cursor; the cursors
+     * feed a min-heap on (ts_ms, device_id, seq) and the smallest event is applied
+     * once every device with pending events has one in the heap. While the heap
+     * is under the memory budget, cursors read ahead (lagging devices first), so
+     * timestamps that are slightly out of order within one log are re-sorted.
+     * A budget larger than the backlog gives exactly the full sort order.
      *
      * Events with seq <= max_applied_seq for a device are skipped.
      * File cursors (last_offset) are used to resume reading partially-read files.
-     * State is updated after successful application.
+     * State is updated after successful application; updates are journaled
+     * as they happen and committed to sync_state.json once at the end.
      *
      * @param clipboardService The ClipboardService to apply changes to
      * @return Import result statistics
@@ -105,6 +127,12 @@ private:
         std::string op;
         std::string itemType;
         std::string contentHash;
+        // Content hash version of contentHash; events without hash_version
+        // come from peers that still hash with version 1. Before such an
+        // event is applied, contentHash is moved to legacyContentHash and
+        // replaced by the current hash of the same content.
+        std::int32_t hashVersion = 1;
+        std::string legacyContentHash;
         
         // For upsert_text
         std::string text;
@@ -130,19 +158,32 @@ private:
         }
     };
     
+    // Streaming position in one remote device's logs (defined in the .cpp)
+    struct DeviceEventCursor;
+    class DeviceEventPrefetcher;
+
     // Scanning
     std::vector<std::string> enumerateRemoteDeviceLogDirectories() const;
     std::vector<std::string> enumerateJsonlFiles(const std::string& deviceLogsPath) const;
     
     // Parsing
-    bool parseJsonlFile(const std::string& filePath, const std::string& remoteDeviceId, std::vector<ParsedEvent>& events);
+    bool openNextFile(DeviceEventCursor& cursor);
+    bool readNextEvent(DeviceEventCursor& cursor, ParsedEvent& event);
+    void recordPendingTombstones(const std::vector<DeviceEventCursor>& cursors, ClipboardService& clipboardService);
+    void finishFile(DeviceEventCursor& cursor);
     bool parseEvent(const std::string& line, const std::string& filePath, std::uint64_t lineOffset, ParsedEvent& event);
+    static std::size_t estimateEventBytes(const ParsedEvent& event);
     
     // Asset reading
     std::optional<std::vector<std::uint8_t>> readAssetFile(const std::string& assetKey) const;
     
     // Application
-    ImportResult applyEvents(std::vector<ParsedEvent>& events, ClipboardService& clipboardService);
+    void applyEvent(ParsedEvent& event, ClipboardService& clipboardService, ImportResult& result,
+                    std::string& lastDeviceId, std::uint64_t& lastSeq);
+    void upgradeLegacyContentHash(ParsedEvent& event, ClipboardService& clipboardService) const;
+    bool isTombstoned(const ParsedEvent& event) const;
+    void rememberLegacyContentHash(const ParsedEvent& event, const std::string& contentHash,
+                                   ClipboardService& clipboardService) const;
     bool applyUpsertText(const ParsedEvent& event, ClipboardService& clipboardService);
     bool applyUpsertImage(const ParsedEvent& event, ClipboardService& clipboardService);
     bool applyDelete(const ParsedEvent& event, ClipboardService& clipboardService);
@@ -152,6 +193,8 @@ private:
     static constexpr int kSchemaVersion = 1;
     static constexpr const char* kLoopPrefix = "pasty-sync:";
     static constexpr std::uint64_t kMaxAssetBytes = 26214400; // 25 MiB
+    static constexpr std::size_t kDefaultMemoryBudgetBytes = 16777216; // 16 MiB
+    static constexpr std::size_t kMaxParseThreads = 4;
     
     std::string m_syncRootPath;
     std::string m_logsPath;
@@ -222,12 +265,27 @@ private:
             return false;
         }
 
+        bool migrateTombstoneHashes(std::int32_t hashVersion,
+                                    const std::function<std::string(const CloudDriveSyncState::Tombstone&)>& resolve) {
+            if (state) {
+                return state->migrateTombstoneHashes(hashVersion, resolve);
+            }
+            return false;
+        }
+
         bool pruneForGc(std::int64_t nowMs, std::int64_t retentionMs, std::size_t maxTombstones) {
             if (state) {
                 return state->pruneForGc(nowMs, retentionMs, maxTombstones);
             }
             return false;
         }
+
+        bool persist() {
+            if (state) {
+                return state->persist();
+            }
+            return false;
+        }
     };
     std::unique_ptr<StateManager> m_stateManager;
 
@@ -235,6 +293,8 @@ private:
     std::string m_protocolE2eeKeyId;
     std::optional<EncryptionManager::Key> m_e2eeMasterKey;
     std::string m_e2eeKeyId;
+    std::size_t m_memoryBudgetBytes;
+    std::size_t m_parseThreads;
     
     bool m_initialized;
 };
@@ -3,6 +3,7 @@
 #include "infrastructure/sync/cloud_drive_sync_state.h"
 #include <common/logger.h>
 
+#include <algorithm>
 #include <cctype>
 #include <chrono>
 #include <cstdio>
@@ -54,6 +55,15 @@ std::vector<std::uint8_t> generateRandomBytes(std::size_t count) {
     return bytes;
 }
 
+std::string fileCursorDelta(const std::string& filePath, const CloudDriveSyncState::FileCursor& cursor) {
+    nlohmann::json delta;
+    delta["op"] = "file";
+    delta["path"] = filePath;
+    delta["last_offset"] = cursor.last_offset;
+    delta["error_count"] = cursor.error_count;
+    return delta.dump();
+}
+
 std::int64_t nowMs() {
     const auto now = std::chrono::system_clock::now();
     return static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count());
@@ -74,6 +84,10 @@ std::string CloudDriveSyncState::stateFilePath(const std::string& baseDirectory)
     return baseDirectory + "/sync_state.json";
 }
 
+std::string CloudDriveSyncState::journalFilePath(const std::string& baseDirectory) {
+    return baseDirectory + "/sync_state.journal";
+}
+
 std::string CloudDriveSyncState::backupCorruptedState(const std::string& stateFilePath) {
     const std::int64_t timestampMs = nowMs();
     const std::string backupPath = stateFilePath + ".corrupted." + std::to_string(timestampMs);
@@ -120,6 +134,7 @@ bool CloudDriveSyncState::loadState(const std::string& statePath) {
     }
 
     m_nextSeq = json.value("next_seq", std::uint64_t(1));
+    m_tombstoneHashVersion = json.value("tombstone_hash_version", 1);
 
     if (json.contains("devices") && json["devices"].is_object()) {
         for (const auto& [key, value] : json["devices"].items()) {
@@ -145,12 +160,10 @@ bool CloudDriveSyncState::loadState(const std::string& statePath) {
     if (json.contains("tombstones") && json["tombstones"].is_array()) {
         for (const auto& value : json["tombstones"]) {
             if (value.is_object()) {
-                Tombstone t;
-                t.item_type = value.value("item_type", std::string());
-                t.content_hash = value.value("content_hash", std::string());
-                t.ts_ms = value.value("ts_ms", std::int64_t(0));
-                if (!t.item_type.empty() && !t.content_hash.empty()) {
-                    m_tombstones.push_back(t);
+                const std::string itemType = value.value("item_type", std::string());
+                const std::string contentHash = value.value("content_hash", std::string());
+                if (!itemType.empty() && !contentHash.empty()) {
+                    applyTombstone(itemType, contentHash, value.value("ts_ms", std::int64_t(0)));
                 }
             }
         }
@@ -161,15 +174,80 @@ bool CloudDriveSyncState::loadState(const std::string& statePath) {
     return true;
 }
 
+// Applies journal lines in order. Replay stops at the first line that does
+// not parse: only the last line can be torn by a crash, and anything after a
+// damaged line cannot be trusted to apply in order. A damaged tail is folded
+// away right here (snapshot + truncate) so later appends never land behind it.
+std::size_t CloudDriveSyncState::replayJournal(const std::string& journalPath) {
+    std::ifstream journal(journalPath);
+    if (!journal.is_open()) {
+        return 0;
+    }
+
+    using Json = nlohmann::json;
+    std::size_t applied = 0;
+    bool damaged = false;
+    std::string line;
+    while (std::getline(journal, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        const Json delta = Json::parse(line, nullptr, false);
+        if (delta.is_discarded() || !delta.is_object()) {
+            PASTY_LOG_WARN("Core.SyncState", "Ignoring damaged journal tail after %zu entries", applied);
+            damaged = true;
+            break;
+        }
+
+        const std::string op = delta.value("op", std::string());
+        if (op == "next_seq") {
+            m_nextSeq = delta.value("next_seq", m_nextSeq);
+        } else if (op == "tombstone_hash_version") {
+            m_tombstoneHashVersion = delta.value("version", m_tombstoneHashVersion);
+        } else if (op == "device") {
+            auto& deviceState = m_remoteDevices[delta.value("device_id", std::string())];
+            deviceState.max_applied_seq = std::max(deviceState.max_applied_seq, delta.value("max_applied_seq", std::uint64_t(0)));
+        } else if (op == "file") {
+            auto& cursor = m_fileCursors[delta.value("path", std::string())];
+            cursor.last_offset = delta.value("last_offset", std::uint64_t(0));
+            cursor.error_count = delta.value("error_count", 0);
+        } else if (op == "tombstone") {
+            const std::string itemType = delta.value("item_type", std::string());
+            const std::string contentHash = delta.value("content_hash", std::string());
+            if (!itemType.empty() && !contentHash.empty()) {
+                applyTombstone(itemType, contentHash, delta.value("ts_ms", std::int64_t(0)));
+            }
+        }
+        ++applied;
+    }
+
+    journal.close();
+
+    m_journalEntries = applied;
+    if (applied > 0) {
+        PASTY_LOG_INFO("Core.SyncState", "Replayed %zu journal entries", applied);
+    }
+    if (damaged && !compact()) {
+        PASTY_LOG_ERROR("Core.SyncState", "Failed to compact damaged journal: %s", journalPath.c_str());
+    }
+    return applied;
+}
+
 bool CloudDriveSyncState::createDefaultState(const std::string& baseDirectory) {
     m_baseDirectory = baseDirectory;
     m_deviceId = generateDeviceId();
     m_nextSeq = 1;
+    m_tombstoneHashVersion = 1;
     m_remoteDevices.clear();
     m_fileCursors.clear();
+    m_tombstones.clear();
+    m_tombstonesByAge.clear();
+    m_journalEntries = 0;
 
     PASTY_LOG_INFO("Core.SyncState", "Created new default state: device_id=%s", m_deviceId.c_str());
 
+    // A journal without a usable snapshot belongs to a state we no longer have.
+    std::remove(journalFilePath(baseDirectory).c_str());
     return saveState();
 }
 
@@ -185,6 +263,7 @@ bool CloudDriveSyncState::saveStateImpl(const std::string& statePath) const {
     json["schema_version"] = SCHEMA_VERSION;
     json["device_id"] = m_deviceId;
     json["next_seq"] = m_nextSeq;
+    json["tombstone_hash_version"] = m_tombstoneHashVersion;
 
     Json devicesJson = Json::object();
     for (const auto& [deviceId, deviceState] : m_remoteDevices) {
@@ -203,8 +282,18 @@ bool CloudDriveSyncState::saveStateImpl(const std::string& statePath) const {
     }
     json["files"] = filesJson;
 
+    std::vector<const TombstoneEntry*> tombstones;
+    tombstones.reserve(m_tombstones.size());
+    for (const auto& entry : m_tombstones) {
+        tombstones.push_back(&entry.second);
+    }
+    std::sort(tombstones.begin(), tombstones.end(), [](const TombstoneEntry* a, const TombstoneEntry* b) {
+        return a->order < b->order;
+    });
+
     Json tombstonesJson = Json::array();
-    for (const auto& t : m_tombstones) {
+    for (const TombstoneEntry* entry : tombstones) {
+        const Tombstone& t = entry->tombstone;
         Json tombstoneJson;
         tombstoneJson["item_type"] = t.item_type;
         tombstoneJson["content_hash"] = t.content_hash;
@@ -235,6 +324,47 @@ bool CloudDriveSyncState::saveStateImpl(const std::string& statePath) const {
     return true;
 }
 
+bool CloudDriveSyncState::appendJournal(const std::string& line) {
+    const std::string journalPath = journalFilePath(m_baseDirectory);
+    std::FILE* journal = std::fopen(journalPath.c_str(), "a+b");
+    bool ok = journal != nullptr;
+    if (ok) {
+        // Start on a fresh line even if the previous append was cut short
+        // before its newline; replay skips the blank line this may leave.
+        std::string entry;
+        if (std::fseek(journal, -1, SEEK_END) == 0 && std::fgetc(journal) != '\n') {
+            entry.push_back('\n');
+        }
+        entry += line + "\n";
+        ok = std::fwrite(entry.data(), 1, entry.size(), journal) == entry.size();
+        ok = std::fclose(journal) == 0 && ok;
+    }
+    if (!ok) {
+        // The change is only in memory now; a full snapshot still records it.
+        PASTY_LOG_WARN("Core.SyncState", "Failed to append to journal: %s", journalPath.c_str());
+        return compact();
+    }
+
+    if (++m_journalEntries >= kJournalCompactEntries) {
+        return compact();
+    }
+    return true;
+}
+
+bool CloudDriveSyncState::compact() {
+    if (!saveState()) {
+        return false;
+    }
+    // Truncated in place rather than removed: another instance appending
+    // with O_APPEND keeps writing to the live file.
+    std::FILE* journal = std::fopen(journalFilePath(m_baseDirectory).c_str(), "wb");
+    if (journal != nullptr) {
+        std::fclose(journal);
+    }
+    m_journalEntries = 0;
+    return true;
+}
+
 std::optional<CloudDriveSyncState> CloudDriveSyncState::LoadOrCreate(const std::string& baseDirectory) {
     if (!ensureDirectoryExists(baseDirectory)) {
         PASTY_LOG_ERROR("Core.SyncState", "Failed to ensure base directory: %s", baseDirectory.c_str());
@@ -251,6 +381,7 @@ std::optional<CloudDriveSyncState> CloudDriveSyncState::LoadOrCreate(const std::
 
     if (fileExists) {
         if (state.loadState(statePath)) {
+            state.replayJournal(journalFilePath(baseDirectory));
             return std::make_optional<CloudDriveSyncState>(std::move(state));
         }
 
@@ -297,13 +428,33 @@ CloudDriveSyncState::FileCursor CloudDriveSyncState::getFileCursor(const std::st
     return kEmptyCursor;
 }
 
+std::uint64_t CloudDriveSyncState::totalFileErrorCount() const {
+    std::lock_guard<std::mutex> lock(*m_mutex);
+
+    std::uint64_t total = 0;
+    for (const auto& [unusedPath, cursor] : m_fileCursors) {
+        (void)unusedPath;
+        if (cursor.error_count > 0) {
+            total += static_cast<std::uint64_t>(cursor.error_count);
+        }
+    }
+    return total;
+}
+
 std::uint64_t CloudDriveSyncState::reserveNextSeq() {
+    return reserveSeqBlock(1);
+}
+
+std::uint64_t CloudDriveSyncState::reserveSeqBlock(std::uint64_t count) {
     std::lock_guard<std::mutex> lock(*m_mutex);
 
     const std::uint64_t seq = m_nextSeq;
-    ++m_nextSeq;
+    m_nextSeq += std::max<std::uint64_t>(count, 1);
 
-    if (!saveState()) {
+    nlohmann::json delta;
+    delta["op"] = "next_seq";
+    delta["next_seq"] = m_nextSeq;
+    if (!appendJournal(delta.dump())) {
         PASTY_LOG_WARN("Core.SyncState", "Failed to persist state after reserving seq %lu", static_cast<unsigned long>(seq));
     }
 
@@ -322,7 +473,7 @@ bool CloudDriveSyncState::regenerateDeviceId() {
     m_deviceId = newDeviceId;
     m_nextSeq = 1;
 
-    if (!saveState()) {
+    if (!compact()) {
         PASTY_LOG_ERROR("Core.SyncState", "Failed to persist regenerated device_id");
         return false;
     }
@@ -342,7 +493,11 @@ bool CloudDriveSyncState::updateRemoteDeviceMaxSeq(const std::string& remoteDevi
 
     deviceState.max_applied_seq = newSeq;
 
-    return saveState();
+    nlohmann::json delta;
+    delta["op"] = "device";
+    delta["device_id"] = remoteDeviceId;
+    delta["max_applied_seq"] = newSeq;
+    return appendJournal(delta.dump());
 }
 
 bool CloudDriveSyncState::updateFileCursor(const std::string& filePath, std::uint64_t offset) {
@@ -355,7 +510,7 @@ bool CloudDriveSyncState::updateFileCursor(const std::string& filePath, std::uin
 
     cursor.last_offset = offset;
 
-    return saveState();
+    return appendJournal(fileCursorDelta(filePath, cursor));
 }
 
 int CloudDriveSyncState::incrementFileErrorCount(const std::string& filePath) {
@@ -364,34 +519,67 @@ int CloudDriveSyncState::incrementFileErrorCount(const std::string& filePath) {
     auto& cursor = m_fileCursors[filePath];
     ++cursor.error_count;
 
-    saveState();
+    appendJournal(fileCursorDelta(filePath, cursor));
 
     return cursor.error_count;
 }
 
 bool CloudDriveSyncState::persist() {
     std::lock_guard<std::mutex> lock(*m_mutex);
-    return saveState();
+    if (m_journalEntries == 0) {
+        return true;
+    }
+    return compact();
 }
 
-bool CloudDriveSyncState::recordTombstone(const std::string& itemType, const std::string& contentHash, std::int64_t tsMs) {
-    std::lock_guard<std::mutex> lock(*m_mutex);
+std::string CloudDriveSyncState::tombstoneKey(const std::string& itemType, const std::string& contentHash) {
+    return itemType + ":" + contentHash;
+}
 
-    for (const auto& t : m_tombstones) {
-        if (t.item_type == itemType && t.content_hash == contentHash) {
-            if (tsMs <= t.ts_ms) {
-                return true;
-            }
+// Returns false when an equal or newer tombstone already covers the item.
+bool CloudDriveSyncState::applyTombstone(const std::string& itemType, const std::string& contentHash, std::int64_t tsMs) {
+    const std::string key = tombstoneKey(itemType, contentHash);
+    auto found = m_tombstones.find(key);
+    if (found != m_tombstones.end()) {
+        if (tsMs <= found->second.tombstone.ts_ms) {
+            return false;
         }
+        m_tombstonesByAge.erase({found->second.tombstone.ts_ms, key});
+        found->second.tombstone.ts_ms = tsMs;
+    } else {
+        TombstoneEntry entry;
+        entry.tombstone.item_type = itemType;
+        entry.tombstone.content_hash = contentHash;
+        entry.tombstone.ts_ms = tsMs;
+        entry.order = m_nextTombstoneOrder++;
+        m_tombstones.emplace(key, std::move(entry));
+    }
+    m_tombstonesByAge.emplace(tsMs, key);
+    return true;
+}
+
+void CloudDriveSyncState::eraseTombstone(const std::string& key) {
+    auto found = m_tombstones.find(key);
+    if (found == m_tombstones.end()) {
+        return;
     }
+    m_tombstonesByAge.erase({found->second.tombstone.ts_ms, key});
+    m_tombstones.erase(found);
+}
 
-    Tombstone t;
-    t.item_type = itemType;
-    t.content_hash = contentHash;
-    t.ts_ms = tsMs;
-    m_tombstones.push_back(t);
+bool CloudDriveSyncState::recordTombstone(const std::string& itemType, const std::string& contentHash, std::int64_t tsMs) {
+    std::lock_guard<std::mutex> lock(*m_mutex);
 
-    return saveState();
+    if (!applyTombstone(itemType, contentHash, tsMs)) {
+        return true;
+    }
+
+    nlohmann::json delta;
+    delta["op"] = "tombstone";
+    delta["item_type"] = itemType;
+    delta["content_hash"] = contentHash;
+    delta["ts_ms"] = tsMs;
+    return appendJournal(delta.dump());
 }
 
 bool CloudDriveSyncState::shouldSkipUpsertDueToTombstone(const std::string& itemType,
@@ -399,37 +587,67 @@ bool CloudDriveSyncState::shouldSkipUpsertDueToTombstone(const std::string& item
                                                          std::int64_t eventTsMs) const {
     std::lock_guard<std::mutex> lock(*m_mutex);
 
-    for (const auto& t : m_tombstones) {
-        if (t.item_type == itemType && t.content_hash == contentHash) {
-            if (t.ts_ms >= eventTsMs) {
-                return true;
-            }
+    const auto found = m_tombstones.find(tombstoneKey(itemType, contentHash));
+    return found != m_tombstones.end() && found->second.tombstone.ts_ms >= eventTsMs;
+}
+
+bool CloudDriveSyncState::migrateTombstoneHashes(std::int32_t hashVersion,
+                                                 const std::function<std::string(const Tombstone&)>& resolve) {
+    std::lock_guard<std::mutex> lock(*m_mutex);
+    if (m_tombstoneHashVersion >= hashVersion) {
+        return true;
+    }
+
+    std::vector<Tombstone> rekeyed;
+    for (const auto& entry : m_tombstones) {
+        Tombstone tombstone = entry.second.tombstone;
+        tombstone.content_hash = resolve(entry.second.tombstone);
+        if (!tombstone.content_hash.empty() && tombstone.content_hash != entry.second.tombstone.content_hash) {
+            rekeyed.push_back(std::move(tombstone));
         }
     }
 
-    return false;
+    bool ok = true;
+    for (const Tombstone& tombstone : rekeyed) {
+        if (!applyTombstone(tombstone.item_type, tombstone.content_hash, tombstone.ts_ms)) {
+            continue;
+        }
+        nlohmann::json delta;
+        delta["op"] = "tombstone";
+        delta["item_type"] = tombstone.item_type;
+        delta["content_hash"] = tombstone.content_hash;
+        delta["ts_ms"] = tombstone.ts_ms;
+        ok = appendJournal(delta.dump()) && ok;
+    }
+
+    m_tombstoneHashVersion = hashVersion;
+    nlohmann::json delta;
+    delta["op"] = "tombstone_hash_version";
+    delta["version"] = hashVersion;
+    ok = appendJournal(delta.dump()) && ok;
+
+    if (!rekeyed.empty()) {
+        PASTY_LOG_INFO("Core.SyncState", "Re-keyed %zu tombstones to content hash version %d", rekeyed.size(), hashVersion);
+    }
+    return ok;
 }
 
 bool CloudDriveSyncState::pruneForGc(std::int64_t nowMs, std::int64_t retentionMs, std::size_t maxTombstones) {
     std::lock_guard<std::mutex> lock(*m_mutex);
     bool changed = false;
 
-    // 1. Prune tombstones by time
+    // 1. Prune tombstones by time (oldest first from the age index)
     const std::int64_t cutoffMs = nowMs - retentionMs;
-    auto it = std::remove_if(m_tombstones.begin(), m_tombstones.end(), [cutoffMs](const Tombstone& t) {
-        return t.ts_ms < cutoffMs;
-    });
-    if (it != m_tombstones.end()) {
-        m_tombstones.erase(it, m_tombstones.end());
+    while (!m_tombstonesByAge.empty() && m_tombstonesByAge.begin()->first < cutoffMs) {
+        const std::string key = m_tombstonesByAge.begin()->second;
+        eraseTombstone(key);
         changed = true;
     }
 
     // 2. Prune tombstones by count (keep newest)
-    if (m_tombstones.size() > maxTombstones) {
-        std::sort(m_tombstones.begin(), m_tombstones.end(), [](const Tombstone& a, const Tombstone& b) {
-            return a.ts_ms > b.ts_ms; // Newest first
-        });
-        m_tombstones.erase(m_tombstones.begin() + maxTombstones, m_tombstones.end());
+    while (m_tombstones.size() > maxTombstones) {
+        const std::string key = m_tombstonesByAge.begin()->second;
+        eraseTombstone(key);
         changed = true;
     }
 
@@ -447,7 +665,7 @@ bool CloudDriveSyncState::pruneForGc(std::int64_t nowMs, std::int64_t retentionM
 
     if (changed) {
         PASTY_LOG_INFO("Core.SyncState", "State GC performed: %zu tombstones remaining", m_tombstones.size());
-        return saveState();
+        return compact();
     }
 
     return false;
@@ -1,12 +1,16 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <set>
+#include <utility>
 
 namespace pasty {
 
@@ -18,10 +22,21 @@ namespace pasty {
  *
  * Schema version: 1
  * - Required fields: schema_version, device_id, next_seq
- * - Optional fields: devices (per-device max_applied_seq), files (per-file cursor/error_count)
+ * - Optional fields: devices (per-device max_applied_seq), files (per-file cursor/error_count),
+ *   tombstones, tombstone_hash_version (content hash version of the tombstones, default 1)
  *
- * All operations are thread-safe and use atomic writes (temp + rename).
- * Corruption recovery: corrupted state files are backed up and recreated.
+ * Persistence is journaled. Each mutation appends one delta line to
+ * <baseDirectory>/sync_state.journal instead of rewriting the whole file;
+ * persist() is the commit point that writes a full snapshot (temp + rename)
+ * and truncates the journal. Loading replays the journal over the snapshot,
+ * so a crash between commits loses nothing that reached the journal. Deltas
+ * carry absolute values, so replaying one the snapshot already includes is
+ * harmless. The journal is also compacted once it reaches
+ * kJournalCompactEntries lines.
+ *
+ * All operations are thread-safe.
+ * Corruption recovery: corrupted state files are backed up and recreated; a
+ * torn last journal line is ignored.
  */
 class CloudDriveSyncState {
 public:
@@ -63,51 +78,66 @@ public:
      */
     static std::optional<CloudDriveSyncState> LoadOrCreate(const std::string& baseDirectory);
 
+    static constexpr std::size_t kJournalCompactEntries = 4096;
+
     // Getters
     std::string deviceId() const;
     std::uint64_t nextSeq() const;
     RemoteDeviceState getRemoteDeviceState(const std::string& deviceId) const;
     FileCursor getFileCursor(const std::string& filePath) const;
+    // Sum of error_count over all file cursors.
+    std::uint64_t totalFileErrorCount() const;
 
-    // Mutating operations (persist on change)
+    // Mutating operations (journaled on change)
 
     /**
      * Reserve next sequence number
      *
-     * Increments next_seq atomically and persists to disk.
+     * Increments next_seq atomically and journals the new value.
      *
      * @return The reserved sequence number
      */
     std::uint64_t reserveNextSeq();
 
+    /**
+     * Reserve a contiguous block of sequence numbers
+     *
+     * Advances next_seq by count with a single journal entry. Seqs in the
+     * block that are never used are simply skipped; importers tolerate gaps.
+     *
+     * @param count Block size (at least 1)
+     * @return The first sequence number of the block
+     */
+    std::uint64_t reserveSeqBlock(std::uint64_t count);
+
     bool regenerateDeviceId();
 
     /**
      * Update per-remote-device max_applied_seq
      *
-     * If newSeq > current max_applied_seq, updates and persists.
+     * If newSeq > current max_applied_seq, updates and journals it.
      *
      * @param remoteDeviceId The remote device ID
      * @param newSeq The new max applied sequence number
-     * @return true if updated, false if no change or persist failed
+     * @return true if updated, false if no change or the write failed
      */
     bool updateRemoteDeviceMaxSeq(const std::string& remoteDeviceId, std::uint64_t newSeq);
 
     /**
      * Update per-file cursor
      *
-     * Updates last_offset and persists.
+     * Updates last_offset and journals it.
      *
      * @param filePath The log file path (relative or absolute)
      * @param offset The new last_offset value
-     * @return true if updated and persisted, false on failure
+     * @return true if updated and journaled, false on failure
      */
     bool updateFileCursor(const std::string& filePath, std::uint64_t offset);
 
     /**
      * Increment per-file error count
      *
-     * Increments error_count for a file and persists.
+     * Increments error_count for a file and journals it.
      *
      * @param filePath The log file path
      * @return The new error count
@@ -115,9 +145,11 @@ public:
     int incrementFileErrorCount(const std::string& filePath);
 
     /**
-     * Force persist current state to disk
+     * Commit point: write the full state file and truncate the journal
      *
-     * @return true if persisted successfully, false on failure
+     * Does nothing if nothing was journaled since the last commit.
+     *
+     * @return true if the state file is up to date, false on failure
      */
     bool persist();
 
@@ -130,7 +162,7 @@ public:
      * @param itemType The item type ("text" or "image")
      * @param contentHash The 16-character lowercase hex content hash
      * @param tsMs The timestamp of the delete event
-     * @return true if recorded and persisted, false on failure
+     * @return true if recorded and journaled, false on failure
      */
     bool recordTombstone(const std::string& itemType, const std::string& contentHash, std::int64_t tsMs);
 
@@ -147,6 +179,20 @@ public:
      */
     bool shouldSkipUpsertDueToTombstone(const std::string& itemType, const std::string& contentHash, std::int64_t eventTsMs) const;
 
+    /**
+     * Re-key tombstones recorded under an older content hash version
+     *
+     * Once per hash version: every tombstone whose hash resolve() maps to a
+     * different one is also recorded under that hash, with the same ts_ms,
+     * and the state remembers that its tombstones are at hashVersion.
+     *
+     * @param hashVersion The current content hash version
+     * @param resolve Maps a tombstone to the current hash of its content
+     * @return true if the migration ran (or was not needed) and was journaled
+     */
+    bool migrateTombstoneHashes(std::int32_t hashVersion,
+                                const std::function<std::string(const Tombstone&)>& resolve);
+
     /**
      * Prune old state entries (GC)
      *
@@ -165,20 +211,42 @@ private:
     // Implementation details
     static std::string generateDeviceId();
     static std::string stateFilePath(const std::string& baseDirectory);
+    static std::string journalFilePath(const std::string& baseDirectory);
     static std::string backupCorruptedState(const std::string& stateFilePath);
 
     bool loadState(const std::string& statePath);
+    std::size_t replayJournal(const std::string& journalPath);
     bool createDefaultState(const std::string& baseDirectory);
     bool saveState() const;
     bool saveStateImpl(const std::string& statePath) const;
+    // Callers hold m_mutex.
+    bool appendJournal(const std::string& line);
+    bool compact();
+    bool applyTombstone(const std::string& itemType, const std::string& contentHash, std::int64_t tsMs);
+    void eraseTombstone(const std::string& key);
+    static std::string tombstoneKey(const std::string& itemType, const std::string& contentHash);
+
+    struct TombstoneEntry {
+        Tombstone tombstone;
+        // Insertion order; the snapshot lists tombstones in this order.
+        std::uint64_t order = 0;
+    };
 
     std::string m_baseDirectory;
     std::string m_deviceId;
     std::uint64_t m_nextSeq = 1;
+    // Content hash version the tombstones were last migrated to.
+    std::int32_t m_tombstoneHashVersion = 1;
 
     std::unordered_map<std::string, RemoteDeviceState> m_remoteDevices;
     std::unordered_map<std::string, FileCursor> m_fileCursors;
-    std::vector<Tombstone> m_tombstones;
+    // One entry per (item_type, content_hash) holding the newest delete, plus
+    // an index ordered by ts_ms so GC evicts from the old end.
+    std::unordered_map<std::string, TombstoneEntry> m_tombstones;
+    std::set<std::pair<std::int64_t, std::string>> m_tombstonesByAge;
+    std::uint64_t m_nextTombstoneOrder = 0;
+    // Journal lines written since the last snapshot.
+    std::size_t m_journalEntries = 0;
 
     mutable std::shared_ptr<std::mutex> m_mutex;
 };
@@ -7,72 +7,18 @@
 #include "../infrastructure/sync/cloud_drive_sync_protocol_info.h"
 #include "../infrastructure/sync/cloud_drive_sync_state.h"
 #include "../infrastructure/sync/cloud_drive_sync_pruner.h"
+#include "../utils/content_hash.h"
 #include "../utils/runtime_json_utils.h"
 #include "../store/sqlite_clipboard_history_store.h"
 
 #include <algorithm>
-#include <fstream>
 #include <iomanip>
 #include <sstream>
 
 #include <sodium.h>
 
-#include "../thirdparty/nlohmann/json.hpp"
-
 namespace pasty {
 
-namespace {
-
-constexpr std::uint64_t kFnvOffset = 1469598103934665603ULL;
-constexpr std::uint64_t kFnvPrime = 1099511628211ULL;
-
-std::string normalizeTextForHash(const std::string& text) {
-    std::string normalized;
-    normalized.reserve(text.size());
-
-    for (std::size_t i = 0; i < text.size(); ++i) {
-        if (text[i] == '\r') {
-            if (i + 1 < text.size() && text[i + 1] == '\n') {
-                continue;
-            }
-            normalized.push_back('\n');
-            continue;
-        }
-        normalized.push_back(text[i]);
-    }
-
-    return normalized;
-}
-
-std::uint64_t hashBytes(const std::uint8_t* bytes, std::size_t length) {
-    std::uint64_t hash = kFnvOffset;
-    for (std::size_t i = 0; i < length; ++i) {
-        hash ^= static_cast<std::uint64_t>(bytes[i]);
-        hash *= kFnvPrime;
-    }
-    return hash;
-}
-
-std::string toHex(std::uint64_t value) {
-    std::ostringstream stream;
-    stream << std::hex << std::setfill('0') << std::setw(16) << value;
-    return stream.str();
-}
-
-std::string computeTextHash(const std::string& text) {
-    const std::string normalized = normalizeTextForHash(text);
-    return toHex(hashBytes(reinterpret_cast<const std::uint8_t*>(normalized.data()), normalized.size()));
-}
-
-std::string computeImageHash(const std::vector<std::uint8_t>& bytes) {
-    if (bytes.empty()) {
-        return std::string();
-    }
-    return toHex(hashBytes(bytes.data(), bytes.size()));
-}
-
-}
-
 CoreRuntime::CoreRuntime(CoreRuntimeConfig config)
     : m_config(std::move(config))
     , m_started(false) {
@@ -88,11 +34,38 @@ bool CoreRuntime::start() {
     }
 
     m_settingsStore = std::make_unique<InMemorySettingsStore>(m_config.defaultMaxHistoryCount);
-    auto store = createClipboardHistoryStore();
-    m_clipboardService = std::make_unique<ClipboardService>(std::move(store), *m_settingsStore);
+    ClipboardHistoryStoreOptions storeOptions;
+    storeOptions.walEnabled = m_config.historyWalEnabled;
+    storeOptions.synchronous = m_config.historySynchronous;
+    storeOptions.cacheSizeKiB = m_config.historyCacheSizeKiB;
+    storeOptions.mmapSizeBytes = m_config.historyMmapSizeBytes;
+    storeOptions.readerConnections = m_config.historyReaderConnections;
+    storeOptions.inlineImageMaxBytes = m_config.historyInlineImageMaxBytes > 0
+        ? static_cast<std::size_t>(m_config.historyInlineImageMaxBytes)
+        : 0;
+    DurableAssetWriterOptions writerOptions;
+    writerOptions.durability = parseAssetDurability(m_config.historyAssetDurability);
+    writerOptions.groupBatchSize = m_config.historyAssetSyncBatch > 0
+        ? static_cast<std::size_t>(m_config.historyAssetSyncBatch)
+        : 1;
+    m_assetWriter = std::make_shared<DurableAssetWriter>(writerOptions);
+    storeOptions.assetWriter = m_assetWriter;
+    std::unique_ptr<ClipboardHistoryStore> store = createClipboardHistoryStore(storeOptions);
+    m_historyCache = nullptr;
+    if (m_config.historyItemCacheCapacity > 0) {
+        auto cached = std::make_unique<CachedClipboardHistoryStore>(
+            std::move(store), static_cast<std::size_t>(m_config.historyItemCacheCapacity));
+        m_historyCache = cached.get();
+        store = std::move(cached);
+    }
+    ClipboardServiceOptions serviceOptions;
+    serviceOptions.coalesceWindowMs = std::max<std::int64_t>(m_config.historyCoalesceWindowMs, 0);
+    m_clipboardService = std::make_unique<ClipboardService>(std::move(store), *m_settingsStore, serviceOptions);
 
     if (!m_clipboardService->initialize(m_config.storageDirectory)) {
+        m_historyCache = nullptr;
         m_clipboardService.reset();
+        m_assetWriter.reset();
         m_settingsStore.reset();
         return false;
     }
@@ -114,10 +87,12 @@ void CoreRuntime::stop() {
 
     if (m_clipboardService) {
         m_clipboardService->shutdown();
+        m_historyCache = nullptr;
         m_clipboardService.reset();
     }
 
     m_syncExporter.reset();
+    m_assetWriter.reset();
     m_settingsStore.reset();
     m_started = false;
 }
@@ -211,7 +186,8 @@ bool CoreRuntime::ensureCloudSyncExporter() {
         m_config.cloudSyncRootPath,
         m_config.storageDirectory,
         m_cloudSyncE2eeMasterKey,
-        m_cloudSyncE2eeKeyId);
+        m_cloudSyncE2eeKeyId,
+        m_assetWriter);
     if (!exporter.has_value()) {
         return false;
     }
@@ -258,6 +234,7 @@ bool CoreRuntime::runCloudSyncImport() {
         m_lastImportStatus = CloudSyncImportStatus{};
         return false;
     }
+    importer->setMemoryBudgetBytes(static_cast<std::size_t>(std::max<std::int64_t>(m_config.cloudSyncImportMemoryBudgetBytes, 0)));
 
     const CloudDriveSyncImporter::ImportResult importResult = importer->importChanges(*m_clipboardService);
     PASTY_LOG_INFO("Core.Runtime", "Cloud sync import finished (success: %s, processed: %zu, applied: %zu, skipped: %zu, errors: %zu)",
@@ -346,6 +323,13 @@ void CoreRuntime::clearCloudSyncE2eeKey() {
     m_cloudSyncE2eeKeyId.clear();
 }
 
+std::optional<ClipboardHistoryCacheStats> CoreRuntime::historyCacheStats() const {
+    if (m_historyCache == nullptr) {
+        return std::nullopt;
+    }
+    return m_historyCache->cacheStats();
+}
+
 CloudSyncStatus CoreRuntime::cloudSyncStatus() const {
     CloudSyncStatus status;
     status.enabled = m_config.cloudSyncEnabled;
@@ -370,9 +354,9 @@ CloudSyncStatus CoreRuntime::cloudSyncStatus() const {
 
 std::string CoreRuntime::computeContentHash(const ClipboardHistoryIngestEvent& event) {
     if (event.itemType == ClipboardItemType::Image) {
-        return computeImageHash(event.image.bytes);
+        return content_hash::computeImageHash(event.image.view());
     }
-    return computeTextHash(event.text);
+    return content_hash::computeTextHash(event.text);
 }
 
 bool CoreRuntime::exportLocalTextIngest(const ClipboardHistoryIngestEvent& event, bool inserted) {
@@ -389,7 +373,7 @@ bool CoreRuntime::exportLocalTextIngest(const ClipboardHistoryIngestEvent& event
     return m_syncExporter->exportTextItem(item) == CloudDriveSyncExporter::ExportResult::Success;
 }
 
-bool CoreRuntime::exportLocalImageIngest(const ClipboardHistoryIngestEvent& event, bool inserted) {
+bool CoreRuntime::exportLocalImageIngest(const ClipboardHistoryIngestEvent& event, bool inserted, const std::string& contentHash) {
     if (!inserted || !ensureCloudSyncExporter() || !m_syncExporter.has_value()) {
         return false;
     }
@@ -399,10 +383,10 @@ bool CoreRuntime::exportLocalImageIngest(const ClipboardHistoryIngestEvent& even
     item.imageWidth = event.image.width;
     item.imageHeight = event.image.height;
     item.imageFormat = event.image.formatHint;
-    item.contentHash = computeContentHash(event);
+    item.contentHash = contentHash.empty() ? computeContentHash(event) : contentHash;
     item.sourceAppId = event.sourceAppId;
 
-    return m_syncExporter->exportImageItem(item, event.image.bytes) == CloudDriveSyncExporter::ExportResult::Success;
+    return m_syncExporter->exportImageItem(item, event.image.view()) == CloudDriveSyncExporter::ExportResult::Success;
 }
 
 bool CoreRuntime::exportLocalDelete(const ClipboardHistoryItem& deletedItem, bool deleted) {
@@ -432,37 +416,11 @@ std::string CoreRuntime::loadSyncDeviceId() const {
 }
 
 std::uint64_t CoreRuntime::loadSyncFileErrorCount() const {
-    const std::string statePath = m_config.storageDirectory + "/sync_state.json";
-    std::ifstream file(statePath);
-    if (!file.is_open()) {
-        return 0;
-    }
-
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    if (content.empty()) {
-        return 0;
-    }
-
-    using Json = nlohmann::json;
-    Json json = Json::parse(content, nullptr, false);
-    if (json.is_discarded() || !json.is_object() || !json.contains("files") || !json["files"].is_object()) {
+    auto state = CloudDriveSyncState::LoadOrCreate(m_config.storageDirectory);
+    if (!state.has_value()) {
         return 0;
     }
-
-    std::uint64_t total = 0;
-    for (const auto& [unusedPath, cursor] : json["files"].items()) {
-        (void)unusedPath;
-        if (!cursor.is_object()) {
-            continue;
-        }
-
-        const int fileErrors = cursor.value("error_count", 0);
-        if (fileErrors > 0) {
-            total += static_cast<std::uint64_t>(fileErrors);
-        }
-    }
-
-    return total;
+    return state->totalFileErrorCount();
 }
 
 } // namespace pasty
@@ -2,7 +2,9 @@
 
 #include "../application/history/clipboard_service.h"
 #include "../infrastructure/crypto/encryption_manager.h"
+#include "../infrastructure/storage/durable_asset_writer.h"
 #include "../infrastructure/sync/cloud_drive_sync_exporter.h"
+#include "../store/cached_clipboard_history_store.h"
 #include "../ports/settings_store.h"
 
 #include <cstdint>
@@ -17,10 +19,38 @@ struct CoreRuntimeConfig {
     std::string storageDirectory = "./build/history";
     std::string migrationDirectory;
     int defaultMaxHistoryCount = 1000;
+    // History database tuning; reader connections need WAL.
+    bool historyWalEnabled = true;
+    std::string historySynchronous = "NORMAL";
+    int historyCacheSizeKiB = 8192;
+    std::int64_t historyMmapSizeBytes = 64LL * 1024 * 1024;
+    int historyReaderConnections = 2;
+    // Items kept in the in-memory LRU in front of the store; 0 disables it.
+    int historyItemCacheCapacity = 512;
+    // Asset fsync policy shared by the store and the sync exporter: "none",
+    // "file" or "group" (one barrier per batch of up to historyAssetSyncBatch).
+    std::string historyAssetDurability = "group";
+    int historyAssetSyncBatch = 16;
+    // Images up to this size are stored inside the database row; 0 keeps all
+    // images as files. Hosts must read such images through the store rather
+    // than from imagePath, which is empty for them.
+    std::int64_t historyInlineImageMaxBytes = 0;
+    // Async ingest (pasty_history_ingest_text_async): events that may wait for
+    // the background writer, 0 disabling async ingest, and the most it commits
+    // in one transaction.
+    int historyIngestQueueCapacity = 1024;
+    int historyIngestBatchSize = 64;
+    // Repeats of the item just stored that arrive within this window (e.g. an
+    // app writing the pasteboard several times per copy) are absorbed in
+    // memory; 0 sends every event to the store.
+    std::int64_t historyCoalesceWindowMs = 250;
     bool cloudSyncEnabled = false;
     std::string cloudSyncRootPath;
     bool cloudSyncIncludeSensitive = false;
     bool cloudSyncIncludeSourceAppId = true;
+    // Parsed remote events an import may hold before applying them; logs are
+    // streamed, so this bounds memory rather than the size of the backlog.
+    std::int64_t cloudSyncImportMemoryBudgetBytes = 16LL * 1024 * 1024;
 };
 
 struct CloudSyncImportStatus {
@@ -65,9 +95,12 @@ public:
     bool initializeCloudSyncE2ee(const std::string& passphrase);
     void clearCloudSyncE2eeKey();
     CloudSyncStatus cloudSyncStatus() const;
+    std::optional<ClipboardHistoryCacheStats> historyCacheStats() const;
 
     bool exportLocalTextIngest(const ClipboardHistoryIngestEvent& event, bool inserted);
-    bool exportLocalImageIngest(const ClipboardHistoryIngestEvent& event, bool inserted);
+    // contentHash is the hash the ingest already computed (ClipboardIngestResult);
+    // when empty the bytes are hashed again.
+    bool exportLocalImageIngest(const ClipboardHistoryIngestEvent& event, bool inserted, const std::string& contentHash = std::string());
     bool exportLocalDelete(const ClipboardHistoryItem& deletedItem, bool deleted);
     bool exportLocalTags(const ClipboardHistoryItem& item, const std::vector<std::string>& tags);
 
@@ -81,7 +114,10 @@ private:
 
     CoreRuntimeConfig m_config;
     std::unique_ptr<SettingsStore> m_settingsStore;
+    std::shared_ptr<DurableAssetWriter> m_assetWriter;
     std::unique_ptr<ClipboardService> m_clipboardService;
+    // Owned by m_clipboardService; null when the cache is disabled.
+    CachedClipboardHistoryStore* m_historyCache = nullptr;
     std::optional<CloudSyncImportStatus> m_lastImportStatus;
     std::string m_syncDeviceId;
     std::int64_t m_lastCloudSyncPruneMs = 0;
@@ -0,0 +1,282 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#include "store/cached_clipboard_history_store.h"
+
+#include <iterator>
+#include <utility>
+
+namespace pasty {
+
+CachedClipboardHistoryStore::CachedClipboardHistoryStore(std::unique_ptr<ClipboardHistoryStore> store, std::size_t capacity)
+    : m_store(std::move(store))
+    , m_capacity(capacity)
+    , m_generation(0)
+    , m_retentionGeneration(0) {
+    m_stats.capacity = capacity;
+}
+
+bool CachedClipboardHistoryStore::open(const std::string& baseDirectory) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        clearLocked();
+    }
+    const bool opened = m_store->open(baseDirectory);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_retentionGeneration = m_store->retentionGeneration();
+    return opened;
+}
+
+void CachedClipboardHistoryStore::close() {
+    m_store->close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    clearLocked();
+}
+
+ClipboardHistoryUpsertResult CachedClipboardHistoryStore::upsertTextItem(const ClipboardHistoryItem& item) {
+    ClipboardHistoryUpsertResult result = m_store->upsertTextItem(item);
+    invalidate(item.id, ClipboardItemType::Text, item.contentHash);
+    invalidateId(result.id);
+    return result;
+}
+
+ClipboardHistoryUpsertResult CachedClipboardHistoryStore::upsertImageItem(const ClipboardHistoryItem& item, ImageBytesView imageBytes) {
+    ClipboardHistoryUpsertResult result = m_store->upsertImageItem(item, imageBytes);
+    invalidate(item.id, ClipboardItemType::Image, item.contentHash);
+    invalidateId(result.id);
+    return result;
+}
+
+std::string CachedClipboardHistoryStore::reserveStagingPath() {
+    return m_store->reserveStagingPath();
+}
+
+ClipboardHistoryUpsertResult CachedClipboardHistoryStore::upsertStagedImageItem(const ClipboardHistoryItem& item, const std::string& stagingPath) {
+    ClipboardHistoryUpsertResult result = m_store->upsertStagedImageItem(item, stagingPath);
+    invalidate(item.id, ClipboardItemType::Image, item.contentHash);
+    invalidateId(result.id);
+    return result;
+}
+
+std::vector<ClipboardHistoryUpsertResult> CachedClipboardHistoryStore::upsertItems(const std::vector<ClipboardHistoryUpsertRequest>& requests) {
+    std::vector<ClipboardHistoryUpsertResult> results = m_store->upsertItems(requests);
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        const ClipboardHistoryItem& item = requests[i].item;
+        invalidate(item.id, item.type, item.contentHash);
+        if (i < results.size()) {
+            invalidateId(results[i].id);
+        }
+    }
+    return results;
+}
+
+std::optional<ClipboardHistoryItem> CachedClipboardHistoryStore::getItem(const std::string& id) {
+    std::uint64_t generation = 0;
+    if (auto cached = lookup(m_byId, id, generation)) {
+        return cached;
+    }
+
+    auto item = m_store->getItem(id);
+    if (item) {
+        fill(*item, generation);
+    }
+    return item;
+}
+
+std::optional<ClipboardHistoryItem> CachedClipboardHistoryStore::getItemByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash) {
+    std::uint64_t generation = 0;
+    if (auto cached = lookup(m_byHash, hashKey(type, contentHash), generation)) {
+        return cached;
+    }
+
+    auto item = m_store->getItemByTypeAndContentHash(type, contentHash);
+    if (item) {
+        fill(*item, generation);
+    }
+    return item;
+}
+
+ClipboardHistoryListResult CachedClipboardHistoryStore::listItems(std::int32_t limit, const std::string& cursor) {
+    return m_store->listItems(limit, cursor);
+}
+
+std::vector<ClipboardHistoryItem> CachedClipboardHistoryStore::search(const SearchOptions& options) {
+    return m_store->search(options);
+}
+
+ClipboardHistorySummaryListResult CachedClipboardHistoryStore::listItemSummaries(std::int32_t limit, const std::string& cursor) {
+    return m_store->listItemSummaries(limit, cursor);
+}
+
+std::vector<ClipboardHistoryItemSummary> CachedClipboardHistoryStore::searchSummaries(const SearchOptions& options) {
+    return m_store->searchSummaries(options);
+}
+
+std::vector<OcrTask> CachedClipboardHistoryStore::getPendingOcrImages(std::int32_t limit, HistoryTimestampMs nowMs) {
+    return m_store->getPendingOcrImages(limit, nowMs);
+}
+
+std::optional<OcrTask> CachedClipboardHistoryStore::getNextOcrTask(HistoryTimestampMs nowMs) {
+    return m_store->getNextOcrTask(nowMs);
+}
+
+bool CachedClipboardHistoryStore::markOcrProcessing(const std::string& id) {
+    const bool ok = m_store->markOcrProcessing(id);
+    invalidateId(id);
+    return ok;
+}
+
+bool CachedClipboardHistoryStore::updateOcrSuccess(const std::string& id, const std::string& ocrText) {
+    const bool ok = m_store->updateOcrSuccess(id, ocrText);
+    invalidateId(id);
+    return ok;
+}
+
+bool CachedClipboardHistoryStore::updateOcrFailed(const std::string& id, HistoryTimestampMs nowMs) {
+    const bool ok = m_store->updateOcrFailed(id, nowMs);
+    invalidateId(id);
+    return ok;
+}
+
+std::optional<OcrTaskStatus> CachedClipboardHistoryStore::getOcrStatus(const std::string& id) {
+    return m_store->getOcrStatus(id);
+}
+
+bool CachedClipboardHistoryStore::deleteItem(const std::string& id) {
+    const bool deleted = m_store->deleteItem(id);
+    invalidateId(id);
+    return deleted;
+}
+
+int CachedClipboardHistoryStore::deleteByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash) {
+    const int deleted = m_store->deleteByTypeAndContentHash(type, contentHash);
+    invalidate(std::string(), type, contentHash);
+    return deleted;
+}
+
+bool CachedClipboardHistoryStore::recordContentHashAlias(ClipboardItemType type,
+                                                         const std::string& legacyHash,
+                                                         std::int32_t hashVersion,
+                                                         const std::string& contentHash) {
+    return m_store->recordContentHashAlias(type, legacyHash, hashVersion, contentHash);
+}
+
+std::string CachedClipboardHistoryStore::resolveContentHash(ClipboardItemType type, const std::string& contentHash) {
+    return m_store->resolveContentHash(type, contentHash);
+}
+
+bool CachedClipboardHistoryStore::enforceRetention(std::int32_t maxItems) {
+    return m_store->enforceRetention(maxItems);
+}
+
+std::uint64_t CachedClipboardHistoryStore::retentionGeneration() const {
+    return m_store->retentionGeneration();
+}
+
+std::unique_ptr<ClipboardImageBytes> CachedClipboardHistoryStore::openImageBytes(const std::string& id) {
+    return m_store->openImageBytes(id);
+}
+
+bool CachedClipboardHistoryStore::updateItemMetadata(const std::string& id, const std::string& metadata, HistoryTimestampMs updateTimeMs) {
+    const bool ok = m_store->updateItemMetadata(id, metadata, updateTimeMs);
+    invalidateId(id);
+    return ok;
+}
+
+bool CachedClipboardHistoryStore::updateLastCopyTime(const std::string& id, HistoryTimestampMs copyTimeMs) {
+    const bool ok = m_store->updateLastCopyTime(id, copyTimeMs);
+    invalidateId(id);
+    return ok;
+}
+
+ClipboardHistoryCacheStats CachedClipboardHistoryStore::cacheStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ClipboardHistoryCacheStats stats = m_stats;
+    stats.size = m_entries.size();
+    return stats;
+}
+
+std::string CachedClipboardHistoryStore::hashKey(ClipboardItemType type, const std::string& contentHash) {
+    return (type == ClipboardItemType::Image ? "image:" : "text:") + contentHash;
+}
+
+std::optional<ClipboardHistoryItem> CachedClipboardHistoryStore::lookup(EntryIndex& index, const std::string& key, std::uint64_t& generation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::uint64_t retentionGeneration = m_store->retentionGeneration();
+    if (retentionGeneration != m_retentionGeneration) {
+        clearLocked();
+        m_retentionGeneration = retentionGeneration;
+    }
+
+    generation = m_generation;
+    const auto found = index.find(key);
+    if (found == index.end()) {
+        ++m_stats.misses;
+        return std::nullopt;
+    }
+
+    ++m_stats.hits;
+    m_entries.splice(m_entries.begin(), m_entries, found->second);
+    return *found->second;
+}
+
+void CachedClipboardHistoryStore::fill(const ClipboardHistoryItem& item, std::uint64_t generation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_capacity == 0 || generation != m_generation || m_store->retentionGeneration() != m_retentionGeneration) {
+        return;
+    }
+
+    const auto existing = m_byId.find(item.id);
+    if (existing != m_byId.end()) {
+        eraseLocked(existing->second);
+    }
+    const auto sameHash = m_byHash.find(hashKey(item.type, item.contentHash));
+    if (sameHash != m_byHash.end()) {
+        eraseLocked(sameHash->second);
+    }
+
+    m_entries.push_front(item);
+    m_byId[item.id] = m_entries.begin();
+    m_byHash[hashKey(item.type, item.contentHash)] = m_entries.begin();
+
+    while (m_entries.size() > m_capacity) {
+        eraseLocked(std::prev(m_entries.end()));
+        ++m_stats.evictions;
+    }
+}
+
+void CachedClipboardHistoryStore::invalidate(const std::string& id, ClipboardItemType type, const std::string& contentHash) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    const auto byId = m_byId.find(id);
+    if (byId != m_byId.end()) {
+        eraseLocked(byId->second);
+    }
+    const auto byHash = m_byHash.find(hashKey(type, contentHash));
+    if (byHash != m_byHash.end()) {
+        eraseLocked(byHash->second);
+    }
+}
+
+void CachedClipboardHistoryStore::invalidateId(const std::string& id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    const auto found = m_byId.find(id);
+    if (found != m_byId.end()) {
+        eraseLocked(found->second);
+    }
+}
+
+void CachedClipboardHistoryStore::eraseLocked(EntryList::iterator entry) {
+    m_byId.erase(entry->id);
+    m_byHash.erase(hashKey(entry->type, entry->contentHash));
+    m_entries.erase(entry);
+}
+
+void CachedClipboardHistoryStore::clearLocked() {
+    ++m_generation;
+    m_entries.clear();
+    m_byId.clear();
+    m_byHash.clear();
+}
+
+} // namespace pasty
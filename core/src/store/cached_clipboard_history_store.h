@@ -0,0 +1,102 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#pragma once
+
+#include <history/clipboard_history_store.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pasty {
+
+struct ClipboardHistoryCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::size_t size = 0;
+    std::size_t capacity = 0;
+
+    double hitRate() const {
+        const std::uint64_t lookups = hits + misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
+
+// Bounded LRU of full items in front of another store. Point lookups by id and
+// by (type, content_hash) are served from memory; every write that can change
+// a row drops the affected entries, and a retention sweep in the wrapped store
+// drops everything. Lists and searches always go to the wrapped store.
+class CachedClipboardHistoryStore final : public ClipboardHistoryStore {
+public:
+    CachedClipboardHistoryStore(std::unique_ptr<ClipboardHistoryStore> store, std::size_t capacity);
+
+    bool open(const std::string& baseDirectory) override;
+    void close() override;
+
+    ClipboardHistoryUpsertResult upsertTextItem(const ClipboardHistoryItem& item) override;
+    ClipboardHistoryUpsertResult upsertImageItem(const ClipboardHistoryItem& item, ImageBytesView imageBytes) override;
+    std::string reserveStagingPath() override;
+    ClipboardHistoryUpsertResult upsertStagedImageItem(const ClipboardHistoryItem& item, const std::string& stagingPath) override;
+    std::vector<ClipboardHistoryUpsertResult> upsertItems(const std::vector<ClipboardHistoryUpsertRequest>& requests) override;
+    std::optional<ClipboardHistoryItem> getItem(const std::string& id) override;
+    std::optional<ClipboardHistoryItem> getItemByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash) override;
+    ClipboardHistoryListResult listItems(std::int32_t limit, const std::string& cursor) override;
+    std::vector<ClipboardHistoryItem> search(const SearchOptions& options) override;
+    ClipboardHistorySummaryListResult listItemSummaries(std::int32_t limit, const std::string& cursor) override;
+    std::vector<ClipboardHistoryItemSummary> searchSummaries(const SearchOptions& options) override;
+    std::vector<OcrTask> getPendingOcrImages(std::int32_t limit, HistoryTimestampMs nowMs) override;
+    std::optional<OcrTask> getNextOcrTask(HistoryTimestampMs nowMs) override;
+    bool markOcrProcessing(const std::string& id) override;
+    bool updateOcrSuccess(const std::string& id, const std::string& ocrText) override;
+    bool updateOcrFailed(const std::string& id, HistoryTimestampMs nowMs) override;
+    std::optional<OcrTaskStatus> getOcrStatus(const std::string& id) override;
+    bool deleteItem(const std::string& id) override;
+    int deleteByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash) override;
+    bool recordContentHashAlias(ClipboardItemType type,
+                                const std::string& legacyHash,
+                                std::int32_t hashVersion,
+                                const std::string& contentHash) override;
+    std::string resolveContentHash(ClipboardItemType type, const std::string& contentHash) override;
+    bool enforceRetention(std::int32_t maxItems) override;
+    std::uint64_t retentionGeneration() const override;
+    std::unique_ptr<ClipboardImageBytes> openImageBytes(const std::string& id) override;
+
+    bool updateItemMetadata(const std::string& id, const std::string& metadata, HistoryTimestampMs updateTimeMs) override;
+    bool updateLastCopyTime(const std::string& id, HistoryTimestampMs copyTimeMs) override;
+
+    ClipboardHistoryCacheStats cacheStats() const;
+
+private:
+    using EntryList = std::list<ClipboardHistoryItem>;
+    using EntryIndex = std::unordered_map<std::string, EntryList::iterator>;
+
+    static std::string hashKey(ClipboardItemType type, const std::string& contentHash);
+
+    std::optional<ClipboardHistoryItem> lookup(EntryIndex& index, const std::string& key, std::uint64_t& generation);
+    void fill(const ClipboardHistoryItem& item, std::uint64_t generation);
+    void invalidate(const std::string& id, ClipboardItemType type, const std::string& contentHash);
+    void invalidateId(const std::string& id);
+    void eraseLocked(EntryList::iterator entry);
+    void clearLocked();
+
+    std::unique_ptr<ClipboardHistoryStore> m_store;
+    std::size_t m_capacity;
+    mutable std::mutex m_mutex;
+    EntryList m_entries;
+    EntryIndex m_byId;
+    EntryIndex m_byHash;
+    // Bumped on every invalidation; a miss only fills the cache if no write
+    // landed between its read and the fill.
+    std::uint64_t m_generation;
+    std::uint64_t m_retentionGeneration;
+    ClipboardHistoryCacheStats m_stats;
+};
+
+} // namespace pasty
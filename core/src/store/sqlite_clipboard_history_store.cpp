@@ -1,8 +1,11 @@
 // Pasty - Copyright (c) 2026. MIT License.
 
 #include "store/sqlite_clipboard_history_store.h"
+#include "infrastructure/storage/durable_asset_writer.h"
+#include "utils/content_hash.h"
 #include <common/logger.h>
 
+#include <cctype>
 #include <cstddef>
 #include <chrono>
 #include <cstdio>
@@ -12,11 +15,17 @@
 #include <functional>
 #include <algorithm>
 #include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <optional>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <sqlite3.h>
 
 namespace pasty {
@@ -25,6 +34,11 @@ namespace {
 
 std::string g_migration_directory;
 
+// History may grow past the configured limit by this fraction (capped) before
+// a retention sweep trims it back, so most upserts skip retention entirely.
+constexpr std::int32_t kRetentionSlackDivisor = 20;
+constexpr std::int64_t kMaxRetentionSlack = 256;
+
 bool ensureDirectoryExists(const std::string& path) {
     if (path.empty()) {
         return false;
@@ -65,6 +79,101 @@ std::string truncateUtf8(const std::string& value, std::size_t maxCodePoints) {
     return value.substr(0, index);
 }
 
+bool hasIndexableCharacter(const std::string& term) {
+    for (char character : term) {
+        const unsigned char byte = static_cast<unsigned char>(character);
+        if (byte >= 0x80 || std::isalnum(byte) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Turns free-form user input into an FTS5 expression. Every whitespace separated
+// term becomes a quoted prefix phrase, so punctuation inside a term
+// ("project-alpha") matches adjacent tokens instead of being parsed as FTS5
+// syntax. Returns an empty string when nothing in the query can be indexed.
+std::string buildFtsMatchExpression(const std::string& query, bool includeOcr) {
+    std::string terms;
+    std::size_t index = 0;
+    while (index < query.size()) {
+        while (index < query.size() && std::isspace(static_cast<unsigned char>(query[index])) != 0) {
+            ++index;
+        }
+        const std::size_t termStart = index;
+        while (index < query.size() && std::isspace(static_cast<unsigned char>(query[index])) == 0) {
+            ++index;
+        }
+
+        const std::string term = query.substr(termStart, index - termStart);
+        if (!hasIndexableCharacter(term)) {
+            continue;
+        }
+
+        if (!terms.empty()) {
+            terms.push_back(' ');
+        }
+        terms.push_back('"');
+        for (char character : term) {
+            if (character == '"') {
+                terms.push_back('"');
+            }
+            terms.push_back(character);
+        }
+        terms += "\"*";
+    }
+
+    if (terms.empty() || includeOcr) {
+        return terms;
+    }
+    return "{content tags} : (" + terms + ")";
+}
+
+// unicode61 keeps a CJK run as one token and splits terms at punctuation, so
+// token mode only finds such terms at the start of a token. Queries with any
+// of them are answered like substring mode instead.
+bool tokenModeCanMatch(const std::string& query) {
+    for (char character : query) {
+        const unsigned char byte = static_cast<unsigned char>(character);
+        if (byte >= 0x80 || (std::isspace(byte) == 0 && std::isalnum(byte) == 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t countUtf8CodePoints(const std::string& value) {
+    std::size_t codePoints = 0;
+    for (char character : value) {
+        if ((static_cast<unsigned char>(character) & 0xC0) != 0x80) {
+            ++codePoints;
+        }
+    }
+    return codePoints;
+}
+
+// The trigram index matches any substring of at least three characters. The
+// whole query is one phrase, so spaces and punctuation are matched literally.
+std::string buildSubstringMatchExpression(const std::string& query, bool includeOcr) {
+    if (countUtf8CodePoints(query) < 3) {
+        return std::string();
+    }
+
+    std::string phrase = "\"";
+    for (char character : query) {
+        if (character == '"') {
+            phrase.push_back('"');
+        }
+        phrase.push_back(character);
+    }
+    phrase.push_back('"');
+
+    if (includeOcr) {
+        return phrase;
+    }
+    return "{content tags} : " + phrase;
+}
+
 OcrStatus ocrStatusFromInt(int value) {
     switch (value) {
         case 1: return OcrStatus::Processing;
@@ -86,11 +195,196 @@ std::string originTypeToString(OriginType type) {
     return (type == OriginType::CloudSync) ? "cloud_sync" : "local_copy";
 }
 
+std::string normalizeSynchronousMode(const std::string& mode) {
+    std::string normalized = mode;
+    for (char& character : normalized) {
+        character = static_cast<char>(std::toupper(static_cast<unsigned char>(character)));
+    }
+    if (normalized == "OFF" || normalized == "NORMAL" || normalized == "FULL" || normalized == "EXTRA") {
+        return normalized;
+    }
+    return "NORMAL";
+}
+
+using StatementCache = std::unordered_map<std::string, sqlite3_stmt*>;
+
+void finalizeStatements(StatementCache& cache) {
+    for (auto& entry : cache) {
+        sqlite3_finalize(entry.second);
+    }
+    cache.clear();
+}
+
+constexpr const char* kItemColumns =
+    "id, type, content, image_path, image_width, image_height, image_format, "
+    "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
+    "ocr_status, ocr_text, ocr_retry_count, ocr_next_retry_at, "
+    "origin_type, origin_device_id";
+
+// Every column here is part of idx_items_list_summary, so list pages never
+// touch the table rows that hold the full content.
+constexpr const char* kSummaryColumns =
+    "id, type, preview, image_path, image_width, image_height, image_format, "
+    "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
+    "ocr_status, origin_type, origin_device_id";
+
+// Same projection, but with the preview rebuilt from the full text for
+// callers that ask for more than kHistoryPreviewCodePoints.
+constexpr const char* kLongSummaryColumns =
+    "id, type, CASE WHEN type = 'image' THEN COALESCE(ocr_text, '') ELSE COALESCE(content, '') END, "
+    "image_path, image_width, image_height, image_format, "
+    "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
+    "ocr_status, origin_type, origin_device_id";
+
+// An image asset written, synced and linked at its final path before the
+// store mutex is taken. stagingPath is empty when the content-addressed file
+// already existed, and relativePath is empty when staging failed.
+struct StagedAsset {
+    std::string relativePath;
+    std::string stagingPath;
+};
+
+struct ListCursor {
+    std::int64_t lastCopyTimeMs = 0;
+    std::string id;
+};
+
+// An asset file mapped read-only. The mapping outlives an unlink of the file,
+// so retention or a delete cannot pull the bytes from under a reader.
+class MappedImageBytes final : public ClipboardImageBytes {
+public:
+    static std::unique_ptr<ClipboardImageBytes> open(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat info {};
+        void* mapping = MAP_FAILED;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            mapping = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            return nullptr;
+        }
+        return std::unique_ptr<ClipboardImageBytes>(
+            new MappedImageBytes(static_cast<const std::uint8_t*>(mapping), static_cast<std::size_t>(info.st_size)));
+    }
+
+    ~MappedImageBytes() override {
+        ::munmap(const_cast<std::uint8_t*>(m_data), m_size);
+    }
+
+    const std::uint8_t* data() const override {
+        return m_data;
+    }
+
+    std::size_t size() const override {
+        return m_size;
+    }
+
+private:
+    MappedImageBytes(const std::uint8_t* data, std::size_t size)
+        : m_data(data)
+        , m_size(size) {
+    }
+
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+};
+
+class BufferedImageBytes final : public ClipboardImageBytes {
+public:
+    explicit BufferedImageBytes(std::vector<std::uint8_t> bytes)
+        : m_bytes(std::move(bytes)) {
+    }
+
+    const std::uint8_t* data() const override {
+        return m_bytes.data();
+    }
+
+    std::size_t size() const override {
+        return m_bytes.size();
+    }
+
+private:
+    std::vector<std::uint8_t> m_bytes;
+};
+
+// A read-only connection from the reader pool together with its own
+// prepared statement cache.
+struct ReaderConnection {
+    sqlite3* db = nullptr;
+    StatementCache statements;
+};
+
+class StatementLease {
+public:
+    StatementLease()
+        : m_statement(nullptr) {
+    }
+
+    explicit StatementLease(sqlite3_stmt* statement)
+        : m_statement(statement) {
+    }
+
+    ~StatementLease() {
+        if (m_statement != nullptr) {
+            sqlite3_reset(m_statement);
+            sqlite3_clear_bindings(m_statement);
+        }
+    }
+
+    StatementLease(const StatementLease&) = delete;
+    StatementLease& operator=(const StatementLease&) = delete;
+
+    StatementLease(StatementLease&& other) noexcept
+        : m_statement(other.m_statement) {
+        other.m_statement = nullptr;
+    }
+
+    operator sqlite3_stmt*() const {
+        return m_statement;
+    }
+
+private:
+    sqlite3_stmt* m_statement;
+};
+
+// Statements are prepared once per connection and reused; the returned lease
+// resets the statement and clears its bindings when it goes out of scope.
+StatementLease prepareCachedStatement(sqlite3* db, StatementCache& cache, const char* sql) {
+    if (db == nullptr) {
+        return StatementLease();
+    }
+
+    const auto cached = cache.find(sql);
+    if (cached != cache.end()) {
+        return StatementLease(cached->second);
+    }
+
+    sqlite3_stmt* statement = nullptr;
+    if (sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &statement, nullptr) != SQLITE_OK) {
+        PASTY_LOG_ERROR("Core.Store", "Prepare statement failed: %s", sqlite3_errmsg(db));
+        sqlite3_finalize(statement);
+        return StatementLease();
+    }
+
+    cache.emplace(sql, statement);
+    return StatementLease(statement);
+}
+
 class SQLiteClipboardHistoryStore final : public ClipboardHistoryStore {
 public:
-    SQLiteClipboardHistoryStore()
-        : m_db(nullptr)
-        , m_itemsLimit(1000) {
+    explicit SQLiteClipboardHistoryStore(ClipboardHistoryStoreOptions options)
+        : m_options(std::move(options))
+        , m_assetWriter(m_options.assetWriter)
+        , m_db(nullptr)
+        , m_itemsLimit(1000)
+        , m_itemCount(0) {
+        if (!m_assetWriter) {
+            m_assetWriter = std::make_shared<DurableAssetWriter>();
+        }
     }
 
     ~SQLiteClipboardHistoryStore() override {
@@ -105,13 +399,14 @@ public:
 
         m_baseDirectory = baseDirectory;
         m_assetsDirectory = m_baseDirectory + "/images";
+        m_stagingDirectory = m_assetsDirectory + "/.staging";
         m_dbPath = m_baseDirectory + "/history.sqlite3";
 
         if (!ensureDirectoryExists(m_baseDirectory)) {
             PASTY_LOG_ERROR("Core.Store", "Failed to ensure base directory: %s", m_baseDirectory.c_str());
             return false;
         }
-        if (!ensureDirectoryExists(m_assetsDirectory)) {
+        if (!ensureDirectoryExists(m_assetsDirectory) || !ensureDirectoryExists(m_stagingDirectory)) {
             PASTY_LOG_ERROR("Core.Store", "Failed to ensure assets directory: %s", m_assetsDirectory.c_str());
             return false;
         }
@@ -122,12 +417,17 @@ public:
             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
             nullptr
         );
-        if (openResult != SQLITE_OK || m_db == nullptr) {
+        if (openResult != SQLITE_OK || m_db == nullptr || !configureConnection(m_db, false)) {
             closeUnlocked();
             return recreateFromCorruption();
         }
 
         if (migrateSchema()) {
+            applyPendingAssetMovesUnlocked();
+            rehashLegacyRowsUnlocked();
+            clearStagingDirectoryUnlocked();
+            m_itemCount = countItemsUnlocked();
+            openReadersUnlocked();
             PASTY_LOG_INFO("Core.Store", "Database opened and migrated successfully: %s", m_dbPath.c_str());
             return true;
         }
@@ -143,158 +443,168 @@ public:
 
     ClipboardHistoryUpsertResult upsertTextItem(const ClipboardHistoryItem& item) override {
         std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_db == nullptr || item.id.empty()) {
+        const ClipboardHistoryUpsertResult result = upsertTextItemUnlocked(item);
+        if (!result.id.empty()) {
+            enforceRetentionUnlocked(m_itemsLimit);
+        }
+        return result;
+    }
+
+    // Two phases: the image bytes are written to a staging file without the
+    // store mutex, which is then held only to move the file into place and
+    // commit the row. A staged file that is not consumed is removed afterwards.
+    ClipboardHistoryUpsertResult upsertImageItem(const ClipboardHistoryItem& item, ImageBytesView imageBytes) override {
+        if (item.id.empty() || imageBytes.empty()) {
             return {};
         }
 
-        bool inserted = true;
-        std::string existingId;
+        const StagedAsset staged = isInlineImage(imageBytes.size) ? StagedAsset{} : stageAsset(item, imageBytes);
+        ClipboardHistoryUpsertResult result;
         {
-            sqlite3_stmt* existing = nullptr;
-            const char* existingSql = "SELECT id FROM items WHERE type='text' AND content_hash = ?1 LIMIT 1;";
-            if (sqlite3_prepare_v2(m_db, existingSql, -1, &existing, nullptr) == SQLITE_OK) {
-                sqlite3_bind_text(existing, 1, item.contentHash.c_str(), -1, SQLITE_TRANSIENT);
-                if (sqlite3_step(existing) == SQLITE_ROW) {
-                    inserted = false;
-                    existingId = readTextColumn(existing, 0);
-                }
-                sqlite3_finalize(existing);
-            } else {
-                return {};
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::string writtenAsset;
+            result = upsertImageItemUnlocked(item, staged, imageBytes, writtenAsset);
+            if (!result.id.empty()) {
+                enforceRetentionUnlocked(m_itemsLimit);
             }
         }
+        discardStagedAsset(staged);
+        return result;
+    }
 
-        sqlite3_stmt* statement = nullptr;
-        const char* sql =
-            "INSERT INTO items ("
-            "id, type, content, image_path, image_width, image_height, image_format, "
-            "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
-            "ocr_status, ocr_text, ocr_retry_count, ocr_next_retry_at, "
-            "origin_type, origin_device_id"
-            ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
-            "ON CONFLICT(type, content_hash) DO UPDATE SET "
-            "content=excluded.content, "
-            "update_time_ms=excluded.update_time_ms, "
-            "last_copy_time_ms=excluded.last_copy_time_ms, "
-            "source_app_id=excluded.source_app_id,"
-            "metadata=COALESCE(NULLIF(excluded.metadata, ''), items.metadata),"
-            "origin_type=excluded.origin_type,"
-            "origin_device_id=excluded.origin_device_id;";
+    std::string reserveStagingPath() override {
+        return m_stagingDirectory + "/" + std::to_string(++m_stagingSequence) + ".tmp";
+    }
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+    // The staged file is synced here, outside the store mutex, and then goes
+    // through the same publish step as a buffered upsert. Images small enough
+    // for the inline tier are read back and stored in the row instead.
+    ClipboardHistoryUpsertResult upsertStagedImageItem(const ClipboardHistoryItem& item, const std::string& stagingPath) override {
+        std::error_code ec;
+        const std::uintmax_t size = std::filesystem::file_size(stagingPath, ec);
+        if (item.id.empty() || ec || size == 0) {
+            std::remove(stagingPath.c_str());
             return {};
         }
 
-        bindCommonItemFields(statement, item, false);
-
-        const bool ok = sqlite3_step(statement) == SQLITE_DONE;
-        sqlite3_finalize(statement);
+        if (isInlineImage(static_cast<std::size_t>(size))) {
+            const std::unique_ptr<ClipboardImageBytes> bytes = MappedImageBytes::open(stagingPath);
+            ClipboardHistoryUpsertResult result;
+            if (bytes) {
+                result = upsertImageItem(item, ImageBytesView(bytes->data(), bytes->size()));
+            }
+            std::remove(stagingPath.c_str());
+            return result;
+        }
 
-        if (!ok) {
-            PASTY_LOG_ERROR("Core.Store", "Upsert text failed");
-            return {};
+        StagedAsset staged;
+        staged.stagingPath = stagingPath;
+        if (m_assetWriter->syncFile(stagingPath)) {
+            const std::string key = item.contentHash.empty() ? item.id : item.contentHash;
+            staged.relativePath = assetRelativePath(key, normalizeImageExtension(item.imageFormat));
+            publishStagedAsset(staged);
         }
 
-        enforceRetentionUnlocked(m_itemsLimit);
-        const std::string resultId = inserted ? item.id : existingId;
-        PASTY_LOG_DEBUG("Core.Store", "Upsert text succeeded. ID: %s", resultId.c_str());
-        return ClipboardHistoryUpsertResult{resultId, inserted};
+        ClipboardHistoryUpsertResult result;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::string writtenAsset;
+            result = upsertImageItemUnlocked(item, staged, ImageBytesView(), writtenAsset);
+            if (!result.id.empty()) {
+                enforceRetentionUnlocked(m_itemsLimit);
+            }
+        }
+        discardStagedAsset(staged);
+        return result;
     }
 
-    ClipboardHistoryUpsertResult upsertImageItem(const ClipboardHistoryItem& item, const std::vector<std::uint8_t>& imageBytes) override {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_db == nullptr || item.id.empty() || imageBytes.empty()) {
-            return {};
+    // Applies every request inside one IMMEDIATE transaction so a bulk load pays
+    // for a single journal commit. Duplicates within the batch resolve against
+    // rows written earlier in the same transaction. The result vector always
+    // matches the request order; failed entries carry an empty id.
+    std::vector<ClipboardHistoryUpsertResult> upsertItems(const std::vector<ClipboardHistoryUpsertRequest>& requests) override {
+        std::vector<StagedAsset> staged(requests.size());
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            const ClipboardHistoryUpsertRequest& request = requests[i];
+            if (request.item.type == ClipboardItemType::Image && !request.imageBytes.empty()
+                && !isInlineImage(request.imageBytes.size)) {
+                staged[i] = stageAsset(request.item, request.imageBytes);
+            }
         }
 
+        std::vector<ClipboardHistoryUpsertResult> results;
         {
-            sqlite3_stmt* existing = nullptr;
-            const char* existingSql = "SELECT id FROM items WHERE type='image' AND content_hash = ?1 LIMIT 1;";
-            if (sqlite3_prepare_v2(m_db, existingSql, -1, &existing, nullptr) == SQLITE_OK) {
-                sqlite3_bind_text(existing, 1, item.contentHash.c_str(), -1, SQLITE_TRANSIENT);
-                if (sqlite3_step(existing) == SQLITE_ROW) {
-                    const std::string existingId = readTextColumn(existing, 0);
-                    sqlite3_finalize(existing);
-
-                    sqlite3_stmt* update = nullptr;
-                    const char* updateSql =
-                        "UPDATE items "
-                        "SET update_time_ms = ?1, last_copy_time_ms = ?2, source_app_id = ?3, "
-                        "metadata = CASE WHEN length(?5) > 0 THEN ?5 ELSE metadata END, "
-                        "origin_type = ?6, origin_device_id = ?7 "
-                        "WHERE id = ?4;";
-                    if (sqlite3_prepare_v2(m_db, updateSql, -1, &update, nullptr) != SQLITE_OK) {
-                        PASTY_LOG_ERROR("Core.Store", "Upsert image dedupe update prepare failed");
-                        return {};
-                    }
-                    sqlite3_bind_int64(update, 1, item.updateTimeMs);
-                    sqlite3_bind_int64(update, 2, item.lastCopyTimeMs);
-                    sqlite3_bind_text(update, 3, item.sourceAppId.c_str(), -1, SQLITE_TRANSIENT);
-                    sqlite3_bind_text(update, 4, existingId.c_str(), -1, SQLITE_TRANSIENT);
-                    sqlite3_bind_text(update, 5, item.metadata.c_str(), -1, SQLITE_TRANSIENT);
-                    sqlite3_bind_text(update, 6, originTypeToString(item.originType).c_str(), -1, SQLITE_TRANSIENT);
-                    if (item.originDeviceId.has_value() && !item.originDeviceId->empty()) {
-                        sqlite3_bind_text(update, 7, item.originDeviceId->c_str(), -1, SQLITE_TRANSIENT);
-                    } else {
-                        sqlite3_bind_null(update, 7);
-                    }
-                    const bool updated = sqlite3_step(update) == SQLITE_DONE;
-                    sqlite3_finalize(update);
-                    if (!updated) {
-                        PASTY_LOG_ERROR("Core.Store", "Upsert image dedupe update failed. ID: %s", existingId.c_str());
-                        return {};
-                    }
-                    enforceRetentionUnlocked(m_itemsLimit);
-                    PASTY_LOG_DEBUG("Core.Store", "Upsert image dedupe hit. ID: %s", existingId.c_str());
-                    return ClipboardHistoryUpsertResult{existingId, false};
-                }
-                sqlite3_finalize(existing);
-            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            results = upsertItemsUnlocked(requests, staged);
         }
-
-        const std::string extension = normalizeImageExtension(item.imageFormat);
-        const std::string relativePath = writeAssetAtomically(item.id, extension, imageBytes);
-        if (relativePath.empty()) {
-            return {};
+        for (const auto& asset : staged) {
+            discardStagedAsset(asset);
         }
+        return results;
+    }
 
-        sqlite3_stmt* statement = nullptr;
-        const char* sql =
-            "INSERT INTO items ("
-            "id, type, content, image_path, image_width, image_height, image_format, "
-            "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
-            "ocr_status, ocr_text, ocr_retry_count, ocr_next_retry_at, "
-            "origin_type, origin_device_id"
-            ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+    std::vector<ClipboardHistoryUpsertResult> upsertItemsUnlocked(const std::vector<ClipboardHistoryUpsertRequest>& requests,
+                                                                  const std::vector<StagedAsset>& staged) {
+        std::vector<ClipboardHistoryUpsertResult> results(requests.size());
+        if (m_db == nullptr || requests.empty()) {
+            return results;
+        }
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
-            deleteAsset(relativePath);
-            return {};
+        if (!execUnlocked("BEGIN IMMEDIATE;")) {
+            return results;
         }
 
-        bindCommonItemFields(statement, item, true, relativePath);
+        std::vector<std::string> writtenAssets;
+        bool ok = true;
+        for (std::size_t i = 0; i < requests.size() && ok; ++i) {
+            const ClipboardHistoryUpsertRequest& request = requests[i];
+            if (request.item.type == ClipboardItemType::Image) {
+                if (request.imageBytes.empty()) {
+                    continue;
+                }
+                std::string writtenAsset;
+                results[i] = upsertImageItemUnlocked(request.item, staged[i], request.imageBytes, writtenAsset);
+                if (!writtenAsset.empty()) {
+                    writtenAssets.push_back(writtenAsset);
+                }
+            } else {
+                results[i] = upsertTextItemUnlocked(request.item);
+            }
+            // Some errors (SQLITE_FULL, I/O) roll the whole transaction back.
+            ok = sqlite3_get_autocommit(m_db) == 0;
+        }
 
-        const bool ok = sqlite3_step(statement) == SQLITE_DONE;
-        sqlite3_finalize(statement);
+        std::vector<std::string> removedAssets;
+        if (ok && m_itemCount > retentionHighWaterMark(m_itemsLimit)) {
+            ok = trimToUnlocked(m_itemsLimit, removedAssets);
+        }
 
-        if (!ok) {
-            deleteAsset(relativePath);
-            PASTY_LOG_ERROR("Core.Store", "Upsert image insert failed");
-            return {};
+        if (!ok || !execUnlocked("COMMIT;")) {
+            PASTY_LOG_ERROR("Core.Store", "Batch upsert of %zu items failed, rolling back", requests.size());
+            execUnlocked("ROLLBACK;");
+            m_itemCount = countItemsUnlocked();
+            for (const auto& asset : writtenAssets) {
+                releaseAssetUnlocked(asset);
+            }
+            return std::vector<ClipboardHistoryUpsertResult>(requests.size());
         }
 
-        enforceRetentionUnlocked(m_itemsLimit);
-        PASTY_LOG_DEBUG("Core.Store", "Upsert image inserted. ID: %s", item.id.c_str());
-        return ClipboardHistoryUpsertResult{item.id, true};
+        for (const auto& asset : removedAssets) {
+            releaseAssetUnlocked(asset);
+        }
+        PASTY_LOG_DEBUG("Core.Store", "Batch upsert committed %zu items", requests.size());
+        return results;
     }
 
     std::optional<ClipboardHistoryItem> getItem(const std::string& id) override {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_db == nullptr || id.empty()) {
+        if (id.empty()) {
+            return std::nullopt;
+        }
+        ReadConnection connection(*this);
+        if (!connection) {
             return std::nullopt;
         }
 
-        sqlite3_stmt* statement = nullptr;
         const char* sql =
             "SELECT id, type, content, image_path, image_width, image_height, image_format, "
             "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
@@ -303,7 +613,8 @@ public:
             "FROM items "
             "WHERE id = ?1;";
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = connection.prepare(sql);
+        if (!statement) {
             return std::nullopt;
         }
 
@@ -337,19 +648,20 @@ public:
             result = item;
         }
 
-        sqlite3_finalize(statement);
         return result;
     }
 
     std::optional<ClipboardHistoryItem> getItemByTypeAndContentHash(ClipboardItemType type, const std::string& contentHash) override {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_db == nullptr || contentHash.empty()) {
+        if (contentHash.empty()) {
+            return std::nullopt;
+        }
+        ReadConnection connection(*this);
+        if (!connection) {
             return std::nullopt;
         }
 
         const std::string typeStr = (type == ClipboardItemType::Image) ? "image" : "text";
 
-        sqlite3_stmt* statement = nullptr;
         const char* sql =
             "SELECT id, type, content, image_path, image_width, image_height, image_format, "
             "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
@@ -358,7 +670,8 @@ public:
             "FROM items "
             "WHERE type = ?1 AND content_hash = ?2 LIMIT 1;";
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = connection.prepare(sql);
+        if (!statement) {
             return std::nullopt;
         }
 
@@ -393,167 +706,124 @@ public:
             result = item;
         }
 
-        sqlite3_finalize(statement);
         return result;
     }
 
     ClipboardHistoryListResult listItems(std::int32_t limit, const std::string& cursor) override {
-        std::lock_guard<std::mutex> lock(m_mutex);
         ClipboardHistoryListResult result;
-        if (m_db == nullptr) {
+        ReadConnection connection(*this);
+        if (!connection) {
             return result;
         }
 
         const std::int32_t safeLimit = limit <= 0 ? 200 : (limit > 1000 ? 1000 : limit);
-        const std::int64_t cursorTime = parseCursor(cursor);
+        StatementLease statement = prepareListPage(connection, kItemColumns, parseCursor(cursor), safeLimit);
+        if (!statement) {
+            return result;
+        }
 
-        sqlite3_stmt* statement = nullptr;
-        const char* sql =
-            "SELECT id, type, content, image_path, image_width, image_height, image_format, "
-            "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
-            "ocr_status, ocr_text, ocr_retry_count, ocr_next_retry_at, "
-            "origin_type, origin_device_id "
-            "FROM items "
-            "WHERE (?1 = 0 OR last_copy_time_ms < ?1) "
-            "ORDER BY last_copy_time_ms DESC "
-            "LIMIT ?2;";
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            result.items.push_back(readItemRow(statement));
+        }
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        if (result.items.size() > static_cast<std::size_t>(safeLimit)) {
+            result.items.pop_back();
+            result.nextCursor = makeCursor(result.items.back().lastCopyTimeMs, result.items.back().id);
+        }
+
+        return result;
+    }
+
+    ClipboardHistorySummaryListResult listItemSummaries(std::int32_t limit, const std::string& cursor) override {
+        ClipboardHistorySummaryListResult result;
+        ReadConnection connection(*this);
+        if (!connection) {
             return result;
         }
 
-        sqlite3_bind_int64(statement, 1, cursorTime);
-        sqlite3_bind_int(statement, 2, safeLimit);
+        const std::int32_t safeLimit = limit <= 0 ? 200 : (limit > 1000 ? 1000 : limit);
+        StatementLease statement = prepareListPage(connection, kSummaryColumns, parseCursor(cursor), safeLimit);
+        if (!statement) {
+            return result;
+        }
 
         while (sqlite3_step(statement) == SQLITE_ROW) {
-            ClipboardHistoryItem item;
-            item.id = readTextColumn(statement, 0);
-            item.type = readTextColumn(statement, 1) == "image" ? ClipboardItemType::Image : ClipboardItemType::Text;
-            item.content = readTextColumn(statement, 2);
-            item.imagePath = readTextColumn(statement, 3);
-            item.imageWidth = sqlite3_column_int(statement, 4);
-            item.imageHeight = sqlite3_column_int(statement, 5);
-            item.imageFormat = readTextColumn(statement, 6);
-            item.createTimeMs = sqlite3_column_int64(statement, 7);
-            item.updateTimeMs = sqlite3_column_int64(statement, 8);
-            item.lastCopyTimeMs = sqlite3_column_int64(statement, 9);
-            item.sourceAppId = readTextColumn(statement, 10);
-            item.contentHash = readTextColumn(statement, 11);
-            item.metadata = readTextColumn(statement, 12);
-            item.ocrStatus = ocrStatusFromInt(sqlite3_column_int(statement, 13));
-            item.ocrText = readTextColumn(statement, 14);
-            item.ocrRetryCount = sqlite3_column_int(statement, 15);
-            item.ocrNextRetryAtMs = sqlite3_column_int64(statement, 16);
-            item.originType = originTypeFromString(readTextColumn(statement, 17));
-            const auto* deviceIdText = sqlite3_column_text(statement, 18);
-            if (deviceIdText != nullptr) {
-                item.originDeviceId = reinterpret_cast<const char*>(deviceIdText);
-            }
-            result.items.push_back(item);
+            result.items.push_back(readSummaryRow(statement));
         }
 
-        sqlite3_finalize(statement);
-
-        if (!result.items.empty()) {
-            const auto& last = result.items.back();
-            result.nextCursor = std::to_string(last.lastCopyTimeMs);
+        if (result.items.size() > static_cast<std::size_t>(safeLimit)) {
+            result.items.pop_back();
+            result.nextCursor = makeCursor(result.items.back().lastCopyTimeMs, result.items.back().id);
         }
 
         return result;
     }
 
     std::vector<ClipboardHistoryItem> search(const SearchOptions& options) override {
-        std::lock_guard<std::mutex> lock(m_mutex);
         std::vector<ClipboardHistoryItem> results;
-        if (m_db == nullptr) {
+        ReadConnection connection(*this);
+        if (!connection) {
             return results;
         }
 
-        std::string sql =
-            "SELECT id, type, content, image_path, image_width, image_height, image_format, "
-            "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
-            "ocr_status, ocr_text, ocr_retry_count, ocr_next_retry_at, "
-            "origin_type, origin_device_id "
-            "FROM items "
-            "WHERE (COALESCE(content, '') LIKE ?1 "
-            "OR COALESCE(metadata, '') LIKE ?1 ";
-        
-        if (options.includeOcr) {
-            sql += "OR COALESCE(ocr_text, '') LIKE ?1";
+        StatementLease statement = prepareSearch(connection, kItemColumns, options);
+        if (!statement) {
+            return results;
         }
-        
-        sql += ") ";
 
-        if (!options.contentType.empty()) {
-            sql += "AND type = ?3 ";
+        const std::size_t previewLength = options.previewLength == 0 ? 200 : options.previewLength;
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            ClipboardHistoryItem item = readItemRow(statement);
+            if (item.type == ClipboardItemType::Text && !item.content.empty()) {
+                item.content = truncateUtf8(item.content, previewLength);
+            }
+            results.push_back(item);
         }
 
-        sql += "ORDER BY last_copy_time_ms DESC LIMIT ?2;";
+        return results;
+    }
 
-        sqlite3_stmt* statement = nullptr;
-        if (sqlite3_prepare_v2(m_db, sql.c_str(), -1, &statement, nullptr) != SQLITE_OK) {
+    std::vector<ClipboardHistoryItemSummary> searchSummaries(const SearchOptions& options) override {
+        std::vector<ClipboardHistoryItemSummary> results;
+        ReadConnection connection(*this);
+        if (!connection) {
             return results;
         }
 
-        std::string pattern = "%" + options.query + "%";
-        sqlite3_bind_text(statement, 1, pattern.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_int(statement, 2, static_cast<int>(options.limit));
-
-        if (!options.contentType.empty()) {
-            sqlite3_bind_text(statement, 3, options.contentType.c_str(), -1, SQLITE_TRANSIENT);
+        const std::size_t previewLength = options.previewLength == 0 ? kHistoryPreviewCodePoints : options.previewLength;
+        const bool longPreview = previewLength > kHistoryPreviewCodePoints;
+        StatementLease statement = prepareSearch(connection, longPreview ? kLongSummaryColumns : kSummaryColumns, options);
+        if (!statement) {
+            return results;
         }
 
-        const std::size_t previewLength = options.previewLength == 0 ? 200 : options.previewLength;
         while (sqlite3_step(statement) == SQLITE_ROW) {
-            ClipboardHistoryItem item;
-            item.id = readTextColumn(statement, 0);
-            item.type = readTextColumn(statement, 1) == "image" ? ClipboardItemType::Image : ClipboardItemType::Text;
-            item.content = readTextColumn(statement, 2);
-            item.imagePath = readTextColumn(statement, 3);
-            item.imageWidth = sqlite3_column_int(statement, 4);
-            item.imageHeight = sqlite3_column_int(statement, 5);
-            item.imageFormat = readTextColumn(statement, 6);
-            item.createTimeMs = sqlite3_column_int64(statement, 7);
-            item.updateTimeMs = sqlite3_column_int64(statement, 8);
-            item.lastCopyTimeMs = sqlite3_column_int64(statement, 9);
-            item.sourceAppId = readTextColumn(statement, 10);
-            item.contentHash = readTextColumn(statement, 11);
-            item.metadata = readTextColumn(statement, 12);
-            item.ocrStatus = ocrStatusFromInt(sqlite3_column_int(statement, 13));
-            item.ocrText = readTextColumn(statement, 14);
-            item.ocrRetryCount = sqlite3_column_int(statement, 15);
-            item.ocrNextRetryAtMs = sqlite3_column_int64(statement, 16);
-            item.originType = originTypeFromString(readTextColumn(statement, 17));
-            const auto* deviceIdText = sqlite3_column_text(statement, 18);
-            if (deviceIdText != nullptr) {
-                item.originDeviceId = reinterpret_cast<const char*>(deviceIdText);
+            ClipboardHistoryItemSummary summary = readSummaryRow(statement);
+            if (previewLength != kHistoryPreviewCodePoints) {
+                summary.preview = truncateUtf8(summary.preview, previewLength);
             }
-            if (item.type == ClipboardItemType::Text && !item.content.empty()) {
-                item.content = truncateUtf8(item.content, previewLength);
-            }
-            results.push_back(item);
+            results.push_back(summary);
         }
 
-        sqlite3_finalize(statement);
         return results;
     }
 
     std::vector<OcrTask> getPendingOcrImages(std::int32_t limit, HistoryTimestampMs nowMs) override {
-        std::lock_guard<std::mutex> lock(m_mutex);
         std::vector<OcrTask> results;
-        if (m_db == nullptr) {
+        ReadConnection connection(*this);
+        if (!connection) {
             return results;
         }
 
         const std::int32_t safeLimit = limit <= 0 ? 50 : (limit > 500 ? 500 : limit);
-        sqlite3_stmt* statement = nullptr;
         const char* sql =
             "SELECT id, image_path, ocr_retry_count, last_copy_time_ms "
             "FROM items "
             "WHERE type = 'image' AND ocr_status = 0 AND ocr_next_retry_at <= ?1 "
             "ORDER BY last_copy_time_ms DESC LIMIT ?2;";
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = connection.prepare(sql);
+        if (!statement) {
             return results;
         }
 
@@ -569,24 +839,23 @@ public:
             results.push_back(task);
         }
 
-        sqlite3_finalize(statement);
         return results;
     }
 
     std::optional<OcrTask> getNextOcrTask(HistoryTimestampMs nowMs) override {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_db == nullptr) {
+        ReadConnection connection(*this);
+        if (!connection) {
             return std::nullopt;
         }
 
-        sqlite3_stmt* statement = nullptr;
         const char* sql =
             "SELECT id, image_path, ocr_retry_count, last_copy_time_ms "
             "FROM items "
             "WHERE type = 'image' AND ocr_status = 0 AND ocr_next_retry_at <= ?1 "
             "ORDER BY last_copy_time_ms DESC LIMIT 1;";
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = connection.prepare(sql);
+        if (!statement) {
             return std::nullopt;
         }
 
@@ -601,7 +870,6 @@ public:
             task.lastCopyTimeMs = sqlite3_column_int64(statement, 3);
             result = task;
         }
-        sqlite3_finalize(statement);
         return result;
     }
 
@@ -611,18 +879,17 @@ public:
             return false;
         }
 
-        sqlite3_stmt* statement = nullptr;
         const char* sql =
             "UPDATE items SET ocr_status = 1 "
             "WHERE id = ?1 AND type = 'image';";
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = prepareCached(sql);
+        if (!statement) {
             return false;
         }
 
         sqlite3_bind_text(statement, 1, id.c_str(), -1, SQLITE_TRANSIENT);
         const bool ok = sqlite3_step(statement) == SQLITE_DONE && sqlite3_changes(m_db) > 0;
-        sqlite3_finalize(statement);
         return ok;
     }
 
@@ -632,13 +899,13 @@ public:
             return false;
         }
 
-        sqlite3_stmt* statement = nullptr;
         const char* sql =
             "UPDATE items "
-            "SET ocr_text = ?1, ocr_status = 2, ocr_retry_count = 0, ocr_next_retry_at = 0 "
+            "SET ocr_text = ?1, preview = ?3, ocr_status = 2, ocr_retry_count = 0, ocr_next_retry_at = 0 "
             "WHERE id = ?2 AND type = 'image';";
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = prepareCached(sql);
+        if (!statement) {
             return false;
         }
 
@@ -648,8 +915,9 @@ public:
             sqlite3_bind_text(statement, 1, ocrText.c_str(), -1, SQLITE_TRANSIENT);
         }
         sqlite3_bind_text(statement, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+        const std::string preview = truncateUtf8(ocrText, kHistoryPreviewCodePoints);
+        sqlite3_bind_text(statement, 3, preview.c_str(), -1, SQLITE_TRANSIENT);
         const bool ok = sqlite3_step(statement) == SQLITE_DONE && sqlite3_changes(m_db) > 0;
-        sqlite3_finalize(statement);
         return ok;
     }
 
@@ -659,20 +927,21 @@ public:
             return false;
         }
 
-        sqlite3_stmt* lookup = nullptr;
-        const char* lookupSql =
-            "SELECT ocr_retry_count FROM items WHERE id = ?1 AND type = 'image' LIMIT 1;";
-        if (sqlite3_prepare_v2(m_db, lookupSql, -1, &lookup, nullptr) != SQLITE_OK) {
-            return false;
-        }
+        int retryCount = 0;
+        {
+            const char* lookupSql =
+                "SELECT ocr_retry_count FROM items WHERE id = ?1 AND type = 'image' LIMIT 1;";
+            StatementLease lookup = prepareCached(lookupSql);
+            if (!lookup) {
+                return false;
+            }
 
-        sqlite3_bind_text(lookup, 1, id.c_str(), -1, SQLITE_TRANSIENT);
-        if (sqlite3_step(lookup) != SQLITE_ROW) {
-            sqlite3_finalize(lookup);
-            return false;
+            sqlite3_bind_text(lookup, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(lookup) != SQLITE_ROW) {
+                return false;
+            }
+            retryCount = sqlite3_column_int(lookup, 0);
         }
-        const int retryCount = sqlite3_column_int(lookup, 0);
-        sqlite3_finalize(lookup);
 
         const int nextRetryCount = retryCount + 1;
         int nextStatus = 0;
@@ -686,12 +955,12 @@ public:
             nextRetryAt = 0;
         }
 
-        sqlite3_stmt* update = nullptr;
         const char* updateSql =
             "UPDATE items "
             "SET ocr_retry_count = ?1, ocr_status = ?2, ocr_next_retry_at = ?3 "
             "WHERE id = ?4 AND type = 'image';";
-        if (sqlite3_prepare_v2(m_db, updateSql, -1, &update, nullptr) != SQLITE_OK) {
+        StatementLease update = prepareCached(updateSql);
+        if (!update) {
             return false;
         }
 
@@ -700,20 +969,22 @@ public:
         sqlite3_bind_int64(update, 3, nextRetryAt);
         sqlite3_bind_text(update, 4, id.c_str(), -1, SQLITE_TRANSIENT);
         const bool ok = sqlite3_step(update) == SQLITE_DONE && sqlite3_changes(m_db) > 0;
-        sqlite3_finalize(update);
         return ok;
     }
 
     std::optional<OcrTaskStatus> getOcrStatus(const std::string& id) override {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_db == nullptr || id.empty()) {
+        if (id.empty()) {
+            return std::nullopt;
+        }
+        ReadConnection connection(*this);
+        if (!connection) {
             return std::nullopt;
         }
 
-        sqlite3_stmt* statement = nullptr;
         const char* sql =
             "SELECT ocr_status, ocr_text FROM items WHERE id = ?1 AND type = 'image' LIMIT 1;";
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = connection.prepare(sql);
+        if (!statement) {
             return std::nullopt;
         }
 
@@ -725,7 +996,6 @@ public:
             value.text = readTextColumn(statement, 1);
             status = value;
         }
-        sqlite3_finalize(statement);
         return status;
     }
 
@@ -734,6 +1004,84 @@ public:
         return deleteItemUnlocked(id);
     }
 
+    std::uint64_t retentionGeneration() const override {
+        return m_retentionGeneration.load();
+    }
+
+    // Inline images are copied out of the row with sqlite3_blob_read while the
+    // lookup statement still holds its read transaction, so the blob belongs to
+    // the row that was found. File-backed images are mapped under m_mutex once
+    // the connection is released: asset files are only unlinked under it, so
+    // the file is either still there or its row is already gone, and once
+    // mapped the bytes survive any later unlink.
+    std::unique_ptr<ClipboardImageBytes> openImageBytes(const std::string& id) override {
+        if (id.empty()) {
+            return nullptr;
+        }
+
+        std::string imagePath;
+        {
+            ReadConnection connection(*this);
+            if (!connection) {
+                return nullptr;
+            }
+            StatementLease statement = connection.prepare(
+                "SELECT rowid, image_path FROM items WHERE id = ?1 AND type = 'image';");
+            if (!statement) {
+                return nullptr;
+            }
+            sqlite3_bind_text(statement, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(statement) != SQLITE_ROW) {
+                return nullptr;
+            }
+            imagePath = readTextColumn(statement, 1);
+            if (imagePath.empty()) {
+                return readInlineImage(connection.handle(), sqlite3_column_int64(statement, 0));
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto mapped = MappedImageBytes::open(m_baseDirectory + "/" + imagePath);
+        if (!mapped) {
+            PASTY_LOG_WARN("Core.Store", "Image asset missing for item %s", id.c_str());
+        }
+        return mapped;
+    }
+
+    bool recordContentHashAlias(ClipboardItemType type,
+                                const std::string& legacyHash,
+                                std::int32_t hashVersion,
+                                const std::string& contentHash) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_db == nullptr) {
+            return false;
+        }
+        return recordContentHashAliasUnlocked(type == ClipboardItemType::Image ? "image" : "text",
+            legacyHash, hashVersion, contentHash);
+    }
+
+    std::string resolveContentHash(ClipboardItemType type, const std::string& contentHash) override {
+        if (contentHash.empty()) {
+            return contentHash;
+        }
+        ReadConnection connection(*this);
+        if (!connection) {
+            return contentHash;
+        }
+
+        StatementLease statement = connection.prepare(
+            "SELECT content_hash FROM content_hash_aliases WHERE item_type = ?1 AND legacy_hash = ?2;");
+        if (!statement) {
+            return contentHash;
+        }
+        sqlite3_bind_text(statement, 1, type == ClipboardItemType::Image ? "image" : "text", -1, SQLITE_STATIC);
+        sqlite3_bind_text(statement, 2, contentHash.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(statement) != SQLITE_ROW) {
+            return contentHash;
+        }
+        return readTextColumn(statement, 0);
+    }
+
     bool enforceRetention(std::int32_t maxItems) override {
         std::lock_guard<std::mutex> lock(m_mutex);
         return enforceRetentionUnlocked(maxItems);
@@ -749,9 +1097,9 @@ public:
 
         std::vector<std::string> imagePathsToDelete;
         {
-            sqlite3_stmt* lookup = nullptr;
             const char* lookupSql = "SELECT image_path FROM items WHERE type = ?1 AND content_hash = ?2;";
-            if (sqlite3_prepare_v2(m_db, lookupSql, -1, &lookup, nullptr) != SQLITE_OK) {
+            StatementLease lookup = prepareCached(lookupSql);
+            if (!lookup) {
                 return 0;
             }
             sqlite3_bind_text(lookup, 1, typeStr.c_str(), -1, SQLITE_TRANSIENT);
@@ -762,12 +1110,11 @@ public:
                     imagePathsToDelete.push_back(imagePath);
                 }
             }
-            sqlite3_finalize(lookup);
         }
 
-        sqlite3_stmt* statement = nullptr;
         const char* sql = "DELETE FROM items WHERE type = ?1 AND content_hash = ?2;";
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = prepareCached(sql);
+        if (!statement) {
             return 0;
         }
 
@@ -775,11 +1122,11 @@ public:
         sqlite3_bind_text(statement, 2, contentHash.c_str(), -1, SQLITE_TRANSIENT);
         const bool ok = sqlite3_step(statement) == SQLITE_DONE;
         const int deletedCount = ok ? static_cast<int>(sqlite3_changes(m_db)) : 0;
-        sqlite3_finalize(statement);
+        m_itemCount -= deletedCount;
 
         if (deletedCount > 0) {
             for (const auto& imagePath : imagePathsToDelete) {
-                deleteAsset(imagePath);
+                releaseAssetUnlocked(imagePath);
             }
         }
 
@@ -792,13 +1139,13 @@ public:
             return false;
         }
 
-        sqlite3_stmt* statement = nullptr;
         const char* sql =
             "UPDATE items "
             "SET metadata = ?1, update_time_ms = ?2 "
             "WHERE id = ?3;";
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = prepareCached(sql);
+        if (!statement) {
             return false;
         }
 
@@ -807,7 +1154,6 @@ public:
         sqlite3_bind_text(statement, 3, id.c_str(), -1, SQLITE_TRANSIENT);
 
         const bool ok = sqlite3_step(statement) == SQLITE_DONE && sqlite3_changes(m_db) > 0;
-        sqlite3_finalize(statement);
 
         if (!ok) {
             PASTY_LOG_ERROR("Core.Store", "Update metadata failed. ID: %s", id.c_str());
@@ -815,14 +1161,205 @@ public:
         return ok;
     }
 
+    bool updateLastCopyTime(const std::string& id, HistoryTimestampMs copyTimeMs) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_db == nullptr || id.empty()) {
+            return false;
+        }
+
+        const char* sql =
+            "UPDATE items "
+            "SET last_copy_time_ms = MAX(last_copy_time_ms, ?1), update_time_ms = MAX(update_time_ms, ?1) "
+            "WHERE id = ?2;";
+
+        StatementLease statement = prepareCached(sql);
+        if (!statement) {
+            return false;
+        }
+
+        sqlite3_bind_int64(statement, 1, copyTimeMs);
+        sqlite3_bind_text(statement, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+
+        const bool ok = sqlite3_step(statement) == SQLITE_DONE && sqlite3_changes(m_db) > 0;
+
+        if (!ok) {
+            PASTY_LOG_ERROR("Core.Store", "Update copy time failed. ID: %s", id.c_str());
+        }
+        return ok;
+    }
+
 private:
     void closeUnlocked() {
+        closeReaders();
+        finalizeStatements(m_statementCache);
+
         if (m_db != nullptr) {
             sqlite3_close(m_db);
             m_db = nullptr;
         }
     }
 
+    ClipboardHistoryUpsertResult upsertTextItemUnlocked(const ClipboardHistoryItem& item) {
+        if (m_db == nullptr || item.id.empty()) {
+            return {};
+        }
+
+        bool inserted = true;
+        std::string existingId;
+        {
+            const char* existingSql = "SELECT id FROM items WHERE type='text' AND content_hash = ?1 LIMIT 1;";
+            StatementLease existing = prepareCached(existingSql);
+            if (existing) {
+                sqlite3_bind_text(existing, 1, item.contentHash.c_str(), -1, SQLITE_TRANSIENT);
+                if (sqlite3_step(existing) == SQLITE_ROW) {
+                    inserted = false;
+                    existingId = readTextColumn(existing, 0);
+                }
+            } else {
+                return {};
+            }
+        }
+
+        const char* sql =
+            "INSERT INTO items ("
+            "id, type, content, image_path, image_width, image_height, image_format, "
+            "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
+            "ocr_status, ocr_text, ocr_retry_count, ocr_next_retry_at, "
+            "origin_type, origin_device_id, preview, hash_version"
+            ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+            "ON CONFLICT(type, content_hash) DO UPDATE SET "
+            "content=excluded.content, "
+            "preview=excluded.preview, "
+            "update_time_ms=excluded.update_time_ms, "
+            "last_copy_time_ms=excluded.last_copy_time_ms, "
+            "source_app_id=excluded.source_app_id,"
+            "metadata=COALESCE(NULLIF(excluded.metadata, ''), items.metadata),"
+            "origin_type=excluded.origin_type,"
+            "origin_device_id=excluded.origin_device_id;";
+
+        StatementLease statement = prepareCached(sql);
+        if (!statement) {
+            return {};
+        }
+
+        bindCommonItemFields(statement, item, false);
+
+        const bool ok = sqlite3_step(statement) == SQLITE_DONE;
+
+        if (!ok) {
+            PASTY_LOG_ERROR("Core.Store", "Upsert text failed");
+            return {};
+        }
+
+        if (inserted) {
+            ++m_itemCount;
+        }
+        const std::string resultId = inserted ? item.id : existingId;
+        PASTY_LOG_DEBUG("Core.Store", "Upsert text succeeded. ID: %s", resultId.c_str());
+        return ClipboardHistoryUpsertResult{resultId, inserted};
+    }
+
+    // writtenAsset receives the relative path of a newly written image file so a
+    // caller that later rolls back can remove it again. imageBytes may be empty
+    // for a streamed image, whose bytes only exist in the staged file.
+    ClipboardHistoryUpsertResult upsertImageItemUnlocked(const ClipboardHistoryItem& item,
+                                                         const StagedAsset& staged,
+                                                         ImageBytesView imageBytes,
+                                                         std::string& writtenAsset) {
+        if (m_db == nullptr || item.id.empty() || (imageBytes.empty() && staged.stagingPath.empty())) {
+            return {};
+        }
+
+        std::string existingId;
+        {
+            const char* existingSql = "SELECT id FROM items WHERE type='image' AND content_hash = ?1 LIMIT 1;";
+            StatementLease existing = prepareCached(existingSql);
+            if (existing) {
+                sqlite3_bind_text(existing, 1, item.contentHash.c_str(), -1, SQLITE_TRANSIENT);
+                if (sqlite3_step(existing) == SQLITE_ROW) {
+                    existingId = readTextColumn(existing, 0);
+                }
+            }
+        }
+
+        if (!existingId.empty()) {
+            const char* updateSql =
+                "UPDATE items "
+                "SET update_time_ms = ?1, last_copy_time_ms = ?2, source_app_id = ?3, "
+                "metadata = CASE WHEN length(?5) > 0 THEN ?5 ELSE metadata END, "
+                "origin_type = ?6, origin_device_id = ?7 "
+                "WHERE id = ?4;";
+            StatementLease update = prepareCached(updateSql);
+            if (!update) {
+                PASTY_LOG_ERROR("Core.Store", "Upsert image dedupe update prepare failed");
+                return {};
+            }
+            sqlite3_bind_int64(update, 1, item.updateTimeMs);
+            sqlite3_bind_int64(update, 2, item.lastCopyTimeMs);
+            sqlite3_bind_text(update, 3, item.sourceAppId.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(update, 4, existingId.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(update, 5, item.metadata.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(update, 6, originTypeToString(item.originType).c_str(), -1, SQLITE_TRANSIENT);
+            if (item.originDeviceId.has_value() && !item.originDeviceId->empty()) {
+                sqlite3_bind_text(update, 7, item.originDeviceId->c_str(), -1, SQLITE_TRANSIENT);
+            } else {
+                sqlite3_bind_null(update, 7);
+            }
+            const bool updated = sqlite3_step(update) == SQLITE_DONE;
+            if (!updated) {
+                PASTY_LOG_ERROR("Core.Store", "Upsert image dedupe update failed. ID: %s", existingId.c_str());
+                return {};
+            }
+            // The staged file was published under our own path; drop it if the
+            // existing row uses a different one.
+            releaseAssetUnlocked(staged.relativePath);
+            PASTY_LOG_DEBUG("Core.Store", "Upsert image dedupe hit. ID: %s", existingId.c_str());
+            return ClipboardHistoryUpsertResult{existingId, false};
+        }
+
+        // Small images go into the row; there is no file to publish or release.
+        const bool inlineImage = isInlineImage(imageBytes.size);
+        if (!inlineImage && (staged.relativePath.empty() || !publishStagedAssetUnlocked(staged, imageBytes))) {
+            PASTY_LOG_ERROR("Core.Store", "Upsert image asset write failed. ID: %s", item.id.c_str());
+            return {};
+        }
+        const std::string relativePath = inlineImage ? std::string() : staged.relativePath;
+
+        const char* sql =
+            "INSERT INTO items ("
+            "id, type, content, image_path, image_width, image_height, image_format, "
+            "create_time_ms, update_time_ms, last_copy_time_ms, source_app_id, content_hash, metadata, "
+            "ocr_status, ocr_text, ocr_retry_count, ocr_next_retry_at, "
+            "origin_type, origin_device_id, preview, hash_version, image_blob"
+            ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+
+        StatementLease statement = prepareCached(sql);
+        if (!statement) {
+            releaseAssetUnlocked(relativePath);
+            return {};
+        }
+
+        bindCommonItemFields(statement, item, true, relativePath);
+        if (inlineImage) {
+            sqlite3_bind_blob64(statement, 22, imageBytes.data, imageBytes.size, SQLITE_STATIC);
+        } else {
+            sqlite3_bind_null(statement, 22);
+        }
+
+        const bool ok = sqlite3_step(statement) == SQLITE_DONE;
+
+        if (!ok) {
+            releaseAssetUnlocked(relativePath);
+            PASTY_LOG_ERROR("Core.Store", "Upsert image insert failed");
+            return {};
+        }
+
+        ++m_itemCount;
+        writtenAsset = relativePath;
+        PASTY_LOG_DEBUG("Core.Store", "Upsert image inserted. ID: %s", item.id.c_str());
+        return ClipboardHistoryUpsertResult{item.id, true};
+    }
+
     bool deleteItemUnlocked(const std::string& id) {
         if (m_db == nullptr || id.empty()) {
             return false;
@@ -830,69 +1367,404 @@ private:
 
         std::string imagePath;
         {
-            sqlite3_stmt* lookup = nullptr;
             const char* lookupSql = "SELECT image_path FROM items WHERE id = ?1;";
-            if (sqlite3_prepare_v2(m_db, lookupSql, -1, &lookup, nullptr) != SQLITE_OK) {
+            StatementLease lookup = prepareCached(lookupSql);
+            if (!lookup) {
                 return false;
             }
             sqlite3_bind_text(lookup, 1, id.c_str(), -1, SQLITE_TRANSIENT);
             if (sqlite3_step(lookup) == SQLITE_ROW) {
                 imagePath = readTextColumn(lookup, 0);
             }
-            sqlite3_finalize(lookup);
         }
 
-        sqlite3_stmt* statement = nullptr;
         const char* sql = "DELETE FROM items WHERE id = ?1;";
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        StatementLease statement = prepareCached(sql);
+        if (!statement) {
             return false;
         }
 
         sqlite3_bind_text(statement, 1, id.c_str(), -1, SQLITE_TRANSIENT);
         const bool ok = sqlite3_step(statement) == SQLITE_DONE;
-        sqlite3_finalize(statement);
 
         if (!ok) {
             PASTY_LOG_ERROR("Core.Store", "Delete item failed. ID: %s", id.c_str());
             return false;
         }
+        m_itemCount -= sqlite3_changes(m_db);
 
         if (!imagePath.empty()) {
-            deleteAsset(imagePath);
+            releaseAssetUnlocked(imagePath);
         }
 
         return true;
     }
 
+    // Retention runs on every upsert, so it only compares the maintained row
+    // count against the high-water mark. Once that is exceeded, a single sweep
+    // trims the history back down to maxItems.
     bool enforceRetentionUnlocked(std::int32_t maxItems) {
         if (m_db == nullptr || maxItems <= 0) {
             return false;
         }
 
         m_itemsLimit = maxItems;
+        if (m_itemCount <= retentionHighWaterMark(maxItems)) {
+            return true;
+        }
 
-        sqlite3_stmt* statement = nullptr;
-        const char* sql =
-            "SELECT id FROM items "
-            "ORDER BY last_copy_time_ms DESC "
-            "LIMIT -1 OFFSET ?1;";
+        std::vector<std::string> removedAssets;
+        if (!trimToUnlocked(maxItems, removedAssets)) {
+            return false;
+        }
+        for (const auto& imagePath : removedAssets) {
+            releaseAssetUnlocked(imagePath);
+        }
+        return true;
+    }
 
-        if (sqlite3_prepare_v2(m_db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+    // Deletes everything beyond the newest keepCount rows. When a transaction is
+    // already open (batch upsert) the sweep joins it and leaves commit/rollback
+    // to the caller; asset files are only reported, never deleted here, so they
+    // survive a rollback.
+    bool trimToUnlocked(std::int32_t keepCount, std::vector<std::string>& removedAssets) {
+        const bool ownsTransaction = sqlite3_get_autocommit(m_db) != 0;
+        if (ownsTransaction && !execUnlocked("BEGIN IMMEDIATE;")) {
             return false;
         }
 
-        sqlite3_bind_int(statement, 1, maxItems);
-        std::vector<std::string> toDelete;
-        while (sqlite3_step(statement) == SQLITE_ROW) {
-            toDelete.push_back(readTextColumn(statement, 0));
+        std::vector<std::string> imagePaths;
+        bool ok = false;
+        {
+            const char* lookupSql =
+                "SELECT image_path FROM items "
+                "WHERE image_path IS NOT NULL AND id IN ("
+                "SELECT id FROM items ORDER BY last_copy_time_ms DESC LIMIT -1 OFFSET ?1);";
+            StatementLease lookup = prepareCached(lookupSql);
+            if (lookup) {
+                sqlite3_bind_int(lookup, 1, keepCount);
+                while (sqlite3_step(lookup) == SQLITE_ROW) {
+                    imagePaths.push_back(readTextColumn(lookup, 0));
+                }
+                ok = true;
+            }
         }
-        sqlite3_finalize(statement);
 
-        bool ok = true;
-        for (const auto& id : toDelete) {
-            ok = deleteItemUnlocked(id) && ok;
+        if (ok) {
+            const char* sql =
+                "DELETE FROM items WHERE id IN ("
+                "SELECT id FROM items ORDER BY last_copy_time_ms DESC LIMIT -1 OFFSET ?1);";
+            StatementLease statement = prepareCached(sql);
+            ok = false;
+            if (statement) {
+                sqlite3_bind_int(statement, 1, keepCount);
+                ok = sqlite3_step(statement) == SQLITE_DONE;
+            }
         }
-        return ok;
+
+        if (ownsTransaction && (!ok || !execUnlocked("COMMIT;"))) {
+            ok = false;
+            execUnlocked("ROLLBACK;");
+        }
+        if (!ok) {
+            PASTY_LOG_ERROR("Core.Store", "Retention sweep failed");
+            return false;
+        }
+
+        const std::int64_t previousCount = m_itemCount;
+        m_itemCount = countItemsUnlocked();
+        if (m_itemCount < previousCount) {
+            ++m_retentionGeneration;
+        }
+        removedAssets.insert(removedAssets.end(), imagePaths.begin(), imagePaths.end());
+        PASTY_LOG_DEBUG("Core.Store", "Retention sweep kept %d items, removed %zu assets", keepCount, imagePaths.size());
+        return true;
+    }
+
+    std::int64_t countItemsUnlocked() {
+        StatementLease statement = prepareCached("SELECT COUNT(*) FROM items;");
+        if (!statement || sqlite3_step(statement) != SQLITE_ROW) {
+            return 0;
+        }
+        return sqlite3_column_int64(statement, 0);
+    }
+
+    bool execUnlocked(const char* sql) {
+        char* error = nullptr;
+        if (sqlite3_exec(m_db, sql, nullptr, nullptr, &error) != SQLITE_OK) {
+            PASTY_LOG_ERROR("Core.Store", "SQL failed (%s): %s", sql, error ? error : "unknown");
+            sqlite3_free(error);
+            return false;
+        }
+        return true;
+    }
+
+    static std::int64_t retentionHighWaterMark(std::int32_t maxItems) {
+        const std::int64_t slack = std::min<std::int64_t>(maxItems / kRetentionSlackDivisor, kMaxRetentionSlack);
+        return static_cast<std::int64_t>(maxItems) + slack;
+    }
+
+    StatementLease prepareCached(const char* sql) {
+        return prepareCachedStatement(m_db, m_statementCache, sql);
+    }
+
+    // Reads go through a pooled read-only connection when one is open, and
+    // otherwise fall back to the writer connection under m_mutex.
+    class ReadConnection {
+    public:
+        explicit ReadConnection(SQLiteClipboardHistoryStore& store)
+            : m_store(store)
+            , m_reader(store.acquireReader()) {
+            if (m_reader == nullptr) {
+                m_writerLock = std::unique_lock<std::mutex>(store.m_mutex);
+            }
+        }
+
+        ~ReadConnection() {
+            if (m_reader != nullptr) {
+                m_store.releaseReader(m_reader);
+            }
+        }
+
+        ReadConnection(const ReadConnection&) = delete;
+        ReadConnection& operator=(const ReadConnection&) = delete;
+
+        explicit operator bool() const {
+            return m_reader != nullptr || m_store.m_db != nullptr;
+        }
+
+        sqlite3* handle() const {
+            return m_reader != nullptr ? m_reader->db : m_store.m_db;
+        }
+
+        StatementLease prepare(const char* sql) {
+            if (m_reader != nullptr) {
+                return prepareCachedStatement(m_reader->db, m_reader->statements, sql);
+            }
+            return m_store.prepareCached(sql);
+        }
+
+    private:
+        SQLiteClipboardHistoryStore& m_store;
+        ReaderConnection* m_reader;
+        std::unique_lock<std::mutex> m_writerLock;
+    };
+
+    // Shared by search() and searchSummaries(); columns selects the projection.
+    StatementLease prepareSearch(ReadConnection& connection, const char* columns, const SearchOptions& options) {
+        const bool substringMode = options.mode == SearchMode::Substring || !tokenModeCanMatch(options.query);
+        const std::string matchExpression = substringMode
+            ? buildSubstringMatchExpression(options.query, options.includeOcr)
+            : buildFtsMatchExpression(options.query, options.includeOcr);
+        const std::string matchTable = substringMode ? "items_trigram" : "items_fts";
+        const bool useFts = !matchExpression.empty();
+        const bool useLike = !useFts && !options.query.empty();
+
+        std::string sql = std::string("SELECT ") + columns + " FROM items ";
+
+        if (useFts && options.rankByRelevance) {
+            sql += "JOIN (SELECT rowid AS match_rowid, bm25(" + matchTable + ") AS match_rank "
+                   "FROM " + matchTable + " WHERE " + matchTable + " MATCH ?1) AS matches "
+                   "ON items.rowid = matches.match_rowid WHERE 1 ";
+        } else if (useFts) {
+            sql += "WHERE items.rowid IN (SELECT rowid FROM " + matchTable + " WHERE " + matchTable + " MATCH ?1) ";
+        } else if (useLike) {
+            // Queries shorter than three characters that token mode cannot
+            // match either keep the LIKE scan.
+            sql += "WHERE (COALESCE(content, '') LIKE ?1 OR COALESCE(metadata, '') LIKE ?1 ";
+            if (options.includeOcr) {
+                sql += "OR COALESCE(ocr_text, '') LIKE ?1";
+            }
+            sql += ") ";
+        } else {
+            sql += "WHERE 1 ";
+        }
+
+        if (!options.contentType.empty()) {
+            sql += "AND type = ?3 ";
+        }
+
+        if (useFts && options.rankByRelevance) {
+            sql += "ORDER BY matches.match_rank, last_copy_time_ms DESC LIMIT ?2;";
+        } else {
+            sql += "ORDER BY last_copy_time_ms DESC LIMIT ?2;";
+        }
+
+        StatementLease statement = connection.prepare(sql.c_str());
+        if (!statement) {
+            return statement;
+        }
+
+        if (useFts) {
+            sqlite3_bind_text(statement, 1, matchExpression.c_str(), -1, SQLITE_TRANSIENT);
+        } else if (useLike) {
+            const std::string pattern = "%" + options.query + "%";
+            sqlite3_bind_text(statement, 1, pattern.c_str(), -1, SQLITE_TRANSIENT);
+        }
+        sqlite3_bind_int(statement, 2, static_cast<int>(options.limit));
+
+        if (!options.contentType.empty()) {
+            sqlite3_bind_text(statement, 3, options.contentType.c_str(), -1, SQLITE_TRANSIENT);
+        }
+
+        return statement;
+    }
+
+    // Keyset pagination over idx_items_list_summary: each page seeks directly
+    // past the previous (last_copy_time_ms, id), so the cost per page does not
+    // grow with the scroll depth. One extra row tells whether another page exists.
+    StatementLease prepareListPage(ReadConnection& connection,
+                                   const char* columns,
+                                   const std::optional<ListCursor>& position,
+                                   std::int32_t safeLimit) {
+        std::string sql = std::string("SELECT ") + columns + " FROM items ";
+        if (position.has_value()) {
+            sql += "WHERE (last_copy_time_ms, id) < (?1, ?2) ";
+        }
+        sql += "ORDER BY last_copy_time_ms DESC, id DESC LIMIT ?3;";
+
+        StatementLease statement = connection.prepare(sql.c_str());
+        if (!statement) {
+            return statement;
+        }
+
+        if (position.has_value()) {
+            sqlite3_bind_int64(statement, 1, position->lastCopyTimeMs);
+            sqlite3_bind_text(statement, 2, position->id.c_str(), -1, SQLITE_TRANSIENT);
+        }
+        sqlite3_bind_int(statement, 3, safeLimit + 1);
+        return statement;
+    }
+
+    static ClipboardHistoryItem readItemRow(sqlite3_stmt* statement) {
+        ClipboardHistoryItem item;
+        item.id = readTextColumn(statement, 0);
+        item.type = readTextColumn(statement, 1) == "image" ? ClipboardItemType::Image : ClipboardItemType::Text;
+        item.content = readTextColumn(statement, 2);
+        item.imagePath = readTextColumn(statement, 3);
+        item.imageWidth = sqlite3_column_int(statement, 4);
+        item.imageHeight = sqlite3_column_int(statement, 5);
+        item.imageFormat = readTextColumn(statement, 6);
+        item.createTimeMs = sqlite3_column_int64(statement, 7);
+        item.updateTimeMs = sqlite3_column_int64(statement, 8);
+        item.lastCopyTimeMs = sqlite3_column_int64(statement, 9);
+        item.sourceAppId = readTextColumn(statement, 10);
+        item.contentHash = readTextColumn(statement, 11);
+        item.metadata = readTextColumn(statement, 12);
+        item.ocrStatus = ocrStatusFromInt(sqlite3_column_int(statement, 13));
+        item.ocrText = readTextColumn(statement, 14);
+        item.ocrRetryCount = sqlite3_column_int(statement, 15);
+        item.ocrNextRetryAtMs = sqlite3_column_int64(statement, 16);
+        item.originType = originTypeFromString(readTextColumn(statement, 17));
+        const auto* deviceIdText = sqlite3_column_text(statement, 18);
+        if (deviceIdText != nullptr) {
+            item.originDeviceId = reinterpret_cast<const char*>(deviceIdText);
+        }
+        return item;
+    }
+
+    static ClipboardHistoryItemSummary readSummaryRow(sqlite3_stmt* statement) {
+        ClipboardHistoryItemSummary summary;
+        summary.id = readTextColumn(statement, 0);
+        summary.type = readTextColumn(statement, 1) == "image" ? ClipboardItemType::Image : ClipboardItemType::Text;
+        summary.preview = readTextColumn(statement, 2);
+        summary.imagePath = readTextColumn(statement, 3);
+        summary.imageWidth = sqlite3_column_int(statement, 4);
+        summary.imageHeight = sqlite3_column_int(statement, 5);
+        summary.imageFormat = readTextColumn(statement, 6);
+        summary.createTimeMs = sqlite3_column_int64(statement, 7);
+        summary.updateTimeMs = sqlite3_column_int64(statement, 8);
+        summary.lastCopyTimeMs = sqlite3_column_int64(statement, 9);
+        summary.sourceAppId = readTextColumn(statement, 10);
+        summary.contentHash = readTextColumn(statement, 11);
+        summary.metadata = readTextColumn(statement, 12);
+        summary.ocrStatus = ocrStatusFromInt(sqlite3_column_int(statement, 13));
+        summary.originType = originTypeFromString(readTextColumn(statement, 14));
+        const auto* deviceIdText = sqlite3_column_text(statement, 15);
+        if (deviceIdText != nullptr) {
+            summary.originDeviceId = reinterpret_cast<const char*>(deviceIdText);
+        }
+        return summary;
+    }
+
+    static std::string makeCursor(HistoryTimestampMs lastCopyTimeMs, const std::string& id) {
+        return std::to_string(lastCopyTimeMs) + ":" + id;
+    }
+
+    ReaderConnection* acquireReader() {
+        std::unique_lock<std::mutex> lock(m_readerMutex);
+        m_readerAvailable.wait(lock, [this]() { return m_readers.empty() || !m_idleReaders.empty(); });
+        if (m_idleReaders.empty()) {
+            return nullptr;
+        }
+        ReaderConnection* reader = m_idleReaders.back();
+        m_idleReaders.pop_back();
+        return reader;
+    }
+
+    void releaseReader(ReaderConnection* reader) {
+        {
+            std::lock_guard<std::mutex> lock(m_readerMutex);
+            m_idleReaders.push_back(reader);
+        }
+        m_readerAvailable.notify_one();
+    }
+
+    bool configureConnection(sqlite3* db, bool reader) {
+        std::string pragmas = "PRAGMA busy_timeout = 5000;";
+        pragmas += "PRAGMA cache_size = -" + std::to_string(std::max<std::int32_t>(m_options.cacheSizeKiB, 0)) + ";";
+        pragmas += "PRAGMA mmap_size = " + std::to_string(std::max<std::int64_t>(m_options.mmapSizeBytes, 0)) + ";";
+        if (reader) {
+            pragmas += "PRAGMA query_only = 1;";
+        } else {
+            pragmas += m_options.walEnabled ? "PRAGMA journal_mode = WAL;" : "PRAGMA journal_mode = DELETE;";
+            pragmas += "PRAGMA synchronous = " + normalizeSynchronousMode(m_options.synchronous) + ";";
+        }
+
+        char* error = nullptr;
+        if (sqlite3_exec(db, pragmas.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+            PASTY_LOG_ERROR("Core.Store", "Failed to configure connection: %s", error ? error : "unknown");
+            sqlite3_free(error);
+            return false;
+        }
+        return true;
+    }
+
+    // Called with m_mutex held once the writer has migrated the schema.
+    void openReadersUnlocked() {
+        if (!m_options.walEnabled || m_options.readerConnections <= 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_readerMutex);
+        for (std::int32_t i = 0; i < m_options.readerConnections; ++i) {
+            sqlite3* db = nullptr;
+            const int openResult = sqlite3_open_v2(m_dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr);
+            if (openResult != SQLITE_OK || db == nullptr || !configureConnection(db, true)) {
+                PASTY_LOG_WARN("Core.Store", "Failed to open reader connection %d, continuing with %zu", i, m_readers.size());
+                sqlite3_close(db);
+                break;
+            }
+            auto reader = std::make_unique<ReaderConnection>();
+            reader->db = db;
+            m_idleReaders.push_back(reader.get());
+            m_readers.push_back(std::move(reader));
+        }
+    }
+
+    // Waits for in-flight reads to hand their connection back before closing.
+    void closeReaders() {
+        {
+            std::unique_lock<std::mutex> lock(m_readerMutex);
+            m_readerAvailable.wait(lock, [this]() { return m_idleReaders.size() == m_readers.size(); });
+            for (auto& reader : m_readers) {
+                finalizeStatements(reader->statements);
+                sqlite3_close(reader->db);
+            }
+            m_idleReaders.clear();
+            m_readers.clear();
+        }
+        m_readerAvailable.notify_all();
     }
 
 private:
@@ -912,6 +1784,14 @@ private:
             [&]() { return applyMigration(3, "0003-add-metadata.sql"); },
             [&]() { return applyMigration(4, "0004-add-ocr-support.sql"); },
             [&]() { return applyMigration(5, "0005-add-origin-tracking.sql"); },
+            [&]() { return applyMigration(6, "0006-add-fts-search.sql"); },
+            [&]() { return applyMigration(7, "0007-add-trigram-search.sql"); },
+            [&]() { return applyMigration(8, "0008-add-keyset-pagination-index.sql"); },
+            [&]() { return applyMigration(9, "0009-add-item-preview.sql"); },
+            [&]() { return applyMigration(10, "0010-add-content-addressed-assets.sql"); },
+            [&]() { return applyMigration(11, "0011-add-inline-image-blob.sql"); },
+            [&]() { return applyMigration(12, "0012-add-hash-version.sql"); },
+            [&]() { return applyMigration(13, "0013-add-content-hash-aliases.sql"); },
         };
 
         for (size_t i = currentVersion; i < migrations.size(); ++i) {
@@ -968,6 +1848,8 @@ private:
         const std::string brokenPath = m_dbPath + ".broken";
         std::remove(brokenPath.c_str());
         std::rename(m_dbPath.c_str(), brokenPath.c_str());
+        std::remove((m_dbPath + "-wal").c_str());
+        std::remove((m_dbPath + "-shm").c_str());
 
         const int openResult = sqlite3_open_v2(
             m_dbPath.c_str(),
@@ -975,7 +1857,7 @@ private:
             SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
             nullptr
         );
-        if (openResult != SQLITE_OK || m_db == nullptr) {
+        if (openResult != SQLITE_OK || m_db == nullptr || !configureConnection(m_db, false)) {
             closeUnlocked();
             PASTY_LOG_ERROR("Core.Store", "SQLite recreation failed");
             return false;
@@ -983,6 +1865,8 @@ private:
 
         const bool migrated = migrateSchema();
         if (migrated) {
+            m_itemCount = countItemsUnlocked();
+            openReadersUnlocked();
             PASTY_LOG_INFO("Core.Store", "SQLite recreation succeeded");
         } else {
             PASTY_LOG_ERROR("Core.Store", "SQLite recreation migrate failed");
@@ -1035,6 +1919,10 @@ private:
         } else {
             sqlite3_bind_null(statement, 19);
         }
+        const std::string preview = truncateUtf8(isImage ? item.ocrText : item.content, kHistoryPreviewCodePoints);
+        sqlite3_bind_text(statement, 20, preview.c_str(), -1, SQLITE_TRANSIENT);
+        // Every hash handed to the store comes from content_hash at its current version.
+        sqlite3_bind_int(statement, 21, content_hash::kCurrentVersion);
     }
 
     static std::string readTextColumn(sqlite3_stmt* statement, int column) {
@@ -1045,43 +1933,400 @@ private:
         return reinterpret_cast<const char*>(text);
     }
 
-    static std::int64_t parseCursor(const std::string& cursor) {
+    // Cursors are "<last_copy_time_ms>:<id>". A bare timestamp (the previous
+    // format) resumes before that millisecond. Anything else starts over.
+    static std::optional<ListCursor> parseCursor(const std::string& cursor) {
         if (cursor.empty()) {
-            return 0;
+            return std::nullopt;
         }
         std::istringstream stream(cursor);
-        std::int64_t value = 0;
-        stream >> value;
-        return stream.fail() ? 0 : value;
+        ListCursor position;
+        stream >> position.lastCopyTimeMs;
+        if (stream.fail()) {
+            return std::nullopt;
+        }
+        if (stream.peek() == ':') {
+            stream.get();
+            std::getline(stream, position.id);
+        } else if (!stream.eof()) {
+            return std::nullopt;
+        }
+        return position;
     }
 
-    std::string writeAssetAtomically(const std::string& id, const std::string& extension, const std::vector<std::uint8_t>& bytes) {
-        const std::string relativePath = std::string("images/") + id + "." + extension;
-        const std::string targetPath = m_baseDirectory + "/" + relativePath;
-        const std::string tempPath = targetPath + ".tmp";
+    // Assets are content addressed: images/ab/cd/<hash>.<ext>. Identical bytes
+    // map to the same path, so an existing file is reused rather than rewritten.
+    static std::string assetRelativePath(const std::string& key, const std::string& extension) {
+        std::string name;
+        name.reserve(key.size());
+        for (const char character : key) {
+            const bool safe = (character >= '0' && character <= '9') || (character >= 'a' && character <= 'z')
+                || (character >= 'A' && character <= 'Z') || character == '-' || character == '_';
+            name.push_back(safe ? character : '_');
+        }
+        return "images/" + name.substr(0, 2) + "/" + name.substr(2, 2) + "/" + name + "." + extension;
+    }
 
-        std::ofstream output(tempPath, std::ios::binary | std::ios::trunc);
-        if (!output.is_open()) {
-            return std::string();
+    bool writeAssetFile(const std::string& path, ImageBytesView bytes) {
+        return m_assetWriter->writeFile(path, bytes.data, bytes.size);
+    }
+
+    // Runs without m_mutex. Nothing is written when the content-addressed file
+    // already exists, which is also the case for every dedupe hit.
+    StagedAsset stageAsset(const ClipboardHistoryItem& item, ImageBytesView bytes) {
+        StagedAsset staged;
+        const std::string key = item.contentHash.empty() ? item.id : item.contentHash;
+        const std::string relativePath = assetRelativePath(key, normalizeImageExtension(item.imageFormat));
+
+        std::error_code ec;
+        if (std::filesystem::exists(std::filesystem::path(m_baseDirectory) / relativePath, ec)) {
+            staged.relativePath = relativePath;
+            return staged;
+        }
+
+        const std::string stagingPath = m_stagingDirectory + "/" + std::to_string(++m_stagingSequence) + ".tmp";
+        if (!writeAssetFile(stagingPath, bytes)) {
+            return staged;
         }
+        staged.relativePath = relativePath;
+        staged.stagingPath = stagingPath;
+        publishStagedAsset(staged);
+        return staged;
+    }
 
-        output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
-        output.flush();
-        output.close();
+    // Runs without m_mutex, so the directory barriers do not serialize other
+    // store calls. The staged file is linked rather than renamed: if the last
+    // row using this path is deleted before ours is inserted, the file is
+    // unlinked again and publishStagedAssetUnlocked restores it from staging.
+    // A failure here is retried under the mutex.
+    void publishStagedAsset(const StagedAsset& staged) {
+        const std::filesystem::path targetPath = std::filesystem::path(m_baseDirectory) / staged.relativePath;
+        if (ensureAssetDirectory(targetPath.parent_path())) {
+            m_assetWriter->publishLink(staged.stagingPath, targetPath.string());
+        }
+    }
 
-        if (std::rename(tempPath.c_str(), targetPath.c_str()) != 0) {
-            std::remove(tempPath.c_str());
-            return std::string();
+    // Creates the shard directories for an asset and makes each new directory
+    // entry durable by syncing the directory that now contains it.
+    bool ensureAssetDirectory(const std::filesystem::path& directory) {
+        std::error_code ec;
+        std::vector<std::filesystem::path> created;
+        for (std::filesystem::path current = directory;
+             !current.empty() && !std::filesystem::exists(current, ec);
+             current = current.parent_path()) {
+            created.push_back(current);
+        }
+        std::filesystem::create_directories(directory, ec);
+        if (ec) {
+            return false;
+        }
+        for (auto it = created.rbegin(); it != created.rend(); ++it) {
+            if (!m_assetWriter->syncFile(it->parent_path().string())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Makes sure the staged asset is at its final path before its row is
+    // inserted. Normally publishStagedAsset already put it there; if it failed
+    // or the file vanished since (its last row was deleted), it is published
+    // again here, from the staged file or from bytes.
+    bool publishStagedAssetUnlocked(const StagedAsset& staged, ImageBytesView bytes) {
+        const std::filesystem::path targetPath = std::filesystem::path(m_baseDirectory) / staged.relativePath;
+        std::error_code ec;
+        if (std::filesystem::exists(targetPath, ec)) {
+            return true;
+        }
+
+        if (!ensureAssetDirectory(targetPath.parent_path())) {
+            return false;
+        }
+
+        std::string sourcePath = staged.stagingPath;
+        if (sourcePath.empty()) {
+            sourcePath = m_stagingDirectory + "/" + std::to_string(++m_stagingSequence) + ".tmp";
+            if (!writeAssetFile(sourcePath, bytes)) {
+                return false;
+            }
+        }
+
+        // The rename is durable before the caller inserts the row, so a
+        // committed row never points at a missing or partial file.
+        if (!m_assetWriter->publish(sourcePath, targetPath.string())) {
+            std::remove(sourcePath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool isInlineImage(std::size_t size) const {
+        return size > 0 && size <= m_options.inlineImageMaxBytes;
+    }
+
+    static std::unique_ptr<ClipboardImageBytes> readInlineImage(sqlite3* db, std::int64_t rowid) {
+        sqlite3_blob* blob = nullptr;
+        if (sqlite3_blob_open(db, "main", "items", "image_blob", rowid, 0, &blob) != SQLITE_OK) {
+            PASTY_LOG_ERROR("Core.Store", "Open inline image failed: %s", sqlite3_errmsg(db));
+            sqlite3_blob_close(blob);
+            return nullptr;
+        }
+        std::vector<std::uint8_t> bytes(static_cast<std::size_t>(sqlite3_blob_bytes(blob)));
+        const bool ok = bytes.empty()
+            || sqlite3_blob_read(blob, bytes.data(), static_cast<int>(bytes.size()), 0) == SQLITE_OK;
+        sqlite3_blob_close(blob);
+        if (!ok) {
+            return nullptr;
         }
+        return std::make_unique<BufferedImageBytes>(std::move(bytes));
+    }
 
-        return relativePath;
+    static void discardStagedAsset(const StagedAsset& staged) {
+        if (!staged.stagingPath.empty()) {
+            std::remove(staged.stagingPath.c_str());
+        }
     }
 
-    bool deleteAsset(const std::string& relativePath) {
+    // Staged files left behind by a crash between staging and commit.
+    void clearStagingDirectoryUnlocked() {
+        std::error_code ec;
+        std::filesystem::remove_all(m_stagingDirectory, ec);
+        ensureDirectoryExists(m_stagingDirectory);
+    }
+
+    // Unlinks an asset file once no row references it any more. Callers run
+    // this after the deleting statement (or transaction) has completed.
+    bool releaseAssetUnlocked(const std::string& relativePath) {
+        if (relativePath.empty() || isAssetReferencedUnlocked(relativePath)) {
+            return false;
+        }
         std::remove((m_baseDirectory + "/" + relativePath).c_str());
         return true;
     }
 
+    bool isAssetReferencedUnlocked(const std::string& relativePath) {
+        StatementLease statement = prepareCached("SELECT 1 FROM image_assets WHERE path = ?1;");
+        if (!statement) {
+            // Without the count we cannot prove the file is unused; keep it.
+            return true;
+        }
+        sqlite3_bind_text(statement, 1, relativePath.c_str(), -1, SQLITE_TRANSIENT);
+        return sqlite3_step(statement) == SQLITE_ROW;
+    }
+
+    // Finishes the file half of migration 10: rows already point at the
+    // sharded paths, so move each legacy flat file into place.
+    void applyPendingAssetMovesUnlocked() {
+        std::vector<std::pair<std::string, std::string>> moves;
+        {
+            StatementLease pending = prepareCached("SELECT old_path, new_path FROM image_asset_moves;");
+            if (!pending) {
+                return;
+            }
+            while (sqlite3_step(pending) == SQLITE_ROW) {
+                moves.emplace_back(readTextColumn(pending, 0), readTextColumn(pending, 1));
+            }
+        }
+
+        for (const auto& move : moves) {
+            const std::filesystem::path source = std::filesystem::path(m_baseDirectory) / move.first;
+            const std::filesystem::path target = std::filesystem::path(m_baseDirectory) / move.second;
+            std::error_code ec;
+            if (std::filesystem::exists(source, ec)) {
+                ensureAssetDirectory(target.parent_path());
+                if (std::filesystem::exists(target, ec)) {
+                    std::filesystem::remove(source, ec);
+                } else {
+                    std::filesystem::rename(source, target, ec);
+                }
+                if (ec) {
+                    PASTY_LOG_ERROR("Core.Store", "Failed to move legacy asset %s", move.first.c_str());
+                    continue;
+                }
+            }
+
+            StatementLease done = prepareCached("DELETE FROM image_asset_moves WHERE old_path = ?1;");
+            if (done) {
+                sqlite3_bind_text(done, 1, move.first.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_step(done);
+            }
+        }
+        if (!moves.empty()) {
+            PASTY_LOG_INFO("Core.Store", "Moved %zu legacy assets into sharded directories", moves.size());
+        }
+    }
+
+    // Brings content_hash of rows written under an older hashing scheme up to
+    // the current one, so new ingests dedupe against them. Text is rehashed
+    // from the row; images from their asset file or inline blob. A row whose
+    // image cannot be read keeps its old hash and is retried on the next open.
+    // Each changed hash is kept as an alias, so peers and tombstones that
+    // still name the item by its old hash find it. Rows are paged by rowid so
+    // only one batch of legacy content is held at a time.
+    void rehashLegacyRowsUnlocked() {
+        struct LegacyRow {
+            std::int64_t rowid = 0;
+            std::int32_t version = 0;
+            bool isImage = false;
+            std::string content;
+            std::string imagePath;
+            std::string contentHash;
+        };
+        constexpr int kBatchSize = 256;
+
+        std::size_t scanned = 0;
+        std::size_t rehashed = 0;
+        std::size_t merged = 0;
+        std::int64_t lastRowid = 0;
+        for (;;) {
+            std::vector<LegacyRow> rows;
+            {
+                StatementLease legacy = prepareCached(
+                    "SELECT rowid, hash_version, type, content, image_path, content_hash FROM items "
+                    "WHERE hash_version < ?1 AND rowid > ?2 ORDER BY rowid LIMIT ?3;");
+                if (!legacy) {
+                    break;
+                }
+                sqlite3_bind_int(legacy, 1, content_hash::kCurrentVersion);
+                sqlite3_bind_int64(legacy, 2, lastRowid);
+                sqlite3_bind_int(legacy, 3, kBatchSize);
+                while (sqlite3_step(legacy) == SQLITE_ROW) {
+                    LegacyRow row;
+                    row.rowid = sqlite3_column_int64(legacy, 0);
+                    row.version = sqlite3_column_int(legacy, 1);
+                    row.isImage = readTextColumn(legacy, 2) == "image";
+                    row.content = readTextColumn(legacy, 3);
+                    row.imagePath = readTextColumn(legacy, 4);
+                    row.contentHash = readTextColumn(legacy, 5);
+                    rows.push_back(std::move(row));
+                }
+            }
+            if (rows.empty() || !execUnlocked("BEGIN IMMEDIATE;")) {
+                break;
+            }
+            lastRowid = rows.back().rowid;
+            scanned += rows.size();
+
+            // Rows whose hash is the same under the current scheme only get
+            // their version bumped (a NULL hash keeps the stored one). Image
+            // files are mapped lazily, so sizing one does not read it.
+            std::vector<std::string> releasedAssets;
+            for (const LegacyRow& row : rows) {
+                std::string hash;
+                bool changed = true;
+                if (!row.isImage) {
+                    changed = content_hash::hashChangedSince(row.version, ClipboardItemType::Text, row.content.size());
+                    if (changed) {
+                        hash = content_hash::computeTextHash(row.content);
+                    }
+                } else {
+                    const std::unique_ptr<ClipboardImageBytes> bytes = row.imagePath.empty()
+                        ? readInlineImage(m_db, row.rowid)
+                        : MappedImageBytes::open(m_baseDirectory + "/" + row.imagePath);
+                    if (!bytes) {
+                        continue;
+                    }
+                    changed = content_hash::hashChangedSince(row.version, ClipboardItemType::Image, bytes->size());
+                    if (changed) {
+                        hash = content_hash::computeImageHash(ImageBytesView(bytes->data(), bytes->size()));
+                    }
+                }
+
+                const char* itemType = row.isImage ? "image" : "text";
+                const int updateResult = updateLegacyHashUnlocked(row.rowid, changed ? &hash : nullptr);
+                if (updateResult == SQLITE_CONSTRAINT) {
+                    // The same content was ingested under the current scheme
+                    // after this row last failed to rehash: fold the legacy
+                    // row into that one instead of leaving a duplicate.
+                    if (mergeLegacyRowUnlocked(row.rowid, itemType, hash)) {
+                        ++merged;
+                        recordContentHashAliasUnlocked(itemType, row.contentHash, row.version, hash);
+                        if (!row.imagePath.empty()) {
+                            releasedAssets.push_back(row.imagePath);
+                        }
+                    }
+                } else if (updateResult == SQLITE_DONE && changed) {
+                    ++rehashed;
+                    recordContentHashAliasUnlocked(itemType, row.contentHash, row.version, hash);
+                }
+            }
+
+            if (!execUnlocked("COMMIT;")) {
+                execUnlocked("ROLLBACK;");
+                break;
+            }
+            for (const std::string& asset : releasedAssets) {
+                releaseAssetUnlocked(asset);
+            }
+        }
+
+        if (scanned > 0) {
+            PASTY_LOG_INFO("Core.Store", "Rehashed %zu and merged %zu of %zu legacy items to hash version %d",
+                rehashed, merged, scanned, content_hash::kCurrentVersion);
+        }
+    }
+
+    // Returns the sqlite3_step result so callers can tell a hash conflict apart.
+    int updateLegacyHashUnlocked(std::int64_t rowid, const std::string* hash) {
+        StatementLease update = prepareCached(
+            "UPDATE items SET content_hash = COALESCE(?1, content_hash), hash_version = ?2 WHERE rowid = ?3;");
+        if (!update) {
+            return SQLITE_ERROR;
+        }
+        if (hash != nullptr) {
+            sqlite3_bind_text(update, 1, hash->c_str(), -1, SQLITE_TRANSIENT);
+        } else {
+            sqlite3_bind_null(update, 1);
+        }
+        sqlite3_bind_int(update, 2, content_hash::kCurrentVersion);
+        sqlite3_bind_int64(update, 3, rowid);
+        return sqlite3_step(update);
+    }
+
+    // The surviving row keeps its own metadata and takes the later copy time.
+    bool mergeLegacyRowUnlocked(std::int64_t rowid, const char* itemType, const std::string& contentHash) {
+        StatementLease touch = prepareCached(
+            "UPDATE items SET last_copy_time_ms = MAX(last_copy_time_ms, "
+            "(SELECT last_copy_time_ms FROM items WHERE rowid = ?3)) "
+            "WHERE type = ?1 AND content_hash = ?2;");
+        if (!touch) {
+            return false;
+        }
+        sqlite3_bind_text(touch, 1, itemType, -1, SQLITE_STATIC);
+        sqlite3_bind_text(touch, 2, contentHash.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(touch, 3, rowid);
+        if (sqlite3_step(touch) != SQLITE_DONE) {
+            return false;
+        }
+
+        StatementLease remove = prepareCached("DELETE FROM items WHERE rowid = ?1;");
+        if (!remove) {
+            return false;
+        }
+        sqlite3_bind_int64(remove, 1, rowid);
+        return sqlite3_step(remove) == SQLITE_DONE;
+    }
+
+    bool recordContentHashAliasUnlocked(const char* itemType,
+                                        const std::string& legacyHash,
+                                        std::int32_t hashVersion,
+                                        const std::string& contentHash) {
+        if (legacyHash.empty() || contentHash.empty() || legacyHash == contentHash) {
+            return true;
+        }
+        StatementLease statement = prepareCached(
+            "INSERT OR REPLACE INTO content_hash_aliases (item_type, legacy_hash, hash_version, content_hash) "
+            "VALUES (?1, ?2, ?3, ?4);");
+        if (!statement) {
+            return false;
+        }
+        sqlite3_bind_text(statement, 1, itemType, -1, SQLITE_STATIC);
+        sqlite3_bind_text(statement, 2, legacyHash.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(statement, 3, hashVersion);
+        sqlite3_bind_text(statement, 4, contentHash.c_str(), -1, SQLITE_TRANSIENT);
+        return sqlite3_step(statement) == SQLITE_DONE;
+    }
+
     static std::string normalizeImageExtension(const std::string& formatHint) {
         if (formatHint.empty()) {
             return "png";
@@ -1098,12 +2343,23 @@ private:
         return normalized;
     }
 
+    ClipboardHistoryStoreOptions m_options;
+    std::shared_ptr<DurableAssetWriter> m_assetWriter;
     sqlite3* m_db;
     std::string m_baseDirectory;
     std::string m_assetsDirectory;
+    std::string m_stagingDirectory;
+    std::atomic<std::uint64_t> m_stagingSequence{0};
     std::string m_dbPath;
     std::int32_t m_itemsLimit;
+    std::int64_t m_itemCount;
+    StatementCache m_statementCache;
     std::mutex m_mutex;
+    std::atomic<std::uint64_t> m_retentionGeneration{0};
+    std::vector<std::unique_ptr<ReaderConnection>> m_readers;
+    std::vector<ReaderConnection*> m_idleReaders;
+    std::mutex m_readerMutex;
+    std::condition_variable m_readerAvailable;
 };
 
 }
@@ -1113,7 +2369,11 @@ void setClipboardHistoryMigrationDirectory(const std::string& path) {
 }
 
 std::unique_ptr<ClipboardHistoryStore> createClipboardHistoryStore() {
-    return std::make_unique<SQLiteClipboardHistoryStore>();
+    return createClipboardHistoryStore(ClipboardHistoryStoreOptions{});
+}
+
+std::unique_ptr<ClipboardHistoryStore> createClipboardHistoryStore(const ClipboardHistoryStoreOptions& options) {
+    return std::make_unique<SQLiteClipboardHistoryStore>(options);
 }
 
 }
@@ -0,0 +1,290 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#include "utils/content_hash.h"
+
+#define XXH_INLINE_ALL
+#include "xxhash/xxhash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace pasty::content_hash {
+
+namespace {
+
+std::string toHex(std::uint64_t value) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        hex[static_cast<std::size_t>(i)] = kDigits[value & 0xF];
+        value >>= 4;
+    }
+    return hex;
+}
+
+constexpr std::size_t kTreeHashMaxThreads = 4;
+
+std::uint64_t combineChunkDigests(const std::vector<std::uint64_t>& digests, std::size_t totalSize) {
+    std::vector<XXH64_canonical_t> canonical(digests.size());
+    for (std::size_t i = 0; i < digests.size(); ++i) {
+        XXH64_canonicalFromHash(&canonical[i], digests[i]);
+    }
+    return XXH3_64bits_withSeed(canonical.data(), canonical.size() * sizeof(XXH64_canonical_t),
+        static_cast<XXH64_hash_t>(totalSize));
+}
+
+// Helper threads shared by every tree hash in the process. They start on
+// first use and stay parked until the process exits, so hashing an image does
+// not pay for thread creation and concurrent hashes never run more than
+// kTreeHashMaxThreads - 1 helpers between them.
+class TreeHashPool {
+public:
+    static TreeHashPool& instance() {
+        static TreeHashPool pool;
+        return pool;
+    }
+
+    ~TreeHashPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    // Runs work on the caller and on up to helpers pool threads. work must be
+    // safe to run concurrently and to find nothing left to do; run() returns
+    // once the caller's call and every helper call that started are done.
+    void run(const std::function<void()>& work, std::size_t helpers) {
+        Job job{&work, 0, 0};
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            startThreadsLocked(helpers);
+            job.wanted = std::min(helpers, m_threads.size());
+            if (job.wanted > 0) {
+                m_jobs.push_back(&job);
+            }
+        }
+        m_wake.notify_all();
+
+        work();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobs.erase(std::remove(m_jobs.begin(), m_jobs.end(), &job), m_jobs.end());
+        m_done.wait(lock, [&job]() { return job.running == 0; });
+    }
+
+private:
+    struct Job {
+        const std::function<void()>* work;
+        std::size_t wanted;
+        std::size_t running;
+    };
+
+    TreeHashPool() = default;
+
+    // If a thread cannot be started the ones that did (or the callers alone)
+    // do the work.
+    void startThreadsLocked(std::size_t wanted) {
+        wanted = std::min(wanted, kTreeHashMaxThreads - 1);
+        while (m_threads.size() < wanted) {
+            try {
+                m_threads.emplace_back([this]() { workerLoop(); });
+            } catch (const std::system_error&) {
+                break;
+            }
+        }
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            Job* job = m_jobs.front();
+            if (--job->wanted == 0) {
+                m_jobs.pop_front();
+            }
+            ++job->running;
+            lock.unlock();
+            (*job->work)();
+            lock.lock();
+            if (--job->running == 0) {
+                m_done.notify_all();
+            }
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::deque<Job*> m_jobs;
+    std::vector<std::thread> m_threads;
+    bool m_stopping = false;
+};
+
+// Workers pull chunk indexes from a shared counter, so a slow thread never
+// holds up more than the chunk it is on, and the caller's own pass finishes
+// whatever the helpers have not claimed.
+std::uint64_t treeHash(const std::uint8_t* data, std::size_t size, std::size_t maxThreads) {
+    const std::size_t chunkCount = (size + kTreeHashChunkBytes - 1) / kTreeHashChunkBytes;
+    std::vector<std::uint64_t> digests(chunkCount);
+    std::atomic<std::size_t> next{0};
+    const std::function<void()> work = [&]() {
+        for (std::size_t chunk = next.fetch_add(1); chunk < chunkCount; chunk = next.fetch_add(1)) {
+            const std::size_t offset = chunk * kTreeHashChunkBytes;
+            digests[chunk] = XXH3_64bits(data + offset, std::min(kTreeHashChunkBytes, size - offset));
+        }
+    };
+
+    const std::size_t threads = std::min(std::max<std::size_t>(maxThreads, 1), chunkCount);
+    if (threads <= 1) {
+        work();
+    } else {
+        TreeHashPool::instance().run(work, threads - 1);
+    }
+    return combineChunkDigests(digests, size);
+}
+
+std::size_t defaultTreeHashThreads() {
+    const unsigned hardware = std::thread::hardware_concurrency();
+    return std::min<std::size_t>(kTreeHashMaxThreads, hardware == 0 ? 1 : hardware);
+}
+
+} // namespace
+
+struct ImageHasher::State {
+    XXH3_state_t whole;
+    XXH3_state_t chunk;
+    std::vector<std::uint64_t> chunkDigests;
+};
+
+// memchr finds each CR with the C library's vectorized scan. A CR that starts
+// a CRLF is dropped and a lone CR becomes LF. Short runs between CRs are
+// gathered in a small stack buffer so XXH3 sees large updates instead of one
+// per line; runs longer than the buffer are hashed in place.
+std::string computeTextHash(const std::string& text) {
+    const char* cursor = text.data();
+    const char* const end = cursor + text.size();
+    const void* firstCr = std::memchr(cursor, '\r', text.size());
+    if (firstCr == nullptr) {
+        return toHex(XXH3_64bits(cursor, text.size()));
+    }
+
+    XXH3_state_t state;
+    XXH3_64bits_reset(&state);
+    char buffer[16 * 1024];
+    std::size_t buffered = 0;
+    const auto append = [&](const char* data, std::size_t size) {
+        if (buffered + size > sizeof(buffer)) {
+            XXH3_64bits_update(&state, buffer, buffered);
+            buffered = 0;
+            if (size > sizeof(buffer)) {
+                XXH3_64bits_update(&state, data, size);
+                return;
+            }
+        }
+        std::memcpy(buffer + buffered, data, size);
+        buffered += size;
+    };
+
+    const char* cr = static_cast<const char*>(firstCr);
+    while (cr != nullptr) {
+        append(cursor, static_cast<std::size_t>(cr - cursor));
+        cursor = cr + 1;
+        if (cursor == end || *cursor != '\n') {
+            append("\n", 1);
+        }
+        cr = cursor == end ? nullptr : static_cast<const char*>(std::memchr(cursor, '\r', static_cast<std::size_t>(end - cursor)));
+    }
+    append(cursor, static_cast<std::size_t>(end - cursor));
+    XXH3_64bits_update(&state, buffer, buffered);
+    return toHex(XXH3_64bits_digest(&state));
+}
+
+std::string computeImageHash(ImageBytesView bytes) {
+    return computeImageHash(bytes, defaultTreeHashThreads());
+}
+
+std::string computeImageHash(ImageBytesView bytes, std::size_t maxThreads) {
+    if (bytes.empty()) {
+        return std::string();
+    }
+    if (bytes.size >= kTreeHashThresholdBytes) {
+        return toHex(treeHash(bytes.data, bytes.size, maxThreads));
+    }
+    return toHex(XXH3_64bits(bytes.data, bytes.size));
+}
+
+bool hashChangedSince(std::int32_t version, ClipboardItemType type, std::size_t size) {
+    if (version < 2) {
+        return true;
+    }
+    if (version < 3) {
+        return type == ClipboardItemType::Image && size >= kTreeHashThresholdBytes;
+    }
+    return false;
+}
+
+std::string hashBytes(const void* data, std::size_t size) {
+    return toHex(XXH3_64bits(data, size));
+}
+
+ImageHasher::ImageHasher()
+    : m_state(std::make_unique<State>())
+    , m_size(0)
+    , m_chunkFill(0) {
+    XXH3_64bits_reset(&m_state->whole);
+    XXH3_64bits_reset(&m_state->chunk);
+}
+
+ImageHasher::~ImageHasher() = default;
+
+void ImageHasher::update(const std::uint8_t* data, std::size_t size) {
+    if (m_size + size < kTreeHashThresholdBytes) {
+        XXH3_64bits_update(&m_state->whole, data, size);
+    }
+    m_size += size;
+
+    while (size > 0) {
+        const std::size_t take = std::min(size, kTreeHashChunkBytes - m_chunkFill);
+        XXH3_64bits_update(&m_state->chunk, data, take);
+        data += take;
+        size -= take;
+        m_chunkFill += take;
+        if (m_chunkFill == kTreeHashChunkBytes) {
+            m_state->chunkDigests.push_back(XXH3_64bits_digest(&m_state->chunk));
+            XXH3_64bits_reset(&m_state->chunk);
+            m_chunkFill = 0;
+        }
+    }
+}
+
+std::string ImageHasher::finish() const {
+    if (m_size == 0) {
+        return std::string();
+    }
+    if (m_size < kTreeHashThresholdBytes) {
+        return toHex(XXH3_64bits_digest(&m_state->whole));
+    }
+    std::vector<std::uint64_t> digests = m_state->chunkDigests;
+    if (m_chunkFill > 0) {
+        digests.push_back(XXH3_64bits_digest(&m_state->chunk));
+    }
+    return toHex(combineChunkDigests(digests, m_size));
+}
+
+} // namespace pasty::content_hash
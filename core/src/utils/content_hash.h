@@ -0,0 +1,87 @@
+// Pasty - Copyright (c) 2026. MIT License.
+
+#pragma once
+
+#include "history/clipboard_history_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace pasty::content_hash {
+
+/**
+ * Content hashing shared by ingest, the sync exporter and the store.
+ *
+ * Hashes are 16 lowercase hex digits. Each item records the scheme that
+ * produced its content_hash (items.hash_version); the store rehashes rows
+ * written under an older scheme when it opens, so dedupe lookups only ever
+ * compare hashes of the current version.
+ *
+ * Version 1: FNV-1a 64 over a CRLF-normalized copy of the text.
+ * Version 2: XXH3-64. Text is normalized (CRLF and lone CR become LF) while
+ *            it is hashed, without building a normalized copy.
+ * Version 3: as version 2, except images of kTreeHashThresholdBytes or more
+ *            use the tree hash: XXH3-64 of every kTreeHashChunkBytes chunk,
+ *            then XXH3-64 (seeded with the total size) over those digests.
+ *            Chunks are independent, so they are hashed on several threads.
+ *
+ * The threshold and chunk size are part of the scheme, not tuning knobs:
+ * changing either changes stored hashes and needs a new version.
+ *
+ * Sync events carry the version as hash_version (absent means version 1).
+ * The store keeps every hash it replaced in content_hash_aliases, so events
+ * and tombstones from peers on an older version still resolve.
+ */
+constexpr std::int32_t kLegacyFnvVersion = 1;
+constexpr std::int32_t kCurrentVersion = 3;
+
+constexpr std::size_t kTreeHashChunkBytes = 1024 * 1024;
+constexpr std::size_t kTreeHashThresholdBytes = 4 * 1024 * 1024;
+
+std::string computeTextHash(const std::string& text);
+// Empty input hashes to an empty string, which no stored image carries.
+// Tree-hashed images use up to min(4, hardware threads) threads, the caller's
+// included; the others come from a process-wide pool of at most 3 threads
+// that is shared by concurrent calls.
+std::string computeImageHash(ImageBytesView bytes);
+// Same result with an explicit thread budget; 1 hashes every chunk on the
+// calling thread.
+std::string computeImageHash(ImageBytesView bytes, std::size_t maxThreads);
+
+// Whether content of this type and size hashes differently under
+// kCurrentVersion than under version, i.e. whether a stored row needs its
+// hash recomputed rather than just its version bumped.
+bool hashChangedSince(std::int32_t version, ClipboardItemType type, std::size_t size);
+
+// Any other opaque 64-bit hash (e.g. item id seeds), in the same format.
+std::string hashBytes(const void* data, std::size_t size);
+
+/**
+ * Incremental image hash: after update() has seen every byte, finish()
+ * returns exactly what computeImageHash() would for the whole buffer.
+ *
+ * The final size is unknown until finish(), so chunk digests are kept from
+ * the first byte and a whole-buffer state runs alongside them only until the
+ * threshold is crossed.
+ */
+class ImageHasher {
+public:
+    ImageHasher();
+    ~ImageHasher();
+
+    ImageHasher(const ImageHasher&) = delete;
+    ImageHasher& operator=(const ImageHasher&) = delete;
+
+    void update(const std::uint8_t* data, std::size_t size);
+    std::string finish() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> m_state;
+    std::size_t m_size;
+    std::size_t m_chunkFill;
+};
+
+} // namespace pasty::content_hash
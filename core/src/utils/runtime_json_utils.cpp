@@ -50,6 +50,39 @@ Json itemToJson(const ClipboardHistoryItem& item) {
     return value;
 }
 
+// Same keys as itemToJson so list and search callers decode either shape;
+// content and ocrText carry the stored preview instead of the full text.
+Json summaryToJson(const ClipboardHistoryItemSummary& summary) {
+    const bool isImage = summary.type == ClipboardItemType::Image;
+    Json value = {
+        {"id", summary.id},
+        {"type", isImage ? "image" : "text"},
+        {"content", isImage ? std::string() : summary.preview},
+        {"preview", summary.preview},
+        {"imagePath", summary.imagePath},
+        {"imageWidth", summary.imageWidth},
+        {"imageHeight", summary.imageHeight},
+        {"imageFormat", summary.imageFormat},
+        {"createTimeMs", summary.createTimeMs},
+        {"updateTimeMs", summary.updateTimeMs},
+        {"lastCopyTimeMs", summary.lastCopyTimeMs},
+        {"sourceAppId", summary.sourceAppId},
+        {"contentHash", summary.contentHash},
+        {"metadata", summary.metadata},
+        {"ocrStatus", nullptr},
+        {"ocrText", nullptr},
+    };
+
+    if (isImage) {
+        value["ocrStatus"] = ocrStatusToString(summary.ocrStatus);
+        if (!summary.preview.empty()) {
+            value["ocrText"] = summary.preview;
+        }
+    }
+
+    return value;
+}
+
 } // namespace
 
 std::int64_t nowMs() {
@@ -75,6 +108,14 @@ std::string serializeItemsToJson(const std::vector<ClipboardHistoryItem>& items)
     return payload.dump();
 }
 
+std::string serializeSummariesToJson(const std::vector<ClipboardHistoryItemSummary>& summaries) {
+    Json payload = Json::array();
+    for (const auto& summary : summaries) {
+        payload.push_back(summaryToJson(summary));
+    }
+    return payload.dump();
+}
+
 std::string serializeOcrTask(const OcrTask& task) {
     Json value = {
         {"id", task.id},
@@ -12,6 +12,7 @@ std::int64_t nowMs();
 std::string fromCString(const char* text);
 char* copyString(const std::string& str);
 std::string serializeItemsToJson(const std::vector<ClipboardHistoryItem>& items);
+std::string serializeSummariesToJson(const std::vector<ClipboardHistoryItemSummary>& summaries);
 std::string serializeOcrTask(const OcrTask& task);
 std::string serializeOcrTasks(const std::vector<OcrTask>& tasks);
 std::string serializeOcrStatus(const OcrTaskStatus& status);
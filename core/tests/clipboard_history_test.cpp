@@ -1,11 +1,23 @@
+#include <application/history/clipboard_ingest_queue.h>
 #include <application/history/clipboard_service.h>
 #include <history/clipboard_history_store.h>
+#include <infrastructure/storage/durable_asset_writer.h>
 #include <infrastructure/settings/in_memory_settings_store.h>
+#include <store/cached_clipboard_history_store.h>
 #include <store/sqlite_clipboard_history_store.h>
+#include <utils/content_hash.h>
 
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <set>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -504,6 +516,1200 @@ void testImageDedupePreservesTags() {
     std::cout << "testImageDedupePreservesTags PASSED" << std::endl;
 }
 
+void testStoreReusesStatementsAcrossReopen() {
+    std::cout << "Running testStoreReusesStatementsAcrossReopen..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_statement_reuse";
+    std::filesystem::remove_all(testDir);
+
+    auto store = pasty::createClipboardHistoryStore();
+    assert(store->open(testDir.string()));
+
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 3; ++i) {
+            pasty::ClipboardHistoryItem item;
+            item.id = "reuse-" + std::to_string(round) + "-" + std::to_string(i);
+            item.content = "statement reuse " + std::to_string(round) + "-" + std::to_string(i);
+            item.contentHash = "reuse-hash-" + std::to_string(round) + "-" + std::to_string(i);
+            item.createTimeMs = 1000 + round * 10 + i;
+            item.updateTimeMs = item.createTimeMs;
+            item.lastCopyTimeMs = item.createTimeMs;
+            const auto result = store->upsertTextItem(item);
+            assert(result.inserted);
+            assert(result.id == item.id);
+        }
+
+        assert(store->getItem("reuse-0-0").has_value());
+        assert(!store->getItem("missing").has_value());
+        assert(store->getItem("reuse-0-1")->content == "statement reuse 0-1");
+
+        store->close();
+        assert(store->open(testDir.string()));
+    }
+
+    assert(store->listItems(10, "").items.size() == 6);
+    store->close();
+    std::cout << "testStoreReusesStatementsAcrossReopen PASSED" << std::endl;
+}
+
+void testFullTextSearchPrefixRankingAndDelete() {
+    std::cout << "Running testFullTextSearchPrefixRankingAndDelete..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_fts";
+    std::filesystem::remove_all(testDir);
+
+    pasty::InMemorySettingsStore settings(1000);
+    auto service = makeService(settings);
+    assert(service.initialize(testDir.string()));
+
+    pasty::ClipboardHistoryIngestEvent once;
+    once.text = "deploy script for staging";
+    once.timestampMs = 1000;
+    assert(service.ingest(once));
+
+    pasty::ClipboardHistoryIngestEvent twice;
+    twice.text = "deploy deploy deploy now";
+    twice.timestampMs = 500;
+    assert(service.ingest(twice));
+
+    pasty::ClipboardHistoryIngestEvent image;
+    image.itemType = pasty::ClipboardItemType::Image;
+    image.image.bytes = {0x89, 0x50, 0x4E, 0x47, 0x01};
+    image.image.formatHint = "png";
+    image.timestampMs = 1500;
+    assert(service.ingest(image));
+    const std::string imageId = service.list(1, "").items[0].id;
+    assert(service.updateOcrSuccess(imageId, "Deployment receipt"));
+
+    pasty::SearchOptions prefix;
+    prefix.query = "depl";
+    auto byRecency = service.search(prefix);
+    assert(byRecency.size() == 3);
+    assert(byRecency[0].id == imageId);
+    assert(byRecency[1].content == "deploy script for staging");
+
+    prefix.includeOcr = false;
+    assert(service.search(prefix).size() == 2);
+
+    pasty::SearchOptions ranked;
+    ranked.query = "deploy";
+    ranked.rankByRelevance = true;
+    ranked.includeOcr = false;
+    auto byRank = service.search(ranked);
+    assert(byRank.size() == 2);
+    assert(byRank[0].content == "deploy deploy deploy now");
+
+    pasty::SearchOptions punctuation;
+    punctuation.query = "-";
+    assert(service.search(punctuation).empty());
+
+    assert(service.deleteById(byRank[0].id));
+    assert(service.search(ranked).size() == 1);
+
+    service.shutdown();
+    std::cout << "testFullTextSearchPrefixRankingAndDelete PASSED" << std::endl;
+}
+
+void testSubstringSearchMode() {
+    std::cout << "Running testSubstringSearchMode..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_substring";
+    std::filesystem::remove_all(testDir);
+
+    pasty::InMemorySettingsStore settings(1000);
+    auto service = makeService(settings);
+    assert(service.initialize(testDir.string()));
+
+    pasty::ClipboardHistoryIngestEvent identifier;
+    identifier.text = "loadUserProfileAsync";
+    identifier.timestampMs = 1000;
+    assert(service.ingest(identifier));
+
+    pasty::ClipboardHistoryIngestEvent url;
+    url.text = "https://example.com/api/v2/users?id=42";
+    url.timestampMs = 2000;
+    assert(service.ingest(url));
+
+    pasty::ClipboardHistoryIngestEvent cjk;
+    cjk.text = "今天天气很好";
+    cjk.timestampMs = 3000;
+    assert(service.ingest(cjk));
+
+    pasty::SearchOptions token;
+    token.query = "Profile";
+    assert(service.search(token).empty());
+
+    pasty::SearchOptions substring;
+    substring.mode = pasty::SearchMode::Substring;
+    substring.query = "Profile";
+    auto results = service.search(substring);
+    assert(results.size() == 1);
+    assert(results[0].content == "loadUserProfileAsync");
+
+    substring.query = "api/v2";
+    results = service.search(substring);
+    assert(results.size() == 1);
+    assert(results[0].content == "https://example.com/api/v2/users?id=42");
+
+    substring.query = "天气很";
+    results = service.search(substring);
+    assert(results.size() == 1);
+    assert(results[0].content == "今天天气很好");
+
+    substring.query = "天气";
+    results = service.search(substring);
+    assert(results.size() == 1);
+
+    substring.query = "zzzz";
+    assert(service.search(substring).empty());
+
+    // Token mode hands CJK and punctuated terms to the substring path.
+    token.query = "气很好";
+    results = service.search(token);
+    assert(results.size() == 1);
+    assert(results[0].content == "今天天气很好");
+
+    token.query = "v2/users";
+    token.rankByRelevance = true;
+    results = service.search(token);
+    assert(results.size() == 1);
+    assert(results[0].content == "https://example.com/api/v2/users?id=42");
+
+    token.query = "天气";
+    assert(service.search(token).size() == 1);
+
+    service.shutdown();
+    std::cout << "testSubstringSearchMode PASSED" << std::endl;
+}
+
+void testRetentionSweepsPastHighWaterMark() {
+    std::cout << "Running testRetentionSweepsPastHighWaterMark..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_retention_watermark";
+    std::filesystem::remove_all(testDir);
+
+    pasty::InMemorySettingsStore settings(100);
+    auto service = makeService(settings);
+    assert(service.initialize(testDir.string()));
+
+    pasty::ClipboardHistoryIngestEvent oldestImage;
+    oldestImage.itemType = pasty::ClipboardItemType::Image;
+    oldestImage.image.bytes = {0x89, 0x50, 0x4E, 0x47, 0x02};
+    oldestImage.image.formatHint = "png";
+    oldestImage.timestampMs = 1000;
+    assert(service.ingest(oldestImage));
+    const auto imageItem = service.list(1, "").items[0];
+    assert(std::filesystem::exists(testDir / imageItem.imagePath));
+
+    // 100 items plus 5% slack fit below the high-water mark.
+    for (int i = 1; i < 105; ++i) {
+        pasty::ClipboardHistoryIngestEvent event;
+        event.text = "watermark " + std::to_string(i);
+        event.timestampMs = 1000 + i;
+        assert(service.ingest(event));
+    }
+    assert(service.list(1000, "").items.size() == 105);
+    assert(std::filesystem::exists(testDir / imageItem.imagePath));
+
+    pasty::ClipboardHistoryIngestEvent overflow;
+    overflow.text = "watermark overflow";
+    overflow.timestampMs = 5000;
+    assert(service.ingest(overflow));
+
+    const auto remaining = service.list(1000, "");
+    assert(remaining.items.size() == 100);
+    assert(remaining.items[0].content == "watermark overflow");
+    assert(remaining.items.back().content == "watermark 6");
+    assert(!service.getById(imageItem.id).has_value());
+    assert(!std::filesystem::exists(testDir / imageItem.imagePath));
+
+    assert(service.enforceRetention(10));
+    assert(service.list(1000, "").items.size() == 10);
+
+    service.shutdown();
+    std::cout << "testRetentionSweepsPastHighWaterMark PASSED" << std::endl;
+}
+
+void testIngestBatchDedupesAndAppliesRetention() {
+    std::cout << "Running testIngestBatchDedupesAndAppliesRetention..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_ingest_batch";
+    std::filesystem::remove_all(testDir);
+
+    pasty::InMemorySettingsStore settings(100);
+    auto service = makeService(settings);
+    assert(service.initialize(testDir.string()));
+
+    pasty::ClipboardHistoryIngestEvent existing;
+    existing.text = "already stored";
+    existing.timestampMs = 500;
+    const pasty::ClipboardIngestResult existingResult = service.ingestWithResult(existing);
+    assert(existingResult.ok && existingResult.inserted && !existingResult.id.empty());
+
+    std::vector<pasty::ClipboardHistoryIngestEvent> events;
+    pasty::ClipboardHistoryIngestEvent image;
+    image.itemType = pasty::ClipboardItemType::Image;
+    image.image.bytes = {0x89, 0x50, 0x4E, 0x47, 0x03};
+    image.image.formatHint = "png";
+    image.timestampMs = 1000;
+    events.push_back(image);
+
+    pasty::ClipboardHistoryIngestEvent repeatExisting = existing;
+    repeatExisting.timestampMs = 1001;
+    events.push_back(repeatExisting);
+
+    pasty::ClipboardHistoryIngestEvent transient;
+    transient.text = "secret";
+    transient.flags.isTransient = true;
+    transient.timestampMs = 1002;
+    events.push_back(transient);
+
+    for (int i = 0; i < 3; ++i) {
+        pasty::ClipboardHistoryIngestEvent event;
+        event.text = "batch " + std::to_string(i);
+        event.timestampMs = 2000 + i;
+        events.push_back(event);
+    }
+
+    pasty::ClipboardHistoryIngestEvent repeatInBatch = events[3];
+    repeatInBatch.timestampMs = 3000;
+    events.push_back(repeatInBatch);
+
+    const std::vector<pasty::ClipboardIngestResult> results = service.ingestBatch(events);
+    assert(results.size() == events.size());
+    assert(results[0].ok && results[0].inserted);
+    assert(results[1].ok && !results[1].inserted && results[1].id == existingResult.id);
+    assert(results[2].ok && !results[2].inserted && results[2].id.empty());
+    assert(results[3].ok && results[3].inserted);
+    assert(results[6].ok && !results[6].inserted && results[6].id == results[3].id);
+
+    const auto listed = service.list(100, "");
+    assert(listed.items.size() == 5);
+    assert(listed.items[0].id == results[3].id);
+    assert(listed.items[0].lastCopyTimeMs == 3000);
+    const auto storedImage = service.getById(results[0].id);
+    assert(storedImage.has_value());
+    assert(std::filesystem::exists(testDir / storedImage->imagePath));
+
+    // A batch that overshoots the high-water mark is trimmed before commit.
+    std::vector<pasty::ClipboardHistoryIngestEvent> bulk;
+    for (int i = 0; i < 150; ++i) {
+        pasty::ClipboardHistoryIngestEvent event;
+        event.text = "bulk " + std::to_string(i);
+        event.timestampMs = 10000 + i;
+        bulk.push_back(event);
+    }
+    const std::vector<pasty::ClipboardIngestResult> bulkResults = service.ingestBatch(bulk);
+    assert(bulkResults.size() == bulk.size());
+    for (const auto& result : bulkResults) {
+        assert(result.ok && result.inserted);
+    }
+
+    const auto remaining = service.list(1000, "");
+    assert(remaining.items.size() == 100);
+    assert(remaining.items[0].content == "bulk 149");
+    assert(remaining.items.back().content == "bulk 50");
+    assert(!std::filesystem::exists(testDir / storedImage->imagePath));
+
+    service.shutdown();
+    std::cout << "testIngestBatchDedupesAndAppliesRetention PASSED" << std::endl;
+}
+
+void testReaderPoolServesReadsDuringIngest() {
+    std::cout << "Running testReaderPoolServesReadsDuringIngest..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_reader_pool";
+    std::filesystem::remove_all(testDir);
+
+    pasty::ClipboardHistoryStoreOptions options;
+    options.readerConnections = 2;
+    auto store = pasty::createClipboardHistoryStore(options);
+    assert(store->open(testDir.string()));
+    store->enforceRetention(1000);
+    assert(std::filesystem::exists(testDir / "history.sqlite3-wal"));
+
+    std::atomic<bool> writerDone(false);
+    std::thread writer([&]() {
+        for (int i = 0; i < 200; ++i) {
+            pasty::ClipboardHistoryItem item;
+            item.id = "pool-" + std::to_string(i);
+            item.content = "reader pool entry " + std::to_string(i);
+            item.contentHash = "pool-hash-" + std::to_string(i);
+            item.createTimeMs = 1000 + i;
+            item.updateTimeMs = item.createTimeMs;
+            item.lastCopyTimeMs = item.createTimeMs;
+            assert(store->upsertTextItem(item).inserted);
+        }
+        writerDone = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&]() {
+            std::size_t lastSeen = 0;
+            while (!writerDone) {
+                const std::size_t seen = store->listItems(1000, "").items.size();
+                assert(seen >= lastSeen);
+                lastSeen = seen;
+                pasty::SearchOptions search;
+                search.query = "entry";
+                store->search(search);
+            }
+        });
+    }
+
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    assert(store->listItems(1000, "").items.size() == 200);
+    assert(store->getItem("pool-199")->content == "reader pool entry 199");
+    store->close();
+    assert(!store->getItem("pool-199").has_value());
+
+    // Without WAL, reads fall back to the writer connection.
+    pasty::ClipboardHistoryStoreOptions rollbackOptions;
+    rollbackOptions.walEnabled = false;
+    auto rollbackStore = pasty::createClipboardHistoryStore(rollbackOptions);
+    assert(rollbackStore->open(testDir.string()));
+    assert(!std::filesystem::exists(testDir / "history.sqlite3-wal"));
+    assert(rollbackStore->getItem("pool-0").has_value());
+    assert(rollbackStore->listItems(1000, "").items.size() == 200);
+    rollbackStore->close();
+
+    std::cout << "testReaderPoolServesReadsDuringIngest PASSED" << std::endl;
+}
+
+void testKeysetPaginationKeepsSameMillisecondRows() {
+    std::cout << "Running testKeysetPaginationKeepsSameMillisecondRows..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_keyset_pagination";
+    std::filesystem::remove_all(testDir);
+
+    auto store = pasty::createClipboardHistoryStore();
+    assert(store->open(testDir.string()));
+    store->enforceRetention(1000);
+
+    // Three rows per millisecond, so page boundaries fall inside a tie.
+    for (int i = 0; i < 25; ++i) {
+        pasty::ClipboardHistoryItem item;
+        item.id = "page-" + std::to_string(100 + i);
+        item.content = "page entry " + std::to_string(i);
+        item.contentHash = "page-hash-" + std::to_string(i);
+        item.createTimeMs = 1000 + i / 3;
+        item.updateTimeMs = item.createTimeMs;
+        item.lastCopyTimeMs = item.createTimeMs;
+        assert(store->upsertTextItem(item).inserted);
+    }
+
+    std::vector<std::string> seen;
+    std::string cursor;
+    int pages = 0;
+    do {
+        const auto page = store->listItems(4, cursor);
+        assert(page.items.size() <= 4);
+        for (const auto& item : page.items) {
+            seen.push_back(item.id);
+        }
+        cursor = page.nextCursor;
+        ++pages;
+    } while (!cursor.empty());
+
+    assert(pages == 7);
+    assert(seen.size() == 25);
+    assert(std::set<std::string>(seen.begin(), seen.end()).size() == 25);
+    assert(seen.front() == "page-124");
+    assert(seen.back() == "page-100");
+
+    const auto full = store->listItems(25, "");
+    assert(full.items.size() == 25);
+    assert(full.nextCursor.empty());
+
+    // A bare timestamp cursor from older clients resumes before that millisecond.
+    const auto legacy = store->listItems(100, "1002");
+    assert(legacy.items.size() == 6);
+    assert(legacy.items[0].lastCopyTimeMs == 1001);
+
+    assert(store->listItems(100, "garbage").items.size() == 25);
+    store->close();
+    std::cout << "testKeysetPaginationKeepsSameMillisecondRows PASSED" << std::endl;
+}
+
+void testSummariesCarryPreviewOnly() {
+    std::cout << "Running testSummariesCarryPreviewOnly..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_summaries";
+    std::filesystem::remove_all(testDir);
+
+    auto store = pasty::createClipboardHistoryStore();
+    assert(store->open(testDir.string()));
+
+    std::string longText;
+    for (int i = 0; i < 300; ++i) {
+        longText += "\xE4\xBD\xA0";
+    }
+    pasty::ClipboardHistoryItem text;
+    text.id = "summary-text";
+    text.content = longText + " needle";
+    text.contentHash = "summary-text-hash";
+    text.createTimeMs = 1000;
+    text.updateTimeMs = 1000;
+    text.lastCopyTimeMs = 1000;
+    assert(store->upsertTextItem(text).inserted);
+
+    pasty::ClipboardHistoryItem image;
+    image.id = "summary-image";
+    image.type = pasty::ClipboardItemType::Image;
+    image.imageFormat = "png";
+    image.contentHash = "summary-image-hash";
+    image.createTimeMs = 2000;
+    image.updateTimeMs = 2000;
+    image.lastCopyTimeMs = 2000;
+    const std::vector<std::uint8_t> tinyBytes{1, 2, 3};
+    assert(store->upsertImageItem(image, pasty::ImageBytesView(tinyBytes)).inserted);
+
+    const auto page = store->listItemSummaries(10, "");
+    assert(page.items.size() == 2);
+    assert(page.items[0].id == "summary-image");
+    assert(page.items[0].preview.empty());
+    assert(page.items[1].preview == longText.substr(0, 200 * 3));
+
+    assert(store->updateOcrSuccess("summary-image", "scanned receipt"));
+    assert(store->listItemSummaries(1, "").items[0].preview == "scanned receipt");
+
+    pasty::SearchOptions options;
+    options.query = "needle";
+    options.previewLength = 10;
+    const auto hits = store->searchSummaries(options);
+    assert(hits.size() == 1);
+    assert(hits[0].preview == longText.substr(0, 10 * 3));
+
+    options.previewLength = 250;
+    const auto longHits = store->searchSummaries(options);
+    assert(longHits.size() == 1);
+    assert(longHits[0].preview == longText.substr(0, 250 * 3));
+
+    options.previewLength = 1000;
+    assert(store->searchSummaries(options)[0].preview == text.content);
+
+    const auto full = store->getItem("summary-text");
+    assert(full.has_value());
+    assert(full->content == text.content);
+
+    store->close();
+    std::cout << "testSummariesCarryPreviewOnly PASSED" << std::endl;
+}
+
+void testItemCacheInvalidatesOnWrites() {
+    std::cout << "Running testItemCacheInvalidatesOnWrites..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_item_cache";
+    std::filesystem::remove_all(testDir);
+
+    pasty::CachedClipboardHistoryStore store(pasty::createClipboardHistoryStore(), 2);
+    assert(store.open(testDir.string()));
+    store.enforceRetention(100);
+
+    auto makeItem = [](const std::string& id, std::int64_t timeMs) {
+        pasty::ClipboardHistoryItem item;
+        item.id = id;
+        item.content = "cached " + id;
+        item.contentHash = "hash-" + id;
+        item.createTimeMs = timeMs;
+        item.updateTimeMs = timeMs;
+        item.lastCopyTimeMs = timeMs;
+        return item;
+    };
+
+    assert(store.upsertTextItem(makeItem("cache-a", 1000)).inserted);
+    assert(store.upsertTextItem(makeItem("cache-b", 2000)).inserted);
+    assert(store.upsertTextItem(makeItem("cache-c", 3000)).inserted);
+
+    assert(store.getItem("cache-a").has_value());
+    assert(store.getItem("cache-a").has_value());
+    assert(store.getItemByTypeAndContentHash(pasty::ClipboardItemType::Text, "hash-cache-a")->id == "cache-a");
+    auto stats = store.cacheStats();
+    assert(stats.misses == 1);
+    assert(stats.hits == 2);
+
+    // Metadata updates must not be served stale.
+    assert(store.updateItemMetadata("cache-a", "{\"tags\":[\"x\"]}", 4000));
+    assert(store.getItem("cache-a")->metadata == "{\"tags\":[\"x\"]}");
+
+    // A dedupe upsert under another id refreshes the existing row.
+    pasty::ClipboardHistoryItem duplicate = makeItem("cache-a2", 5000);
+    duplicate.contentHash = "hash-cache-a";
+    assert(!store.upsertTextItem(duplicate).inserted);
+    assert(store.getItem("cache-a")->lastCopyTimeMs == 5000);
+
+    // Capacity 2: a third distinct item evicts the least recently used one.
+    assert(store.getItem("cache-b").has_value());
+    assert(store.getItem("cache-c").has_value());
+    assert(store.cacheStats().evictions >= 1);
+    assert(store.cacheStats().size == 2);
+
+    assert(store.deleteItem("cache-c"));
+    assert(!store.getItem("cache-c").has_value());
+
+    // Retention sweeps drop rows behind the cache's back.
+    assert(store.getItem("cache-b").has_value());
+    assert(store.enforceRetention(1));
+    assert(!store.getItem("cache-b").has_value());
+    assert(store.getItem("cache-a").has_value());
+
+    store.close();
+    std::cout << "testItemCacheInvalidatesOnWrites PASSED" << std::endl;
+}
+
+void testImageAssetsAreContentAddressed() {
+    std::cout << "Running testImageAssetsAreContentAddressed..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_content_addressed_assets";
+    std::filesystem::remove_all(testDir);
+
+    auto store = pasty::createClipboardHistoryStore();
+    assert(store->open(testDir.string()));
+
+    const std::vector<std::uint8_t> bytes{9, 8, 7, 6};
+    pasty::ClipboardHistoryItem image;
+    image.id = "asset-image";
+    image.type = pasty::ClipboardItemType::Image;
+    image.imageFormat = "png";
+    image.contentHash = "abcdef0123456789";
+    image.createTimeMs = 1000;
+    image.updateTimeMs = 1000;
+    image.lastCopyTimeMs = 1000;
+    assert(store->upsertImageItem(image, pasty::ImageBytesView(bytes)).inserted);
+
+    const auto stored = store->getItem("asset-image");
+    assert(stored.has_value());
+    assert(stored->imagePath == "images/ab/cd/abcdef0123456789.png");
+    assert(std::filesystem::exists(testDir / stored->imagePath));
+    store->close();
+
+    // Rewind to the flat layout of schema 9 and check the migration moves it.
+    const std::filesystem::path legacyPath = testDir / "images" / "asset-image.png";
+    std::filesystem::rename(testDir / stored->imagePath, legacyPath);
+    sqlite3* db = nullptr;
+    assert(sqlite3_open((testDir / "history.sqlite3").string().c_str(), &db) == SQLITE_OK);
+    const char* rewind =
+        "DROP TRIGGER items_asset_ref_ai;"
+        "DROP TRIGGER items_asset_ref_ad;"
+        "DROP TRIGGER items_asset_ref_au;"
+        "DROP TABLE image_assets;"
+        "DROP TABLE image_asset_moves;"
+        "ALTER TABLE items DROP COLUMN image_blob;"
+        "ALTER TABLE items DROP COLUMN hash_version;"
+        "UPDATE items SET image_path = 'images/asset-image.png' WHERE id = 'asset-image';"
+        "PRAGMA user_version = 9;";
+    assert(sqlite3_exec(db, rewind, nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+
+    assert(store->open(testDir.string()));
+    const auto migrated = store->getItem("asset-image");
+    assert(migrated.has_value());
+    assert(migrated->imagePath == "images/ab/cd/abcdef0123456789.png");
+    assert(std::filesystem::exists(testDir / migrated->imagePath));
+    assert(!std::filesystem::exists(legacyPath));
+
+    assert(store->deleteItem("asset-image"));
+    assert(!std::filesystem::exists(testDir / migrated->imagePath));
+    store->close();
+    std::cout << "testImageAssetsAreContentAddressed PASSED" << std::endl;
+}
+
+void testImageIngestCleansUpStagedAssets() {
+    std::cout << "Running testImageIngestCleansUpStagedAssets..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_staged_assets";
+    std::filesystem::remove_all(testDir);
+    const std::filesystem::path stagingDir = testDir / "images" / ".staging";
+
+    auto store = pasty::createClipboardHistoryStore();
+    assert(store->open(testDir.string()));
+
+    pasty::ClipboardHistoryItem image;
+    image.id = "staged-image";
+    image.type = pasty::ClipboardItemType::Image;
+    image.imageFormat = "png";
+    image.contentHash = "5151515151515151";
+    image.createTimeMs = 1000;
+    image.updateTimeMs = 1000;
+    image.lastCopyTimeMs = 1000;
+    const std::vector<std::uint8_t> bytes(4096, 0x51);
+    assert(store->upsertImageItem(image, pasty::ImageBytesView(bytes)).inserted);
+
+    pasty::ClipboardHistoryItem again = image;
+    again.id = "staged-image-again";
+    again.lastCopyTimeMs = 2000;
+    assert(!store->upsertImageItem(again, pasty::ImageBytesView(bytes)).inserted);
+
+    // Reusing an id with new content fails the insert after the asset was
+    // staged; neither the staged nor the published file may survive.
+    pasty::ClipboardHistoryItem conflicting = image;
+    conflicting.contentHash = "5252525252525252";
+    const std::vector<std::uint8_t> conflictingBytes(4096, 0x52);
+    assert(store->upsertImageItem(conflicting, pasty::ImageBytesView(conflictingBytes)).id.empty());
+    assert(std::filesystem::is_empty(stagingDir));
+    assert(!std::filesystem::exists(testDir / "images" / "52" / "52" / "5252525252525252.png"));
+
+    const auto stored = store->getItem("staged-image");
+    assert(stored.has_value());
+    assert(stored->lastCopyTimeMs == 2000);
+    assert(std::filesystem::file_size(testDir / stored->imagePath) == bytes.size());
+    store->close();
+
+    // Files staged by a process that died before committing are swept on open.
+    std::ofstream(stagingDir / "orphan.tmp") << "partial";
+    assert(store->open(testDir.string()));
+    assert(std::filesystem::is_empty(stagingDir));
+    store->close();
+    std::cout << "testImageIngestCleansUpStagedAssets PASSED" << std::endl;
+}
+
+void testGroupDurabilitySharesBarriers() {
+    std::cout << "Running testGroupDurabilitySharesBarriers..." << std::endl;
+
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_durable_asset_writer";
+    std::filesystem::remove_all(testDir);
+    std::filesystem::create_directories(testDir);
+
+    constexpr int kWriters = 8;
+    constexpr int kFilesPerWriter = 4;
+    const std::vector<std::uint8_t> bytes(16 * 1024, 0x33);
+
+    pasty::DurableAssetWriterOptions perFileOptions;
+    perFileOptions.durability = pasty::AssetDurability::PerFile;
+    pasty::DurableAssetWriter perFile(perFileOptions);
+    assert(perFile.writeAtomically((testDir / "single.png").string(), bytes));
+    assert(perFile.barrierCount() == 2);
+    assert(std::filesystem::file_size(testDir / "single.png") == bytes.size());
+    assert(!std::filesystem::exists(testDir / "single.png.tmp"));
+
+    pasty::DurableAssetWriter group;
+    std::atomic<int> failures(0);
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; ++w) {
+        writers.emplace_back([&, w]() {
+            for (int i = 0; i < kFilesPerWriter; ++i) {
+                const auto path = testDir / ("group-" + std::to_string(w) + "-" + std::to_string(i) + ".png");
+                if (!group.writeAtomically(path.string(), bytes)) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    assert(failures == 0);
+    // Per-file mode would need two barriers for each of the 32 files.
+    assert(group.barrierCount() <= 2 * kWriters * kFilesPerWriter);
+    assert(group.barrierCount() >= 1);
+    std::cout << "testGroupDurabilitySharesBarriers PASSED" << std::endl;
+}
+
+void testImagePublishSyncsNewShardDirectories() {
+    std::cout << "Running testImagePublishSyncsNewShardDirectories..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_shard_sync";
+    std::filesystem::remove_all(testDir);
+
+    pasty::DurableAssetWriterOptions writerOptions;
+    writerOptions.durability = pasty::AssetDurability::PerFile;
+    auto writer = std::make_shared<pasty::DurableAssetWriter>(writerOptions);
+    pasty::ClipboardHistoryStoreOptions options;
+    options.assetWriter = writer;
+    auto store = pasty::createClipboardHistoryStore(options);
+    assert(store->open(testDir.string()));
+
+    const std::vector<std::uint8_t> bytes(4096, 0x42);
+    auto makeImage = [](const std::string& id, const std::string& hash) {
+        pasty::ClipboardHistoryItem item;
+        item.id = id;
+        item.type = pasty::ClipboardItemType::Image;
+        item.imageFormat = "png";
+        item.imageWidth = 8;
+        item.imageHeight = 8;
+        item.contentHash = hash;
+        item.createTimeMs = 1000;
+        item.updateTimeMs = 1000;
+        item.lastCopyTimeMs = 1000;
+        return item;
+    };
+
+    // File, images/ for the new "ab" shard, images/ab/ for "cd", and the
+    // shard holding the new entry.
+    std::uint64_t before = writer->barrierCount();
+    assert(!store->upsertImageItem(makeImage("shard-1", "abcd000000000001"), pasty::ImageBytesView(bytes)).id.empty());
+    assert(writer->barrierCount() - before == 4);
+
+    // Same shard: only the file and its directory entry.
+    before = writer->barrierCount();
+    assert(!store->upsertImageItem(makeImage("shard-2", "abcd000000000002"), pasty::ImageBytesView(bytes)).id.empty());
+    assert(writer->barrierCount() - before == 2);
+
+    assert(std::filesystem::exists(testDir / "images/ab/cd/abcd000000000001.png"));
+    assert(std::filesystem::exists(testDir / "images/ab/cd/abcd000000000002.png"));
+    assert(std::filesystem::is_empty(testDir / "images/.staging"));
+
+    store->close();
+    std::cout << "testImagePublishSyncsNewShardDirectories PASSED" << std::endl;
+}
+
+void testSmallImagesAreStoredInline() {
+    std::cout << "Running testSmallImagesAreStoredInline..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_inline_images";
+    std::filesystem::remove_all(testDir);
+
+    pasty::ClipboardHistoryStoreOptions options;
+    options.inlineImageMaxBytes = 1024;
+    auto store = pasty::createClipboardHistoryStore(options);
+    assert(store->open(testDir.string()));
+
+    pasty::ClipboardHistoryItem small;
+    small.id = "inline-image";
+    small.type = pasty::ClipboardItemType::Image;
+    small.imageFormat = "png";
+    small.contentHash = "6161616161616161";
+    small.createTimeMs = 1000;
+    small.updateTimeMs = 1000;
+    small.lastCopyTimeMs = 1000;
+    std::vector<std::uint8_t> smallBytes(1024);
+    for (std::size_t i = 0; i < smallBytes.size(); ++i) {
+        smallBytes[i] = static_cast<std::uint8_t>(i * 7);
+    }
+    assert(store->upsertImageItem(small, pasty::ImageBytesView(smallBytes)).inserted);
+
+    pasty::ClipboardHistoryItem large = small;
+    large.id = "file-image";
+    large.contentHash = "6262626262626262";
+    large.lastCopyTimeMs = 2000;
+    const std::vector<std::uint8_t> largeBytes(1025, 0x62);
+    assert(store->upsertImageItem(large, pasty::ImageBytesView(largeBytes)).inserted);
+
+    // The inline row has no asset file and is found again by its hash.
+    const auto inlineItem = store->getItem("inline-image");
+    assert(inlineItem.has_value());
+    assert(inlineItem->imagePath.empty());
+    assert(!std::filesystem::exists(testDir / "images" / "61"));
+    pasty::ClipboardHistoryItem again = small;
+    again.id = "inline-image-again";
+    assert(!store->upsertImageItem(again, pasty::ImageBytesView(smallBytes)).inserted);
+
+    const auto fileItem = store->getItem("file-image");
+    assert(fileItem.has_value());
+    assert(!fileItem->imagePath.empty());
+    assert(std::filesystem::file_size(testDir / fileItem->imagePath) == largeBytes.size());
+
+    const auto sameBytes = [](const std::unique_ptr<pasty::ClipboardImageBytes>& view,
+                              const std::vector<std::uint8_t>& expected) {
+        return view && std::vector<std::uint8_t>(view->data(), view->data() + view->size()) == expected;
+    };
+    assert(sameBytes(store->openImageBytes("inline-image"), smallBytes));
+    assert(!store->openImageBytes("missing"));
+
+    // A mapped view survives the item and its file being deleted.
+    auto fileView = store->openImageBytes("file-image");
+    assert(sameBytes(fileView, largeBytes));
+    assert(store->deleteItem("file-image"));
+    assert(!std::filesystem::exists(testDir / fileItem->imagePath));
+    assert(sameBytes(fileView, largeBytes));
+
+    assert(store->deleteItem("inline-image"));
+    assert(!store->openImageBytes("inline-image"));
+    store->close();
+    std::cout << "testSmallImagesAreStoredInline PASSED" << std::endl;
+}
+
+void testStreamedImageIngestMatchesBufferedIngest() {
+    std::cout << "Running testStreamedImageIngestMatchesBufferedIngest..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_streamed_images";
+    std::filesystem::remove_all(testDir);
+    const std::filesystem::path stagingDir = testDir / "images" / ".staging";
+
+    pasty::InMemorySettingsStore settings(1000);
+    auto service = makeService(settings);
+    assert(service.initialize(testDir.string()));
+
+    std::vector<std::uint8_t> bytes(300 * 1024);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<std::uint8_t>(i * 31 + 7);
+    }
+
+    pasty::ClipboardHistoryIngestEvent event;
+    event.timestampMs = 1000;
+    event.sourceAppId = "com.test.stream";
+    event.itemType = pasty::ClipboardItemType::Image;
+    event.image.width = 64;
+    event.image.height = 64;
+    event.image.formatHint = "png";
+
+    auto stream = service.beginImageIngest(event);
+    assert(stream);
+    for (std::size_t offset = 0; offset < bytes.size(); offset += 64 * 1024) {
+        const std::size_t chunk = std::min<std::size_t>(64 * 1024, bytes.size() - offset);
+        assert(stream->append(bytes.data() + offset, chunk));
+    }
+    assert(stream->size() == bytes.size());
+    const pasty::ClipboardIngestResult streamed = service.commitImageIngest(*stream);
+    stream.reset();
+    assert(streamed.ok);
+    assert(streamed.inserted);
+    assert(std::filesystem::is_empty(stagingDir));
+
+    const auto item = service.getById(streamed.id);
+    assert(item.has_value());
+    assert(item->contentHash == streamed.contentHash);
+    assert(std::filesystem::file_size(testDir / item->imagePath) == bytes.size());
+
+    // The same bytes ingested in one buffer hash identically and dedupe.
+    event.timestampMs = 2000;
+    event.image.borrowedBytes = pasty::ImageBytesView(bytes);
+    const pasty::ClipboardIngestResult buffered = service.ingestWithResult(event);
+    assert(buffered.ok);
+    assert(!buffered.inserted);
+    assert(buffered.id == streamed.id);
+    assert(buffered.contentHash == streamed.contentHash);
+
+    // Abandoned streams leave nothing behind.
+    auto aborted = service.beginImageIngest(event);
+    assert(aborted);
+    assert(aborted->append(bytes.data(), 1024));
+    aborted.reset();
+    assert(std::filesystem::is_empty(stagingDir));
+    assert(service.list(100, "").items.size() == 1);
+
+    service.shutdown();
+    std::cout << "testStreamedImageIngestMatchesBufferedIngest PASSED" << std::endl;
+}
+
+void testLegacyHashesAreUpgradedOnOpen() {
+    std::cout << "Running testLegacyHashesAreUpgradedOnOpen..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_hash_versions";
+    std::filesystem::remove_all(testDir);
+
+    // CRLF, lone CR and LF spellings of the same text hash alike.
+    assert(pasty::content_hash::computeTextHash("a\r\nb\rc\r") == pasty::content_hash::computeTextHash("a\nb\nc\n"));
+    assert(pasty::content_hash::computeTextHash("a\r\nb") != pasty::content_hash::computeTextHash("ab"));
+    const std::vector<std::uint8_t> imageBytes(4096, 0x71);
+    pasty::content_hash::ImageHasher hasher;
+    hasher.update(imageBytes.data(), 1000);
+    hasher.update(imageBytes.data() + 1000, imageBytes.size() - 1000);
+    assert(hasher.finish() == pasty::content_hash::computeImageHash(pasty::ImageBytesView(imageBytes)));
+
+    pasty::InMemorySettingsStore settings(1000);
+    auto service = makeService(settings);
+    assert(service.initialize(testDir.string()));
+    pasty::ClipboardHistoryIngestEvent text;
+    text.text = "line one\r\nline two";
+    text.timestampMs = 1000;
+    const auto first = service.ingestWithResult(text);
+    assert(first.inserted);
+    pasty::ClipboardHistoryIngestEvent image;
+    image.itemType = pasty::ClipboardItemType::Image;
+    image.image.borrowedBytes = pasty::ImageBytesView(imageBytes);
+    image.image.formatHint = "png";
+    image.timestampMs = 1100;
+    const auto firstImage = service.ingestWithResult(image);
+    assert(firstImage.inserted);
+    service.shutdown();
+
+    // Pretend both rows were written by the previous hashing scheme.
+    sqlite3* db = nullptr;
+    assert(sqlite3_open((testDir / "history.sqlite3").string().c_str(), &db) == SQLITE_OK);
+    const char* downgrade =
+        "UPDATE items SET hash_version = 1, content_hash = 'legacy-' || rowid;";
+    assert(sqlite3_exec(db, downgrade, nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+
+    assert(service.initialize(testDir.string()));
+    assert(service.getById(first.id)->contentHash == first.contentHash);
+    assert(service.getById(firstImage.id)->contentHash == firstImage.contentHash);
+    // The old hashes stay resolvable for peers that still send them.
+    assert(service.resolveContentHash(pasty::ClipboardItemType::Text, "legacy-1") == first.contentHash);
+    assert(service.resolveContentHash(pasty::ClipboardItemType::Image, "legacy-2") == firstImage.contentHash);
+    assert(service.resolveContentHash(pasty::ClipboardItemType::Image, "legacy-1") == "legacy-1");
+
+    text.text = "line one\nline two";
+    text.timestampMs = 2000;
+    const auto again = service.ingestWithResult(text);
+    assert(again.ok && !again.inserted);
+    assert(again.id == first.id);
+    image.timestampMs = 2100;
+    assert(service.ingestWithResult(image).id == firstImage.id);
+    assert(service.list(100, "").items.size() == 2);
+    service.shutdown();
+
+    // A legacy row that could only be rehashed after the same content was
+    // ingested again collides with the current row and is merged into it.
+    assert(sqlite3_open((testDir / "history.sqlite3").string().c_str(), &db) == SQLITE_OK);
+    const char* duplicate =
+        "CREATE TEMP TABLE legacy_copies AS SELECT * FROM items;"
+        "UPDATE legacy_copies SET id = 'dup-' || id, content_hash = 'dup-' || type, hash_version = 1, "
+        "last_copy_time_ms = 5000;"
+        "INSERT INTO items SELECT * FROM legacy_copies;";
+    assert(sqlite3_exec(db, duplicate, nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+
+    assert(service.initialize(testDir.string()));
+    const auto merged = service.list(100, "");
+    assert(merged.items.size() == 2);
+    for (const auto& item : merged.items) {
+        assert(item.id == first.id || item.id == firstImage.id);
+        assert(item.lastCopyTimeMs == 5000);
+    }
+    assert(service.resolveContentHash(pasty::ClipboardItemType::Text, "dup-text") == first.contentHash);
+    assert(service.resolveContentHash(pasty::ClipboardItemType::Image, "dup-image") == firstImage.contentHash);
+    const auto mergedImage = service.getById(firstImage.id);
+    assert(mergedImage.has_value());
+    assert(std::filesystem::exists(testDir / mergedImage->imagePath));
+    service.shutdown();
+
+    assert(sqlite3_open((testDir / "history.sqlite3").string().c_str(), &db) == SQLITE_OK);
+    sqlite3_stmt* legacyCount = nullptr;
+    assert(sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM items WHERE hash_version < 3;", -1, &legacyCount, nullptr)
+        == SQLITE_OK);
+    assert(sqlite3_step(legacyCount) == SQLITE_ROW && sqlite3_column_int(legacyCount, 0) == 0);
+    sqlite3_finalize(legacyCount);
+    sqlite3_close(db);
+    std::cout << "testLegacyHashesAreUpgradedOnOpen PASSED" << std::endl;
+}
+
+void testLargeImagesUseTreeHash() {
+    std::cout << "Running testLargeImagesUseTreeHash..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_tree_hash";
+    std::filesystem::remove_all(testDir);
+
+    std::vector<std::uint8_t> large(pasty::content_hash::kTreeHashThresholdBytes + 12345);
+    for (std::size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<std::uint8_t>((i * 2654435761u) >> 13);
+    }
+    const std::string treeHash = pasty::content_hash::computeImageHash(pasty::ImageBytesView(large), 1);
+    assert(treeHash.size() == 16);
+    assert(pasty::content_hash::computeImageHash(pasty::ImageBytesView(large), 4) == treeHash);
+    assert(pasty::content_hash::computeImageHash(pasty::ImageBytesView(large)) == treeHash);
+    assert(pasty::content_hash::hashBytes(large.data(), large.size()) != treeHash);
+
+    // Concurrent hashes share the helper pool and still agree.
+    std::vector<std::thread> hashers;
+    std::vector<std::string> concurrent(4);
+    for (std::size_t i = 0; i < concurrent.size(); ++i) {
+        hashers.emplace_back([&large, &concurrent, i]() {
+            concurrent[i] = pasty::content_hash::computeImageHash(pasty::ImageBytesView(large), 4);
+        });
+    }
+    for (std::thread& thread : hashers) {
+        thread.join();
+    }
+    for (const std::string& hash : concurrent) {
+        assert(hash == treeHash);
+    }
+
+    pasty::content_hash::ImageHasher hasher;
+    for (std::size_t offset = 0; offset < large.size(); offset += 65543) {
+        hasher.update(large.data() + offset, std::min<std::size_t>(65543, large.size() - offset));
+    }
+    assert(hasher.finish() == treeHash);
+
+    const pasty::ImageBytesView belowThreshold(large.data(), pasty::content_hash::kTreeHashThresholdBytes - 1);
+    assert(pasty::content_hash::computeImageHash(belowThreshold)
+        == pasty::content_hash::hashBytes(belowThreshold.data, belowThreshold.size));
+
+    pasty::InMemorySettingsStore settings(1000);
+    auto service = makeService(settings);
+    assert(service.initialize(testDir.string()));
+    pasty::ClipboardHistoryIngestEvent image;
+    image.itemType = pasty::ClipboardItemType::Image;
+    image.image.borrowedBytes = pasty::ImageBytesView(large);
+    image.image.formatHint = "png";
+    image.timestampMs = 1000;
+    const auto buffered = service.ingestWithResult(image);
+    assert(buffered.inserted && buffered.contentHash == treeHash);
+
+    auto stream = service.beginImageIngest(image);
+    assert(stream);
+    assert(stream->append(large.data(), large.size()));
+    const auto streamed = service.commitImageIngest(*stream);
+    assert(streamed.ok && !streamed.inserted && streamed.id == buffered.id);
+
+    pasty::ClipboardHistoryIngestEvent text;
+    text.text = "unchanged by the tree hash";
+    text.timestampMs = 1100;
+    const auto textResult = service.ingestWithResult(text);
+    service.shutdown();
+
+    // Rows from version 2: only the large image has a different hash now, so
+    // the text row keeps whatever hash it carries and just moves up a version.
+    sqlite3* db = nullptr;
+    assert(sqlite3_open((testDir / "history.sqlite3").string().c_str(), &db) == SQLITE_OK);
+    const char* downgrade = "UPDATE items SET hash_version = 2, content_hash = 'v2-' || rowid;";
+    assert(sqlite3_exec(db, downgrade, nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+
+    assert(service.initialize(testDir.string()));
+    assert(service.getById(buffered.id)->contentHash == treeHash);
+    assert(service.getById(textResult.id)->contentHash.rfind("v2-", 0) == 0);
+    service.shutdown();
+    std::cout << "testLargeImagesUseTreeHash PASSED" << std::endl;
+}
+
+void testIngestQueueWritesBehindInBatches() {
+    std::cout << "Running testIngestQueueWritesBehindInBatches..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_ingest_queue";
+    std::filesystem::remove_all(testDir);
+
+    pasty::InMemorySettingsStore settings(1000);
+    auto service = makeService(settings);
+    assert(service.initialize(testDir.string()));
+
+    // Holds the writer inside its first batch so later events pile up.
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<void> firstBatchStarted;
+    std::vector<std::size_t> batchSizes;
+    pasty::ClipboardIngestQueueOptions options;
+    options.capacity = 8;
+    options.maxBatchSize = 4;
+    auto queue = std::make_unique<pasty::ClipboardIngestQueue>(
+        [&](const std::vector<pasty::ClipboardHistoryIngestEvent>& events) {
+            batchSizes.push_back(events.size());
+            if (batchSizes.size() == 1) {
+                firstBatchStarted.set_value();
+                released.wait();
+            }
+            return service.ingestBatch(events);
+        },
+        options);
+
+    std::vector<pasty::ClipboardIngestResult> results;
+    const auto enqueueText = [&](const std::string& text, std::int64_t timestampMs) {
+        pasty::ClipboardHistoryIngestEvent event;
+        event.text = text;
+        event.timestampMs = timestampMs;
+        return queue->enqueue(event, [&results](const pasty::ClipboardIngestResult& result) {
+            results.push_back(result);
+        });
+    };
+
+    assert(enqueueText("queued 0", 1000));
+    firstBatchStarted.get_future().wait();
+    for (int i = 1; i <= 8; ++i) {
+        const std::string text = i == 5 ? "queued 1" : "queued " + std::to_string(i);
+        assert(enqueueText(text, 1000 + i));
+    }
+    assert(!enqueueText("over capacity", 2000));
+    assert(queue->pending() == 9);
+
+    release.set_value();
+    queue->flush();
+    assert(queue->pending() == 0);
+    assert((batchSizes == std::vector<std::size_t>{1, 4, 4}));
+    assert(results.size() == 9);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        assert(results[i].ok && !results[i].id.empty());
+        assert(results[i].inserted == (i != 5));
+    }
+    assert(results[5].id == results[1].id);
+    assert(service.list(100, "").items.size() == 8);
+
+    // stop() still writes what was accepted, then refuses more.
+    assert(enqueueText("written by stop", 3000));
+    queue->stop();
+    assert(results.size() == 10 && results.back().inserted);
+    assert(!enqueueText("after stop", 3100));
+    queue.reset();
+    assert(service.list(100, "").items.size() == 9);
+
+    service.shutdown();
+    std::cout << "testIngestQueueWritesBehindInBatches PASSED" << std::endl;
+}
+
+void testCoalescingAbsorbsRapidRepeats() {
+    std::cout << "Running testCoalescingAbsorbsRapidRepeats..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    std::filesystem::path testDir = getTestsOutputBaseDir() / "test_history_coalescing";
+    std::filesystem::remove_all(testDir);
+
+    pasty::InMemorySettingsStore settings(1000);
+    pasty::ClipboardServiceOptions options;
+    options.coalesceWindowMs = 500;
+    pasty::ClipboardService service(pasty::createClipboardHistoryStore(), settings, options);
+    assert(service.initialize(testDir.string()));
+
+    const auto ingestText = [&](const std::string& text, std::int64_t timestampMs, const std::string& source = "app") {
+        pasty::ClipboardHistoryIngestEvent event;
+        event.text = text;
+        event.sourceAppId = source;
+        event.timestampMs = timestampMs;
+        return service.ingestWithResult(event);
+    };
+
+    const auto first = ingestText("burst", 1000);
+    assert(first.inserted);
+    const auto repeat = ingestText("burst", 1100);
+    assert(repeat.ok && !repeat.inserted && repeat.id == first.id);
+    assert(ingestText("burst", 1200).id == first.id);
+    assert(service.coalescedEventCount() == 2);
+    // Reads see the absorbed copy time.
+    assert(service.getById(first.id)->lastCopyTimeMs == 1200);
+
+    // The window runs from the stored event, not the last repeat.
+    assert(!ingestText("burst", 1500).inserted);
+    assert(service.coalescedEventCount() == 2);
+    // A different source app is a real update of the row.
+    ingestText("burst", 1600, "other-app");
+    assert(service.coalescedEventCount() == 2);
+    assert(service.getById(first.id)->sourceAppId == "other-app");
+
+    // Only the newest item absorbs repeats, so history order stays right.
+    ingestText("another", 1700);
+    ingestText("burst", 1750, "other-app");
+    assert(service.coalescedEventCount() == 2);
+    assert(service.list(10, "").items.front().id == first.id);
+
+    // A deleted item is stored again rather than absorbed.
+    ingestText("burst", 1800, "other-app");
+    assert(service.coalescedEventCount() == 3);
+    assert(service.deleteById(first.id));
+    const auto recreated = ingestText("burst", 1850, "other-app");
+    assert(recreated.inserted);
+
+    // Pending copy times are written on shutdown.
+    ingestText("burst", 1900, "other-app");
+    assert(service.coalescedEventCount() == 4);
+    service.shutdown();
+    assert(service.initialize(testDir.string()));
+    assert(service.getById(recreated.id)->lastCopyTimeMs == 1900);
+    service.shutdown();
+    std::cout << "testCoalescingAbsorbsRapidRepeats PASSED" << std::endl;
+}
+
 int main() {
     testSearch();
     testSearchReturnsImagesWhenQueryIsEmpty();
@@ -518,5 +1724,24 @@ int main() {
     testSearchMatchesTagsInMetadata();
     testTextDedupePreservesTags();
     testImageDedupePreservesTags();
+    testStoreReusesStatementsAcrossReopen();
+    testFullTextSearchPrefixRankingAndDelete();
+    testSubstringSearchMode();
+    testRetentionSweepsPastHighWaterMark();
+    testIngestBatchDedupesAndAppliesRetention();
+    testReaderPoolServesReadsDuringIngest();
+    testKeysetPaginationKeepsSameMillisecondRows();
+    testSummariesCarryPreviewOnly();
+    testItemCacheInvalidatesOnWrites();
+    testImageAssetsAreContentAddressed();
+    testImageIngestCleansUpStagedAssets();
+    testGroupDurabilitySharesBarriers();
+    testImagePublishSyncsNewShardDirectories();
+    testSmallImagesAreStoredInline();
+    testStreamedImageIngestMatchesBufferedIngest();
+    testLegacyHashesAreUpgradedOnOpen();
+    testLargeImagesUseTreeHash();
+    testIngestQueueWritesBehindInBatches();
+    testCoalescingAbsorbsRapidRepeats();
     return 0;
 }
@@ -118,7 +118,7 @@ void testLoopPrevention() {
     const std::vector<std::uint8_t> imageBytes = {0x89, 0x50, 0x4E, 0x47, 0x01};
 
     const auto textResult = exporter->exportTextItem(textItem);
-    const auto imageResult = exporter->exportImageItem(imageItem, imageBytes);
+    const auto imageResult = exporter->exportImageItem(imageItem, pasty::ImageBytesView(imageBytes));
 
     assert(textResult == pasty::CloudDriveSyncExporter::ExportResult::SkippedNonLocalOrigin);
     assert(imageResult == pasty::CloudDriveSyncExporter::ExportResult::SkippedNonLocalOrigin);
@@ -139,7 +139,7 @@ void testExporterSizeCaps() {
 
     const std::vector<std::uint8_t> oversizedImage(26214401U, 0x5A);
     const auto imageItem = makeImageItem("hash-large-image", "com.test.app");
-    const auto imageResult = exporter->exportImageItem(imageItem, oversizedImage);
+    const auto imageResult = exporter->exportImageItem(imageItem, pasty::ImageBytesView(oversizedImage));
     assert(imageResult == pasty::CloudDriveSyncExporter::ExportResult::SkippedImageTooLarge);
 
     const std::string oversizedText(1048576U, 'a');
@@ -193,7 +193,7 @@ void testAtomicWrite() {
 
     const auto imageItem = makeImageItem("hash-atomic-image", "com.test.app", "PNG");
     const std::vector<std::uint8_t> imageBytes = {0x01, 0x02, 0x03, 0x04, 0x05};
-    const auto result = exporter->exportImageItem(imageItem, imageBytes);
+    const auto result = exporter->exportImageItem(imageItem, pasty::ImageBytesView(imageBytes));
     assert(result == pasty::CloudDriveSyncExporter::ExportResult::Success);
 
     const std::filesystem::path assetsDir = std::filesystem::path(syncRoot) / "assets";
@@ -363,7 +363,7 @@ void testIncludeSourceAppIdDisabled() {
 
     const auto imageItem = makeImageItem("hash-source-app-image", "com.test.app");
     const std::vector<std::uint8_t> imageBytes = {0x89, 0x50, 0x4E, 0x47, 0x01};
-    const auto imageResult = exporter->exportImageItem(imageItem, imageBytes);
+    const auto imageResult = exporter->exportImageItem(imageItem, pasty::ImageBytesView(imageBytes));
     assert(imageResult == pasty::CloudDriveSyncExporter::ExportResult::Success);
 
     const std::filesystem::path deviceLogsDir = getSingleDeviceLogsDir(syncRoot);
@@ -383,6 +383,60 @@ void testIncludeSourceAppIdDisabled() {
     cleanupTempDirectory(tempDir);
 }
 
+void testSeqBlockLeasing() {
+    std::cout << "Running testSeqBlockLeasing..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    const std::string tempDir = createTempDirectory("cloud-sync-export-seq-lease");
+    const std::string syncRoot = tempDir + "/sync";
+    const std::string baseDir = tempDir + "/base";
+
+    std::uint64_t firstSeq = 0;
+    {
+        auto exporter = pasty::CloudDriveSyncExporter::Create(syncRoot, baseDir);
+        assert(exporter.has_value());
+        firstSeq = pasty::CloudDriveSyncState::LoadOrCreate(baseDir)->nextSeq();
+
+        for (int i = 0; i < 3; ++i) {
+            const auto item = makeTextItem("lease-" + std::to_string(i), "hash-lease-" + std::to_string(i), "com.test.app");
+            assert(exporter->exportTextItem(item) == pasty::CloudDriveSyncExporter::ExportResult::Success);
+        }
+    }
+
+    // Three exports consume one leased block and leave a single journal entry.
+    std::ifstream journal(baseDir + "/sync_state.journal");
+    int journalLines = 0;
+    std::string line;
+    while (std::getline(journal, line)) {
+        if (!line.empty()) {
+            ++journalLines;
+        }
+    }
+    assert(journalLines == 1);
+
+    const std::filesystem::path log1 = getSingleDeviceLogsDir(syncRoot) / "events-0001.jsonl";
+    std::ifstream file(log1);
+    std::uint64_t expectedSeq = firstSeq;
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            const nlohmann::json eventJson = nlohmann::json::parse(line, nullptr, false);
+            assert(eventJson.value("seq", std::uint64_t(0)) == expectedSeq);
+            ++expectedSeq;
+        }
+    }
+    assert(expectedSeq == firstSeq + 3);
+
+    // A restarted exporter skips the unused rest of the block.
+    auto restarted = pasty::CloudDriveSyncExporter::Create(syncRoot, baseDir);
+    assert(restarted.has_value());
+    assert(restarted->exportTextItem(makeTextItem("after-restart", "hash-lease-restart", "com.test.app"))
+           == pasty::CloudDriveSyncExporter::ExportResult::Success);
+    const nlohmann::json lastEvent = nlohmann::json::parse(readLastLine(log1), nullptr, false);
+    assert(lastEvent.value("seq", std::uint64_t(0)) == firstSeq + 64);
+
+    cleanupTempDirectory(tempDir);
+}
+
 }
 
 int main() {
@@ -397,6 +451,7 @@ int main() {
         testE2eeDeleteExport();
         testDeviceIdConflictDetection();
         testIncludeSourceAppIdDisabled();
+        testSeqBlockLeasing();
         std::cout << "=== All tests PASSED ===" << std::endl;
         return 0;
     } catch (const std::exception& e) {
@@ -3,9 +3,11 @@
 #include "../src/infrastructure/sync/cloud_drive_sync_importer.h"
 #include "../src/infrastructure/sync/cloud_drive_sync_exporter.h"
 #include "../src/store/sqlite_clipboard_history_store.h"
+#include "../src/utils/content_hash.h"
 #include "../src/thirdparty/nlohmann/json.hpp"
 
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
@@ -531,6 +533,269 @@ void testLocalCopyWinsPrecedence() {
     cleanupTempDirectory(tempDir);
 }
 
+void testLegacyPeerHashesResolve() {
+    std::cout << "Running testLegacyPeerHashesResolve..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    const std::string tempDir = createTempDirectory("cloud-sync-import-legacy-hash");
+    const std::string syncRoot = tempDir + "/sync";
+    const std::string baseDir = tempDir + "/base";
+    std::filesystem::create_directories(syncRoot);
+    std::filesystem::create_directories(baseDir);
+
+    pasty::InMemorySettingsStore settings(1000);
+    auto service = makeService(settings);
+    assert(service.initialize(baseDir + "/history"));
+
+    // A peer on the old scheme names the text by a hash this device never
+    // computes; events without hash_version carry such hashes.
+    const std::string remote = "eeeeeeeeeeeeeeee";
+    const std::string legacyHash = "0123456789abcdef";
+    const std::string currentHash = pasty::content_hash::computeTextHash("from an older peer");
+    const std::string logs = syncRoot + "/logs/" + remote;
+    std::filesystem::create_directories(logs);
+    // Recent enough that state GC keeps the tombstone between imports.
+    const std::int64_t baseTs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - 10'000;
+
+    auto upsert = makeBaseEvent(remote, 1, baseTs + 1000, "upsert_text", "text", legacyHash);
+    upsert["text"] = "from an older peer";
+    writeJsonlFile(logs + "/events-0001.jsonl", upsert.dump());
+
+    auto importer = pasty::CloudDriveSyncImporter::Create(syncRoot, baseDir);
+    assert(importer.has_value());
+    assert(importer->importChanges(service).eventsApplied == 1);
+    const auto stored = service.getByTypeAndContentHash(pasty::ClipboardItemType::Text, currentHash);
+    assert(stored.has_value());
+
+    auto tags = makeBaseEvent(remote, 2, baseTs + 2000, "set_tags", "text", legacyHash);
+    tags["tags"] = {"legacy"};
+    writeJsonlFile(logs + "/events-0001.jsonl", tags.dump());
+    auto remove = makeBaseEvent(remote, 3, baseTs + 3000, "delete", "text", legacyHash);
+    writeJsonlFile(logs + "/events-0001.jsonl", remove.dump());
+    const auto second = importer->importChanges(service);
+    assert(second.eventsProcessed == 2);
+    assert(second.eventsApplied == 2);
+    assert(service.list(10, "").items.empty());
+
+    // A current peer replaying an older copy is held back by the tombstone,
+    // which was recorded under the current hash.
+    const std::string current = "dddddddddddddddd";
+    const std::string currentLogs = syncRoot + "/logs/" + current;
+    std::filesystem::create_directories(currentLogs);
+    auto stale = makeBaseEvent(current, 1, baseTs + 2500, "upsert_text", "text", currentHash);
+    stale["hash_version"] = pasty::content_hash::kCurrentVersion;
+    stale["text"] = "from an older peer";
+    writeJsonlFile(currentLogs + "/events-0001.jsonl", stale.dump());
+    const auto third = importer->importChanges(service);
+    assert(third.eventsProcessed == 1);
+    assert(third.eventsSkipped == 1);
+    assert(service.list(10, "").items.empty());
+
+    service.shutdown();
+    cleanupTempDirectory(tempDir);
+}
+
+void testStreamingMergeUnderTightBudget() {
+    std::cout << "Running testStreamingMergeUnderTightBudget..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    const std::string tempDir = createTempDirectory("cloud-sync-import-streaming");
+    const std::string syncRoot = tempDir + "/sync";
+    const std::string baseDir = tempDir + "/base";
+    std::filesystem::create_directories(syncRoot);
+    std::filesystem::create_directories(baseDir);
+
+    const std::string remoteA = "1111111111111111";
+    const std::string remoteB = "2222222222222222";
+    const std::string logsA = syncRoot + "/logs/" + remoteA;
+    const std::string logsB = syncRoot + "/logs/" + remoteB;
+    std::filesystem::create_directories(logsA);
+    std::filesystem::create_directories(logsB);
+
+    // The outcome depends on interleaving the two logs by ts_ms: applying all
+    // of A before B would delete "revived" after it was re-added.
+    const std::int64_t ts = 1739414400000;
+    const std::string revivedHash = pasty::content_hash::computeTextHash("revived");
+    auto upsertA1 = makeBaseEvent(remoteA, 1, ts + 100, "upsert_text", "text", revivedHash);
+    upsertA1["text"] = "revived";
+    auto upsertA2 = makeBaseEvent(remoteA, 2, ts + 300, "upsert_text", "text", revivedHash);
+    upsertA2["text"] = "revived";
+    auto deleteB1 = makeBaseEvent(remoteB, 1, ts + 200, "delete", "text", revivedHash);
+    writeJsonlFile(logsA + "/events-0001.jsonl", upsertA1.dump());
+    writeJsonlFile(logsA + "/events-0002.jsonl", upsertA2.dump());
+    writeJsonlFile(logsB + "/events-0001.jsonl", deleteB1.dump());
+
+    for (int i = 0; i < 20; ++i) {
+        auto filler = makeBaseEvent(remoteB, 2 + i, ts + 400 + i, "upsert_text", "text",
+                                    pasty::content_hash::computeTextHash("filler-" + std::to_string(i)));
+        filler["text"] = "filler-" + std::to_string(i);
+        writeJsonlFile(logsB + "/events-0001.jsonl", filler.dump());
+    }
+
+    pasty::InMemorySettingsStore settings(1000);
+    auto service = makeService(settings);
+    assert(service.initialize(baseDir + "/history"));
+
+    auto importer = pasty::CloudDriveSyncImporter::Create(syncRoot, baseDir);
+    assert(importer.has_value());
+    // Forces a pure k-way merge: one buffered event per device.
+    importer->setMemoryBudgetBytes(1);
+
+    const auto result = importer->importChanges(service);
+    assert(result.success);
+    assert(result.eventsProcessed == 23);
+    // The first upsert predates the delete and is held back by its tombstone.
+    assert(result.eventsApplied == 22);
+
+    auto revived = service.getByTypeAndContentHash(pasty::ClipboardItemType::Text, revivedHash);
+    assert(revived.has_value());
+    assert(service.list(100, "").items.size() == 21);
+
+    auto state = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(state->getRemoteDeviceState(remoteA).max_applied_seq == 2);
+    assert(state->getRemoteDeviceState(remoteB).max_applied_seq == 21);
+
+    // Cursors were advanced past everything read; a second pass finds nothing.
+    auto second = pasty::CloudDriveSyncImporter::Create(syncRoot, baseDir);
+    assert(second.has_value());
+    const auto secondResult = second->importChanges(service);
+    assert(secondResult.success);
+    assert(secondResult.eventsProcessed == 0);
+
+    service.shutdown();
+    cleanupTempDirectory(tempDir);
+}
+
+void testPendingDeletesDoNotEvictAtHistoryCap() {
+    std::cout << "Running testPendingDeletesDoNotEvictAtHistoryCap..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    const std::string tempDir = createTempDirectory("cloud-sync-import-cap");
+    const std::string syncRoot = tempDir + "/sync";
+    const std::string baseDir = tempDir + "/base";
+    std::filesystem::create_directories(syncRoot);
+    std::filesystem::create_directories(baseDir);
+
+    // Five items is both the cap and its high-water mark.
+    pasty::InMemorySettingsStore settings(5);
+    auto service = makeService(settings);
+    assert(service.initialize(baseDir + "/history"));
+    const std::int64_t ts = 1739414400000;
+    for (int i = 0; i < 5; ++i) {
+        pasty::ClipboardHistoryIngestEvent local;
+        local.text = "local-" + std::to_string(i);
+        local.timestampMs = ts + i;
+        assert(service.ingest(local));
+    }
+
+    // The remote upsert sorts before its delete; inserting it would evict
+    // local-0 even though the delete removes it again in the same import.
+    const std::string remoteA = "1111111111111111";
+    const std::string remoteB = "2222222222222222";
+    std::filesystem::create_directories(syncRoot + "/logs/" + remoteA);
+    std::filesystem::create_directories(syncRoot + "/logs/" + remoteB);
+    const std::string doomedHash = pasty::content_hash::computeTextHash("doomed");
+    auto upsert = makeBaseEvent(remoteA, 1, ts + 100, "upsert_text", "text", doomedHash);
+    upsert["hash_version"] = pasty::content_hash::kCurrentVersion;
+    upsert["text"] = "doomed";
+    auto remove = makeBaseEvent(remoteB, 1, ts + 200, "delete", "text", doomedHash);
+    remove["hash_version"] = pasty::content_hash::kCurrentVersion;
+    writeJsonlFile(syncRoot + "/logs/" + remoteA + "/events-0001.jsonl", upsert.dump());
+    writeJsonlFile(syncRoot + "/logs/" + remoteB + "/events-0001.jsonl", remove.dump());
+
+    auto importer = pasty::CloudDriveSyncImporter::Create(syncRoot, baseDir);
+    assert(importer.has_value());
+    importer->setMemoryBudgetBytes(1);
+    const auto result = importer->importChanges(service);
+    assert(result.eventsProcessed == 2);
+    assert(result.eventsApplied == 1);
+    assert(result.eventsSkipped == 1);
+
+    const auto items = service.list(10, "").items;
+    assert(items.size() == 5);
+    assert(items.back().content == "local-0");
+
+    service.shutdown();
+    cleanupTempDirectory(tempDir);
+}
+
+void testParallelParsingMatchesSerial() {
+    std::cout << "Running testParallelParsingMatchesSerial..." << std::endl;
+
+    configureMigrationDirectoryForTests();
+    const std::string tempDir = createTempDirectory("cloud-sync-import-parallel");
+    const std::string syncRoot = tempDir + "/sync";
+    std::filesystem::create_directories(syncRoot);
+
+    const std::int64_t ts = 1739414400000;
+    for (int d = 0; d < 4; ++d) {
+        const std::string remote(16, static_cast<char>('a' + d));
+        const std::string logs = syncRoot + "/logs/" + remote;
+        std::filesystem::create_directories(logs);
+        for (int i = 0; i < 30; ++i) {
+            const std::string file = logs + "/events-000" + std::to_string(1 + i / 10) + ".jsonl";
+            // Shared payloads across devices so deletes and upserts interact.
+            const std::string text = "shared-" + std::to_string(i % 12);
+            const std::string hash = pasty::content_hash::computeTextHash(text);
+            const std::uint64_t seq = static_cast<std::uint64_t>(i + 1);
+            const std::int64_t eventTs = ts + i * 10 + d * 3;
+            if (i % 7 == 6) {
+                writeJsonlFile(file, makeBaseEvent(remote, seq, eventTs, "delete", "text", hash).dump());
+            } else {
+                auto upsert = makeBaseEvent(remote, seq, eventTs, "upsert_text", "text", hash);
+                upsert["text"] = text;
+                writeJsonlFile(file, upsert.dump());
+            }
+            if (i == 15) {
+                writeJsonlFile(file, "{ truncated");
+            }
+        }
+    }
+
+    struct Outcome {
+        pasty::CloudDriveSyncImporter::ImportResult result;
+        std::vector<std::string> contents;
+        nlohmann::json state;
+    };
+    const auto runImport = [&](std::size_t threads, const std::string& name) {
+        const std::string baseDir = tempDir + "/" + name;
+        std::filesystem::create_directories(baseDir);
+        pasty::InMemorySettingsStore settings(1000);
+        auto service = makeService(settings);
+        assert(service.initialize(baseDir + "/history"));
+
+        auto importer = pasty::CloudDriveSyncImporter::Create(syncRoot, baseDir);
+        assert(importer.has_value());
+        importer->setParseThreads(threads);
+        importer->setMemoryBudgetBytes(4096);
+
+        Outcome outcome;
+        outcome.result = importer->importChanges(service);
+        for (const auto& item : service.list(100, "").items) {
+            outcome.contents.push_back(item.content + "@" + item.originDeviceId.value_or(std::string()));
+        }
+        std::ifstream stateFile(baseDir + "/sync_state.json");
+        outcome.state = nlohmann::json::parse(stateFile);
+        outcome.state.erase("device_id");
+        service.shutdown();
+        return outcome;
+    };
+
+    const Outcome serial = runImport(1, "serial");
+    const Outcome parallel = runImport(4, "parallel");
+    assert(serial.result.success && parallel.result.success);
+    assert(serial.result.eventsProcessed == 120);
+    assert(parallel.result.eventsProcessed == serial.result.eventsProcessed);
+    assert(parallel.result.eventsApplied == serial.result.eventsApplied);
+    assert(parallel.result.eventsSkipped == serial.result.eventsSkipped);
+    assert(parallel.contents == serial.contents);
+    assert(parallel.state == serial.state);
+    assert(serial.state["files"].size() == 12);
+
+    cleanupTempDirectory(tempDir);
+}
+
 }
 
 int main() {
@@ -546,6 +811,10 @@ int main() {
         testEventIdPrefixValidation();
         testE2eeDeleteImport();
         testLocalCopyWinsPrecedence();
+        testLegacyPeerHashesResolve();
+        testStreamingMergeUnderTightBudget();
+        testPendingDeletesDoNotEvictAtHistoryCap();
+        testParallelParsingMatchesSerial();
         std::cout << "=== All tests PASSED ===" << std::endl;
         return 0;
     } catch (const std::exception& e) {
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <random>
 #include <string>
 
@@ -59,6 +60,7 @@ void testStatePersistence() {
     assert(cursor.last_offset == 1024);
     assert(cursor.error_count == 1);
 
+    assert(state->persist());
     std::ifstream stateFile(statePath);
     assert(stateFile.is_open());
     nlohmann::json stateJson = nlohmann::json::parse(stateFile, nullptr, false);
@@ -172,6 +174,196 @@ void testTombstoneGc() {
     cleanupTempDirectory(tempDir);
 }
 
+void testTombstonesKeepNewestPerKey() {
+    std::cout << "Running testTombstonesKeepNewestPerKey..." << std::endl;
+
+    const std::string tempDir = createTempDirectory("cloud-sync-state-tombstone-index");
+    const std::string baseDir = tempDir + "/base";
+    std::filesystem::create_directories(baseDir);
+    const std::string statePath = baseDir + "/sync_state.json";
+
+    auto state = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(state.has_value());
+
+    assert(state->recordTombstone("text", "first-hash-0001", 300));
+    assert(state->recordTombstone("image", "second-hash-002", 100));
+    assert(state->recordTombstone("text", "third-hash-0003", 200));
+    // Same key: an older delete is absorbed, a newer one raises the cutoff.
+    assert(state->recordTombstone("text", "first-hash-0001", 250));
+    assert(state->recordTombstone("text", "first-hash-0001", 400));
+    // Same hash under another type is a separate key.
+    assert(!state->shouldSkipUpsertDueToTombstone("image", "first-hash-0001", 1));
+    assert(state->shouldSkipUpsertDueToTombstone("text", "first-hash-0001", 400));
+    assert(!state->shouldSkipUpsertDueToTombstone("text", "first-hash-0001", 401));
+    assert(state->persist());
+
+    auto readFile = [](const std::string& path) {
+        std::ifstream file(path);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    };
+    const std::string snapshot = readFile(statePath);
+    nlohmann::json stateJson = nlohmann::json::parse(snapshot);
+    assert(stateJson["tombstones"].size() == 3);
+    // Snapshot order is insertion order, independent of hash map layout.
+    assert(stateJson["tombstones"][0]["content_hash"] == "first-hash-0001");
+    assert(stateJson["tombstones"][0]["ts_ms"] == 400);
+    assert(stateJson["tombstones"][1]["content_hash"] == "second-hash-002");
+    assert(stateJson["tombstones"][2]["content_hash"] == "third-hash-0003");
+
+    // Reload and rewrite produces the same bytes.
+    auto reloaded = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(reloaded.has_value());
+    assert(reloaded->recordTombstone("image", "second-hash-002", 100));
+    assert(reloaded->updateRemoteDeviceMaxSeq("remote-c", 1));
+    assert(reloaded->persist());
+    nlohmann::json rewritten = nlohmann::json::parse(readFile(statePath));
+    assert(rewritten["tombstones"] == stateJson["tombstones"]);
+
+    // The count cap evicts the oldest first.
+    assert(reloaded->pruneForGc(400, 1'000, 2));
+    assert(!reloaded->shouldSkipUpsertDueToTombstone("image", "second-hash-002", 100));
+    assert(reloaded->shouldSkipUpsertDueToTombstone("text", "third-hash-0003", 200));
+    assert(reloaded->shouldSkipUpsertDueToTombstone("text", "first-hash-0001", 400));
+
+    cleanupTempDirectory(tempDir);
+}
+
+void testJournalReplaysUncommittedChanges() {
+    std::cout << "Running testJournalReplaysUncommittedChanges..." << std::endl;
+
+    const std::string tempDir = createTempDirectory("cloud-sync-state-journal");
+    const std::string baseDir = tempDir + "/base";
+    std::filesystem::create_directories(baseDir);
+    const std::string statePath = baseDir + "/sync_state.json";
+    const std::string journalPath = baseDir + "/sync_state.journal";
+
+    auto state = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(state.has_value());
+    const std::uint64_t initialNextSeq = state->nextSeq();
+    const auto snapshotSize = std::filesystem::file_size(statePath);
+
+    const std::string cursorFile = std::filesystem::absolute(baseDir + "/events-0002.jsonl").string();
+    state->reserveNextSeq();
+    assert(state->updateRemoteDeviceMaxSeq("remote-b", 7));
+    assert(state->updateFileCursor(cursorFile, 2048));
+    assert(state->incrementFileErrorCount(cursorFile) == 1);
+    assert(state->recordTombstone("text", "journal-hash-0001", 5'000));
+
+    // Mutations only append deltas; the snapshot is untouched until persist().
+    assert(std::filesystem::file_size(statePath) == snapshotSize);
+    assert(std::filesystem::exists(journalPath));
+    assert(std::filesystem::file_size(journalPath) > 0);
+
+    {
+        // A torn trailing line, as left by a crash mid-append, is ignored.
+        std::ofstream journal(journalPath, std::ios::app);
+        journal << "{\"op\":\"device\",\"device_id\":\"remote-b\",\"max_";
+    }
+
+    auto replayed = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(replayed.has_value());
+    assert(replayed->nextSeq() == initialNextSeq + 1);
+    assert(replayed->getRemoteDeviceState("remote-b").max_applied_seq == 7);
+    assert(replayed->getFileCursor(cursorFile).last_offset == 2048);
+    assert(replayed->getFileCursor(cursorFile).error_count == 1);
+    assert(replayed->totalFileErrorCount() == 1);
+    assert(replayed->shouldSkipUpsertDueToTombstone("text", "journal-hash-0001", 4'000));
+
+    assert(replayed->persist());
+    assert(std::filesystem::file_size(journalPath) == 0);
+
+    std::ifstream stateFile(statePath);
+    nlohmann::json stateJson = nlohmann::json::parse(stateFile, nullptr, false);
+    assert(!stateJson.is_discarded());
+    assert(stateJson.value("next_seq", std::uint64_t(0)) == initialNextSeq + 1);
+    assert(stateJson["devices"]["remote-b"].value("max_applied_seq", std::uint64_t(0)) == 7);
+    assert(stateJson["tombstones"].size() == 1);
+
+    cleanupTempDirectory(tempDir);
+}
+
+void testAppendsAfterDamagedJournalTailSurvive() {
+    std::cout << "Running testAppendsAfterDamagedJournalTailSurvive..." << std::endl;
+
+    const std::string tempDir = createTempDirectory("cloud-sync-state-journal-tail");
+    const std::string baseDir = tempDir + "/base";
+    std::filesystem::create_directories(baseDir);
+    const std::string journalPath = baseDir + "/sync_state.journal";
+
+    auto state = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(state.has_value());
+    const std::uint64_t initialNextSeq = state->nextSeq();
+    state->reserveSeqBlock(64);
+    assert(state->recordTombstone("text", "before-crash-001", 1'000));
+
+    {
+        std::ofstream journal(journalPath, std::ios::app);
+        journal << "{\"op\":\"next_seq\",\"next_";
+    }
+
+    // Changes made after a crash must not be swallowed by the torn line.
+    auto afterCrash = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(afterCrash.has_value());
+    assert(afterCrash->nextSeq() == initialNextSeq + 64);
+    assert(afterCrash->reserveSeqBlock(64) == initialNextSeq + 64);
+    assert(afterCrash->recordTombstone("text", "after-crash-0002", 2'000));
+
+    {
+        // A complete entry whose newline never made it to disk.
+        std::ofstream journal(journalPath, std::ios::app);
+        journal << "{\"op\":\"tombstone\",\"item_type\":\"text\",\"content_hash\":\"no-newline-0003\",\"ts_ms\":3000}";
+    }
+    assert(afterCrash->recordTombstone("text", "after-tail-00004", 4'000));
+
+    auto reloaded = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(reloaded.has_value());
+    assert(reloaded->nextSeq() == initialNextSeq + 128);
+    assert(reloaded->shouldSkipUpsertDueToTombstone("text", "before-crash-001", 1'000));
+    assert(reloaded->shouldSkipUpsertDueToTombstone("text", "after-crash-0002", 2'000));
+    assert(reloaded->shouldSkipUpsertDueToTombstone("text", "no-newline-0003", 3'000));
+    assert(reloaded->shouldSkipUpsertDueToTombstone("text", "after-tail-00004", 4'000));
+
+    cleanupTempDirectory(tempDir);
+}
+
+void testTombstoneHashMigration() {
+    std::cout << "Running testTombstoneHashMigration..." << std::endl;
+
+    const std::string tempDir = createTempDirectory("cloud-sync-state-tombstone-hash");
+    const std::string baseDir = tempDir + "/base";
+    std::filesystem::create_directories(baseDir);
+
+    auto state = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(state.has_value());
+    assert(state->recordTombstone("text", "1111111111111111", 1'000));
+    assert(state->recordTombstone("image", "2222222222222222", 2'000));
+
+    std::size_t calls = 0;
+    const auto resolve = [&calls](const pasty::CloudDriveSyncState::Tombstone& tombstone) {
+        ++calls;
+        return tombstone.item_type == "text" ? std::string("aaaaaaaaaaaaaaaa") : tombstone.content_hash;
+    };
+    assert(state->migrateTombstoneHashes(3, resolve));
+    assert(calls == 2);
+    assert(state->shouldSkipUpsertDueToTombstone("text", "aaaaaaaaaaaaaaaa", 1'000));
+    assert(!state->shouldSkipUpsertDueToTombstone("text", "aaaaaaaaaaaaaaaa", 1'001));
+    assert(state->shouldSkipUpsertDueToTombstone("text", "1111111111111111", 1'000));
+
+    // The version survives a reload through the journal and through a snapshot.
+    auto replayed = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(replayed.has_value());
+    assert(replayed->migrateTombstoneHashes(3, resolve));
+    assert(calls == 2);
+    assert(replayed->persist());
+    auto reloaded = pasty::CloudDriveSyncState::LoadOrCreate(baseDir);
+    assert(reloaded.has_value());
+    assert(reloaded->migrateTombstoneHashes(3, resolve));
+    assert(calls == 2);
+    assert(reloaded->shouldSkipUpsertDueToTombstone("text", "aaaaaaaaaaaaaaaa", 1'000));
+
+    cleanupTempDirectory(tempDir);
+}
+
 }
 
 int main() {
@@ -181,6 +373,10 @@ int main() {
         testStatePersistence();
         testStateCorruptionRecovery();
         testTombstoneGc();
+        testTombstonesKeepNewestPerKey();
+        testJournalReplaysUncommittedChanges();
+        testAppendsAfterDamagedJournalTailSurvive();
+        testTombstoneHashMigration();
         std::cout << "=== All tests PASSED ===" << std::endl;
         return 0;
     } catch (const std::exception& e) {
@@ -284,14 +284,15 @@ void testE2eeImageRoundTrip() {
     ingestEvent.timestampMs = 1000;
     ingestEvent.sourceAppId = "com.test.sender";
     ingestEvent.itemType = pasty::ClipboardItemType::Image;
-    ingestEvent.image.bytes = originalImageBytes;
+    ingestEvent.image.borrowedBytes = pasty::ImageBytesView(originalImageBytes);
     ingestEvent.image.width = 2;
     ingestEvent.image.height = 2;
     ingestEvent.image.formatHint = "png";
 
     auto ingestResult = senderRuntime.clipboardService()->ingestWithResult(ingestEvent);
     assert(ingestResult.ok);
-    assert(senderRuntime.exportLocalImageIngest(ingestEvent, ingestResult.inserted));
+    assert(!ingestResult.contentHash.empty());
+    assert(senderRuntime.exportLocalImageIngest(ingestEvent, ingestResult.inserted, ingestResult.contentHash));
     senderRuntime.stop();
 
     const std::filesystem::path logsRoot(syncRoot + "/logs");
@@ -40,7 +40,7 @@ final class ClipboardHistoryServiceImpl: ClipboardHistoryService {
                 var outJson: UnsafeMutablePointer<CChar>? = nil
                 let contentType = filterType?.rawValue ?? ""
                 let includeOcr = self.coordinator.settings.ocr.includeInSearch
-                let success = pasty_history_search(runtime, query, Int32(limit), Int32(self.previewLength), contentType, includeOcr, &outJson)
+                let success = pasty_history_search(runtime, query, Int32(limit), Int32(self.previewLength), contentType, includeOcr, "token", false, &outJson)
 
                 if !success {
                     LoggerService.error("History search failed (core returned false)")